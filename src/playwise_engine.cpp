@@ -1,6 +1,7 @@
 #include <iostream>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <stack>
 #include <vector>
 #include <algorithm>
@@ -9,6 +10,40 @@
 #include <queue>
 #include <deque>
 #include <set>
+#include <list>
+#include <string_view>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <array>
+#include <cstdint>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <cstdio>
+#include <charconv>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 // Forward declarations
 class Song;
@@ -18,6 +53,315 @@ class SongRatingTree;
 class InstantLookup;
 class PlayWiseEngine;
 
+/**
+ * Scoped tracing spans for profiling builds
+ * PW_TRACE_SPAN("name") at the top of a scope records one complete span
+ * (start and duration) into the calling thread's ring buffer, the newest
+ * spans overwriting the oldest. exportChromeTrace writes every thread's
+ * buffer as Chrome trace-event JSON (chrome://tracing, Perfetto), where
+ * nested scopes show up as nested slices. Spans are compiled in only with
+ * -DPLAYWISE_TRACING (make trace); otherwise PW_TRACE_SPAN expands to
+ * nothing and an export holds no events. A thread that exits hands its
+ * buffer to the next thread that starts tracing, so its spans can still be
+ * exported until the new owner overwrites them.
+ * Time Complexity: O(1) per span, O(T * R) to export
+ * Space Complexity: O(T * R) for T = peak concurrently traced threads and R = RING_CAPACITY
+ */
+class SpanTracer
+{
+public:
+#ifdef PLAYWISE_TRACING
+    static constexpr bool ENABLED = true;
+#else
+    static constexpr bool ENABLED = false;
+#endif
+    static constexpr size_t RING_CAPACITY = 1 << 16;
+    static_assert((RING_CAPACITY & (RING_CAPACITY - 1)) == 0, "ring slots are picked with a mask");
+
+    struct Event
+    {
+        const char *name; // string literal
+        uint64_t start_ns;
+        uint64_t duration_ns;
+    };
+
+    /**
+     * Records the enclosing scope as one span
+     */
+    class Span
+    {
+    private:
+        const char *name;
+        uint64_t start;
+
+    public:
+        explicit Span(const char *span_name) : name(span_name), start(now()) {}
+        ~Span() { record(name, start, now() - start); }
+
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+    };
+
+    static uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    static void record(const char *name, uint64_t start_ns, uint64_t duration_ns)
+    {
+        Ring &ring = localRing();
+        uint64_t head = ring.head.load(std::memory_order_relaxed);
+        ring.events[head & (RING_CAPACITY - 1)] = Event{name, start_ns, duration_ns};
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * Write the retained spans of every thread as Chrome trace-event JSON
+     * Call while traced threads are idle; returns the number of events
+     */
+    static size_t exportChromeTrace(std::ostream &out)
+    {
+        Registry &state = registry();
+        std::lock_guard<std::mutex> guard(state.lock);
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+
+        // Timestamps count from the earliest retained span
+        uint64_t origin = UINT64_MAX;
+        for (const auto &ring : state.rings)
+            forEachRetained(*ring, [&origin](const Event &event)
+                            { origin = std::min(origin, event.start_ns); });
+
+        size_t written = 0;
+        out << "{\"traceEvents\":[" << std::fixed << std::setprecision(3);
+        for (const auto &ring : state.rings)
+        {
+            size_t tid = ring->tid;
+            forEachRetained(*ring, [&](const Event &event)
+                            {
+                out << (written++ > 0 ? ",\n" : "\n")
+                    << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                    << ",\"ts\":" << (event.start_ns - origin) / 1000.0
+                    << ",\"dur\":" << event.duration_ns / 1000.0 << "}"; });
+        }
+        out << "\n],\"displayTimeUnit\":\"ns\"}" << std::endl;
+
+        out.flags(flags);
+        out.precision(precision);
+        return written;
+    }
+
+    static bool exportChromeTrace(const std::string &path)
+    {
+        std::ofstream out(path);
+        if (!out)
+        {
+            std::cout << "❌ Cannot open span trace file: " << path << std::endl;
+            return false;
+        }
+        size_t events = exportChromeTrace(out);
+        std::cout << "🧭 Wrote " << events << " spans to " << path << std::endl;
+        return static_cast<bool>(out);
+    }
+
+    // Spans currently retained over all threads
+    static size_t recordedCount()
+    {
+        Registry &state = registry();
+        std::lock_guard<std::mutex> guard(state.lock);
+        size_t count = 0;
+        for (const auto &ring : state.rings)
+            count += std::min<uint64_t>(ring->head.load(std::memory_order_acquire), RING_CAPACITY);
+        return count;
+    }
+
+    // Ring buffers allocated so far; bounded by the peak number of live traced threads
+    static size_t ringCount()
+    {
+        Registry &state = registry();
+        std::lock_guard<std::mutex> guard(state.lock);
+        return state.rings.size();
+    }
+
+    // Drop every retained span; call while traced threads are idle
+    static void clear()
+    {
+        Registry &state = registry();
+        std::lock_guard<std::mutex> guard(state.lock);
+        for (const auto &ring : state.rings)
+            ring->head.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    struct Ring
+    {
+        std::atomic<uint64_t> head; // spans ever recorded; the slot is head % RING_CAPACITY
+        std::vector<Event> events;
+        size_t tid;
+
+        explicit Ring(size_t thread_number) : head(0), events(RING_CAPACITY), tid(thread_number) {}
+    };
+
+    struct Registry
+    {
+        std::mutex lock;
+        std::vector<std::unique_ptr<Ring>> rings;
+        std::vector<Ring *> idle; // rings of exited threads, reused before allocating
+    };
+
+    // Holds a thread's ring for the thread's lifetime, then returns it to the idle list
+    struct RingLease
+    {
+        Ring *ring;
+
+        RingLease()
+        {
+            Registry &state = registry();
+            std::lock_guard<std::mutex> guard(state.lock);
+            if (!state.idle.empty())
+            {
+                ring = state.idle.back();
+                state.idle.pop_back();
+            }
+            else
+            {
+                state.rings.push_back(std::make_unique<Ring>(state.rings.size() + 1));
+                ring = state.rings.back().get();
+            }
+        }
+
+        ~RingLease()
+        {
+            Registry &state = registry();
+            std::lock_guard<std::mutex> guard(state.lock);
+            state.idle.push_back(ring);
+        }
+    };
+
+    // Oldest first
+    template <typename Visit>
+    static void forEachRetained(const Ring &ring, Visit visit)
+    {
+        uint64_t head = ring.head.load(std::memory_order_acquire);
+        for (uint64_t i = head > RING_CAPACITY ? head - RING_CAPACITY : 0; i < head; i++)
+            visit(ring.events[i & (RING_CAPACITY - 1)]);
+    }
+
+    // Never destroyed, so spans closing during shutdown still have a home
+    static Registry &registry()
+    {
+        static Registry *state = new Registry();
+        return *state;
+    }
+
+    static Ring &localRing()
+    {
+        thread_local Ring *ring = nullptr; // trivially initialized: no TLS guard on the hot path
+        if (!ring)
+        {
+            thread_local RingLease lease;
+            ring = lease.ring;
+        }
+        return *ring;
+    }
+};
+
+#ifdef PLAYWISE_TRACING
+#define PW_TRACE_CONCAT_INNER(a, b) a##b
+#define PW_TRACE_CONCAT(a, b) PW_TRACE_CONCAT_INNER(a, b)
+#define PW_TRACE_SPAN(name) SpanTracer::Span PW_TRACE_CONCAT(trace_span_, __LINE__)(name)
+#else
+#define PW_TRACE_SPAN(name) ((void)0)
+#endif
+
+/**
+ * Collation key for title/artist sorting, computed once at ingest
+ * Case-folded, Latin-1 accents folded to ASCII and optionally stripped of a
+ * leading article ("The Beatles" sorts with "Beatles"). The first 8 bytes are
+ * packed big-endian into an integer, so most comparisons resolve on a single
+ * integer compare and only ties look at the full key.
+ */
+struct CollationKey
+{
+    uint64_t prefix;
+    std::string folded;
+
+    CollationKey() : prefix(0) {}
+
+    /**
+     * Build the key for a piece of text
+     * Time Complexity: O(m) where m is the text length
+     * Space Complexity: O(m)
+     */
+    static CollationKey build(const std::string &text, bool stripArticle = true)
+    {
+        CollationKey key;
+        key.folded.reserve(text.size());
+
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            unsigned char c = text[i];
+            // Two-byte UTF-8 for U+00C0..U+00FF
+            if (c == 0xC3 && i + 1 < text.size() && (static_cast<unsigned char>(text[i + 1]) & 0xC0) == 0x80)
+            {
+                const char *ascii = foldLatin1(0xC0 | (static_cast<unsigned char>(text[i + 1]) & 0x3F));
+                if (ascii)
+                {
+                    key.folded += ascii;
+                    i++;
+                    continue;
+                }
+            }
+            key.folded += static_cast<char>(std::tolower(c));
+        }
+
+        if (stripArticle)
+        {
+            static const char *articles[] = {"the ", "a ", "an "};
+            for (const char *article : articles)
+            {
+                size_t length = std::char_traits<char>::length(article);
+                if (key.folded.size() > length && key.folded.compare(0, length, article) == 0)
+                {
+                    key.folded.erase(0, length);
+                    break;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < 8; i++)
+        {
+            key.prefix <<= 8;
+            if (i < key.folded.size())
+                key.prefix |= static_cast<unsigned char>(key.folded[i]);
+        }
+        return key;
+    }
+
+    int compare(const CollationKey &other) const
+    {
+        if (prefix != other.prefix)
+            return prefix < other.prefix ? -1 : 1;
+        return folded.compare(other.folded);
+    }
+
+private:
+    // ASCII spelling of a Latin-1 letter, nullptr for anything else
+    static const char *foldLatin1(unsigned int codepoint)
+    {
+        static const char *table[64] = {
+            "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+            "d", "n", "o", "o", "o", "o", "o", nullptr, "o", "u", "u", "u", "u", "y", "th", "ss",
+            "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+            "d", "n", "o", "o", "o", "o", "o", nullptr, "o", "u", "u", "u", "u", "y", "th", "y"};
+        if (codepoint < 0xC0 || codepoint > 0xFF)
+            return nullptr;
+        return table[codepoint - 0xC0];
+    }
+};
+
 /**
  * Song class - represents a single song with metadata
  */
@@ -32,12 +376,43 @@ public:
     int rating;        // 1-5 stars
     int play_count;    // Track how many times song has been played
     std::chrono::system_clock::time_point added_time;
+    CollationKey title_key;  // Sort keys, see refreshSortKeys
+    CollationKey artist_key;
+    uint32_t handle;         // Dense per-engine index for compact side tables
 
     Song(const std::string &id, const std::string &title,
          const std::string &artist, int duration, int rating = 0,
          const std::string &genre = "Unknown")
         : id(id), title(title), artist(artist), genre(genre), duration(duration),
-          rating(rating), play_count(0), added_time(std::chrono::system_clock::now()) {}
+          rating(rating), play_count(0), added_time(std::chrono::system_clock::now()), handle(0)
+    {
+        refreshSortKeys();
+    }
+
+    // Bulk ingest: strings are moved in and the add time is stamped by the caller
+    Song(std::string id, std::string title, std::string artist, std::string genre, int duration, int rating,
+         std::chrono::system_clock::time_point added_time)
+        : id(std::move(id)), title(std::move(title)), artist(std::move(artist)), genre(std::move(genre)),
+          duration(duration), rating(rating), play_count(0), added_time(added_time), handle(0)
+    {
+        refreshSortKeys();
+    }
+
+    // Restore a saved song with its previously computed collation keys
+    Song(std::string id, std::string title, std::string artist, std::string genre, int duration, int rating,
+         CollationKey title_key, CollationKey artist_key, std::chrono::system_clock::time_point added_time)
+        : id(std::move(id)), title(std::move(title)), artist(std::move(artist)), genre(std::move(genre)),
+          duration(duration), rating(rating), play_count(0), added_time(added_time),
+          title_key(std::move(title_key)), artist_key(std::move(artist_key)), handle(0)
+    {
+    }
+
+    // Recompute collation keys - call after changing title or artist
+    void refreshSortKeys(bool stripArticles = true)
+    {
+        title_key = CollationKey::build(title, stripArticles);
+        artist_key = CollationKey::build(artist, stripArticles);
+    }
 
     std::string toString() const
     {
@@ -64,12 +439,18 @@ public:
     Song *song;
     PlaylistNode *next;
     PlaylistNode *prev;
+    PlaylistNode *next_same; // Other nodes holding the same song, for removal without a scan
+    PlaylistNode *prev_same;
 
-    PlaylistNode(Song *s) : song(s), next(nullptr), prev(nullptr) {}
+    PlaylistNode(Song *s = nullptr) : song(s), next(nullptr), prev(nullptr), next_same(nullptr), prev_same(nullptr) {}
 };
 
 /**
  * Playlist Engine using Doubly Linked List
+ * Nodes come from blocks owned by the playlist; deleted nodes go on a free
+ * list for reuse, and a bulk append takes a single block for the whole batch.
+ * Nodes holding the same song are chained from a per-handle table, so every
+ * occurrence of a song can be removed without walking the playlist.
  * Time Complexity: O(n) for most operations, O(1) for add_song at end
  * Space Complexity: O(n) where n is number of songs
  */
@@ -79,9 +460,17 @@ private:
     PlaylistNode *head;
     PlaylistNode *tail;
     int size;
+    uint64_t revision;                                     // Bumped whenever songs are added or removed
+    std::vector<std::unique_ptr<PlaylistNode[]>> node_blocks; // Storage for every node
+    PlaylistNode *free_nodes;                              // Unused nodes, chained through next
+    size_t node_capacity;                                  // Nodes across all blocks
+    std::vector<PlaylistNode *> nodes_of;                  // Song handle -> a node holding it, via next_same
+
+    static constexpr size_t MIN_BLOCK_NODES = 16;
+    static constexpr size_t MAX_BLOCK_NODES = 4096;
 
 public:
-    PlaylistEngine() : head(nullptr), tail(nullptr), size(0) {}
+    PlaylistEngine() : head(nullptr), tail(nullptr), size(0), revision(0), free_nodes(nullptr), node_capacity(0) {}
 
     ~PlaylistEngine()
     {
@@ -95,19 +484,33 @@ public:
      */
     void add_song(Song *song)
     {
-        PlaylistNode *newNode = new PlaylistNode(song);
+        if (!free_nodes)
+            allocateBlock(std::min(std::max(node_capacity, MIN_BLOCK_NODES), MAX_BLOCK_NODES));
+        linkAtEnd(takeNode(song));
+        size++;
+        revision++;
+    }
+
+    /**
+     * Append songs to the end of the playlist, in order
+     * Nodes that are not recycled come from one allocation for the whole batch
+     * Time Complexity: O(b) for b songs
+     * Space Complexity: O(b)
+     */
+    void append_songs(Song *const *songs, size_t count)
+    {
+        size_t recycled = 0;
+        for (PlaylistNode *node = free_nodes; node && recycled < count; node = node->next)
+            recycled++;
+        if (recycled < count)
+            allocateBlock(count - recycled);
 
-        if (!head)
-        {
-            head = tail = newNode;
-        }
-        else
+        for (size_t i = 0; i < count; i++)
         {
-            tail->next = newNode;
-            newNode->prev = tail;
-            tail = newNode;
+            linkAtEnd(takeNode(songs[i]));
         }
-        size++;
+        size += static_cast<int>(count);
+        revision++;
     }
 
     /**
@@ -124,27 +527,37 @@ public:
         if (!current)
             return false;
 
-        if (current->prev)
-        {
-            current->prev->next = current->next;
-        }
-        else
-        {
-            head = current->next;
-        }
+        unlinkNode(current);
+        releaseNode(current);
+        size--;
+        revision++;
+        return true;
+    }
 
-        if (current->next)
-        {
-            current->next->prev = current->prev;
-        }
-        else
+    /**
+     * Remove every occurrence of a song
+     * Time Complexity: O(k) for k occurrences
+     * Space Complexity: O(1)
+     */
+    int remove_all(Song *song)
+    {
+        int removed = 0;
+        PlaylistNode *node = song->handle < nodes_of.size() ? nodes_of[song->handle] : nullptr;
+        while (node)
         {
-            tail = current->prev;
+            PlaylistNode *next = node->next_same;
+            if (node->song == song) // Songs outside a catalog may share a handle
+            {
+                unlinkNode(node);
+                releaseNode(node);
+                size--;
+                removed++;
+            }
+            node = next;
         }
-
-        delete current;
-        size--;
-        return true;
+        if (removed)
+            revision++;
+        return removed;
     }
 
     /**
@@ -241,6 +654,7 @@ public:
      */
     std::vector<Song *> getAllSongs() const
     {
+        PW_TRACE_SPAN("getAllSongs");
         std::vector<Song *> songs;
         PlaylistNode *current = head;
         while (current)
@@ -258,6 +672,7 @@ public:
      */
     void rebuildFromVector(const std::vector<Song *> &songs)
     {
+        PW_TRACE_SPAN("rebuildFromVector");
         clear();
         for (Song *song : songs)
         {
@@ -278,6 +693,12 @@ public:
     }
 
     int getSize() const { return size; }
+    uint64_t getRevision() const { return revision; }
+    size_t memoryBytes() const
+    {
+        return node_capacity * sizeof(PlaylistNode) + node_blocks.capacity() * sizeof(node_blocks[0]) +
+               nodes_of.capacity() * sizeof(PlaylistNode *);
+    }
 
 private:
     PlaylistNode *getNodeAt(int index)
@@ -307,41 +728,142 @@ private:
 
     void clear()
     {
+        // Songs may already be gone when the playlist is destroyed, so drop the chains wholesale
+        std::fill(nodes_of.begin(), nodes_of.end(), nullptr);
         while (head)
         {
             PlaylistNode *temp = head;
             head = head->next;
-            delete temp;
+            temp->song = nullptr;
+            temp->next_same = temp->prev_same = nullptr;
+            releaseNode(temp);
         }
         tail = nullptr;
         size = 0;
+        revision++;
+    }
+
+    // Add a block of nodes to the free list
+    void allocateBlock(size_t count)
+    {
+        PlaylistNode *block = new PlaylistNode[count];
+        node_blocks.emplace_back(block);
+        for (size_t i = count; i-- > 0;)
+        {
+            block[i].next = free_nodes;
+            free_nodes = &block[i];
+        }
+        node_capacity += count;
+    }
+
+    PlaylistNode *takeNode(Song *song)
+    {
+        PlaylistNode *node = free_nodes;
+        free_nodes = node->next;
+        node->song = song;
+        node->next = nullptr;
+        node->prev = nullptr;
+
+        if (song->handle >= nodes_of.size())
+            nodes_of.resize(song->handle + 1, nullptr);
+        node->prev_same = nullptr;
+        node->next_same = nodes_of[song->handle];
+        if (node->next_same)
+            node->next_same->prev_same = node;
+        nodes_of[song->handle] = node;
+        return node;
+    }
+
+    // Return a node to the free list; it must already be out of the playlist
+    void releaseNode(PlaylistNode *node)
+    {
+        if (node->prev_same)
+            node->prev_same->next_same = node->next_same;
+        else if (node->song && node->song->handle < nodes_of.size() && nodes_of[node->song->handle] == node)
+            nodes_of[node->song->handle] = node->next_same;
+        if (node->next_same)
+            node->next_same->prev_same = node->prev_same;
+
+        node->song = nullptr;
+        node->prev = nullptr;
+        node->next_same = node->prev_same = nullptr;
+        node->next = free_nodes;
+        free_nodes = node;
+    }
+
+    void unlinkNode(PlaylistNode *node)
+    {
+        if (node->prev)
+            node->prev->next = node->next;
+        else
+            head = node->next;
+
+        if (node->next)
+            node->next->prev = node->prev;
+        else
+            tail = node->prev;
+    }
+
+    void linkAtEnd(PlaylistNode *node)
+    {
+        if (!head)
+        {
+            head = tail = node;
+        }
+        else
+        {
+            tail->next = node;
+            node->prev = tail;
+            tail = node;
+        }
     }
 };
 
 /**
  * Playback History using Stack
- * Time Complexity: O(1) for push/pop operations
+ * Backed by a vector so the most recent plays can be read without copying.
+ * Each play links to the previous play of the same song, so removing a song
+ * blanks exactly its plays; blanks are skipped on read and compacted away
+ * once they outnumber the live plays.
+ * Time Complexity: O(1) amortized for push/pop operations
  * Space Complexity: O(n) where n is number of played songs
  */
 class PlaybackHistory
 {
 private:
-    std::stack<Song *> history;
+    struct Play
+    {
+        Song *song;             // Null once the song has been removed
+        uint32_t previous_play; // Index of the previous play with the same handle
+    };
+
+    static constexpr uint32_t NO_PLAY = UINT32_MAX;
+
+    std::vector<Play> history;          // Top of the stack is the back, never a removed play
+    std::vector<uint32_t> last_play_of; // Song handle -> index of its latest play
+    size_t removed;                     // Blanked plays still in history
+    uint64_t revision;                  // Bumped on every push/pop
 
 public:
+    PlaybackHistory() : removed(0), revision(0) {}
+
     /**
      * Add song to playback history
-     * Time Complexity: O(1)
+     * Time Complexity: O(1) amortized
      * Space Complexity: O(1)
      */
     void play_song(Song *song)
     {
-        history.push(song);
+        if (song->handle >= last_play_of.size())
+            last_play_of.resize(song->handle + 1, NO_PLAY);
+        history.push_back({song, last_play_of[song->handle]});
+        last_play_of[song->handle] = static_cast<uint32_t>(history.size() - 1);
+        revision++;
     }
 
     /**
      * Undo last played song and return it
-     * Time Complexity: O(1)
+     * Time Complexity: O(1) amortized
      * Space Complexity: O(1)
      */
     Song *undo_last_play()
@@ -349,32 +871,104 @@ public:
         if (history.empty())
             return nullptr;
 
-        Song *lastPlayed = history.top();
-        history.pop();
-        return lastPlayed;
+        Play last = history.back();
+        history.pop_back();
+        last_play_of[last.song->handle] = last.previous_play;
+        trimRemoved();
+        revision++;
+        return last.song;
     }
 
     /**
-     * Get recently played songs (up to n)
-     * Time Complexity: O(min(n, stack_size))
-     * Space Complexity: O(min(n, stack_size))
+     * Remove every play of a song
+     * Time Complexity: O(k) for k plays of the song, O(n) amortized compaction
+     * Space Complexity: O(1)
      */
-    std::vector<Song *> getRecentlyPlayed(int n = 5)
+    int remove_all(Song *song)
     {
-        std::vector<Song *> recent;
-        std::stack<Song *> temp = history;
+        if (song->handle >= last_play_of.size())
+            return 0;
 
-        while (!temp.empty() && recent.size() < static_cast<size_t>(n))
+        int count = 0;
+        uint32_t *link = &last_play_of[song->handle];
+        while (*link != NO_PLAY)
         {
-            recent.push_back(temp.top());
-            temp.pop();
+            Play &play = history[*link];
+            if (play.song == song) // Songs outside a catalog may share a handle
+            {
+                *link = play.previous_play;
+                play.song = nullptr;
+                count++;
+            }
+            else
+            {
+                link = &play.previous_play;
+            }
         }
+        if (count == 0)
+            return 0;
+
+        removed += count;
+        trimRemoved();
+        if (removed > 64 && removed > history.size() - removed)
+            compact();
+        revision++;
+        return count;
+    }
 
-        return recent;
+    /**
+     * Get recently played songs (up to n)
+     * Time Complexity: O(min(n, stack_size)) plus any removed plays passed over
+     * Space Complexity: O(min(n, stack_size))
+     */
+    std::vector<Song *> getRecentlyPlayed(int n = 5) const
+    {
+        size_t count = std::min(history.size() - removed, static_cast<size_t>(std::max(n, 0)));
+        std::vector<Song *> songs;
+        songs.reserve(count);
+        for (auto it = history.rbegin(); songs.size() < count; ++it)
+        {
+            if (it->song)
+                songs.push_back(it->song);
+        }
+        return songs;
     }
 
     bool isEmpty() const { return history.empty(); }
-    int size() const { return history.size(); }
+
+    size_t memoryBytes() const { return history.capacity() * sizeof(Play) + last_play_of.capacity() * sizeof(uint32_t); }
+    int size() const { return history.size() - removed; }
+    uint64_t getRevision() const { return revision; }
+
+private:
+    void trimRemoved()
+    {
+        while (!history.empty() && !history.back().song)
+        {
+            history.pop_back();
+            removed--;
+        }
+    }
+
+    // Drop blanked plays and relink the survivors
+    void compact()
+    {
+        size_t kept = 0;
+        for (const Play &play : history)
+        {
+            if (play.song)
+                last_play_of[play.song->handle] = NO_PLAY;
+        }
+        for (const Play &play : history)
+        {
+            if (!play.song)
+                continue;
+            history[kept] = {play.song, last_play_of[play.song->handle]};
+            last_play_of[play.song->handle] = static_cast<uint32_t>(kept++);
+        }
+        history.resize(kept);
+        removed = 0;
+    }
 };
 
 /**
@@ -400,6 +994,7 @@ class SongRatingTree
 {
 private:
     RatingNode *root;
+    std::vector<uint32_t> slot_of; // Song handle -> index in its rating bucket
 
 public:
     SongRatingTree() : root(nullptr) {}
@@ -420,6 +1015,44 @@ public:
             return; // Invalid rating
         song->rating = rating;
         root = insertHelper(root, song, rating);
+        RatingNode *node = searchHelper(root, rating);
+        recordSlots(node, node->songs.size() - 1);
+    }
+
+    /**
+     * Insert a batch of songs under their current ratings
+     * Songs are grouped by rating first, so each bucket is found (or created)
+     * and grown once per batch; unrated songs are skipped
+     * Time Complexity: O(b + r log n) for b songs over r distinct ratings
+     * Space Complexity: O(b)
+     */
+    void insert_songs(const std::vector<Song *> &songs)
+    {
+        std::vector<Song *> by_rating[6];
+        for (Song *song : songs)
+        {
+            if (song->rating >= 1 && song->rating <= 5)
+                by_rating[song->rating].push_back(song);
+        }
+
+        for (int rating = 1; rating <= 5; rating++)
+        {
+            if (by_rating[rating].empty())
+                continue;
+            RatingNode *node = searchHelper(root, rating);
+            size_t first = node ? node->songs.size() : 0;
+            if (!node)
+            {
+                root = insertHelper(root, by_rating[rating].front(), rating);
+                node = searchHelper(root, rating);
+                node->songs.insert(node->songs.end(), by_rating[rating].begin() + 1, by_rating[rating].end());
+            }
+            else
+            {
+                node->songs.insert(node->songs.end(), by_rating[rating].begin(), by_rating[rating].end());
+            }
+            recordSlots(node, first);
+        }
     }
 
     /**
@@ -427,7 +1060,7 @@ public:
      * Time Complexity: O(log n) to find node + O(m) where m is songs with that rating
      * Space Complexity: O(m) for return vector
      */
-    std::vector<Song *> search_by_rating(int rating)
+    std::vector<Song *> search_by_rating(int rating) const
     {
         RatingNode *node = searchHelper(root, rating);
         if (node)
@@ -446,17 +1079,48 @@ public:
     }
 
     /**
-     * Get song count by rating for dashboard
-     * Time Complexity: O(n) where n is number of rating nodes
+     * Remove a song from the bucket of its current rating
+     * The bucket's last song takes its slot
+     * Time Complexity: O(log n) to find the bucket, O(1) to remove
      * Space Complexity: O(1)
      */
-    std::unordered_map<int, int> getSongCountByRating()
+    bool remove_song(Song *song)
     {
-        std::unordered_map<int, int> counts;
+        RatingNode *node = searchHelper(root, song->rating);
+        if (!node || song->handle >= slot_of.size())
+            return false;
+        uint32_t slot = slot_of[song->handle];
+        if (slot >= node->songs.size() || node->songs[slot] != song)
+            return false;
+
+        node->songs[slot] = node->songs.back();
+        node->songs.pop_back();
+        if (slot < node->songs.size())
+            slot_of[node->songs[slot]->handle] = slot;
+        return true;
+    }
+
+    /**
+     * Get song count by rating for dashboard
+     * Time Complexity: O(n) where n is number of rating nodes
+     * Space Complexity: O(1)
+     */
+    std::unordered_map<int, int> getSongCountByRating() const
+    {
+        std::unordered_map<int, int> counts;
         countHelper(root, counts);
         return counts;
     }
 
+    /**
+     * Rating nodes, their song buckets and the slot table
+     * Time Complexity: O(r) where r is number of rating nodes
+     * Space Complexity: O(h) recursion for tree height h
+     */
+    size_t memoryBytes() const { return memoryHelper(root) + slot_of.capacity() * sizeof(uint32_t); }
+
+    size_t nodeCount() const { return nodeCountHelper(root); }
+
 private:
     RatingNode *insertHelper(RatingNode *node, Song *song, int rating)
     {
@@ -483,7 +1147,7 @@ private:
         return node;
     }
 
-    RatingNode *searchHelper(RatingNode *node, int rating)
+    RatingNode *searchHelper(RatingNode *node, int rating) const
     {
         if (!node || node->rating == rating)
             return node;
@@ -506,7 +1170,9 @@ private:
         {
             if ((*it)->id == song_id)
             {
+                size_t slot = it - songs.begin();
                 songs.erase(it);
+                recordSlots(node, slot);
                 return true;
             }
         }
@@ -515,7 +1181,19 @@ private:
         return deleteHelper(node->left, song_id) || deleteHelper(node->right, song_id);
     }
 
-    void countHelper(RatingNode *node, std::unordered_map<int, int> &counts)
+    // Refresh the back-references of a bucket's songs from index first on
+    void recordSlots(RatingNode *node, size_t first)
+    {
+        for (size_t i = first; i < node->songs.size(); i++)
+        {
+            uint32_t handle = node->songs[i]->handle;
+            if (handle >= slot_of.size())
+                slot_of.resize(handle + 1, 0);
+            slot_of[handle] = static_cast<uint32_t>(i);
+        }
+    }
+
+    void countHelper(RatingNode *node, std::unordered_map<int, int> &counts) const
     {
         if (!node)
             return;
@@ -525,6 +1203,19 @@ private:
         countHelper(node->right, counts);
     }
 
+    size_t memoryHelper(const RatingNode *node) const
+    {
+        if (!node)
+            return 0;
+        return sizeof(RatingNode) + node->songs.capacity() * sizeof(Song *) +
+               memoryHelper(node->left) + memoryHelper(node->right);
+    }
+
+    size_t nodeCountHelper(const RatingNode *node) const
+    {
+        return node ? 1 + nodeCountHelper(node->left) + nodeCountHelper(node->right) : 0;
+    }
+
     void clear(RatingNode *node)
     {
         if (!node)
@@ -536,790 +1227,7700 @@ private:
 };
 
 /**
- * Instant Song Lookup using HashMap
- * Time Complexity: O(1) average for lookup, O(n) worst case
- * Space Complexity: O(n) where n is number of songs
+ * Open-addressing hash index from a song field to the song
+ * Keys are not copied: a slot holds the key's hash and the Song pointer, and
+ * the key is compared through the song. Linear probing on a power-of-two
+ * table kept at most 3/4 full. Songs sharing a key sit along one probe run
+ * in insertion order, so the same table serves unique and multi-valued
+ * indexes. Deletion shifts the rest of the run back instead of leaving
+ * tombstones, which keeps that order.
+ * Time Complexity: O(1) average per operation
+ * Space Complexity: O(n) slots of 16 bytes
  */
-class InstantLookup
+template <std::string Song::*Key>
+class SongKeyIndex
 {
 private:
-    std::unordered_map<std::string, Song *> id_map;
-    std::unordered_map<std::string, std::vector<Song *>> title_map;
+    struct Slot
+    {
+        uint64_t hash;
+        Song *song; // nullptr when empty
+    };
+
+    std::vector<Slot> slots;
+    size_t count;
 
 public:
-    /**
-     * Add song to lookup tables
-     * Time Complexity: O(1) average
-     * Space Complexity: O(1)
-     */
-    void add_song(Song *song)
-    {
-        id_map[song->id] = song;
-        title_map[song->title].push_back(song);
-    }
+    SongKeyIndex() : count(0) {}
+
+    // Slot positions depend on this hash, so persisted layouts record its fingerprint
+    static uint64_t hashOf(std::string_view key) { return std::hash<std::string_view>()(key); }
 
     /**
-     * Remove song from lookup tables
-     * Time Complexity: O(1) for ID lookup + O(k) for title lookup where k is songs with same title
-     * Space Complexity: O(1)
+     * Index a song, replacing any song already indexed under the same key
      */
-    void remove_song(const std::string &song_id)
+    void assign(Song *song)
     {
-        auto it = id_map.find(song_id);
-        if (it != id_map.end())
+        uint64_t hash = hashOf(song->*Key);
+        if (!slots.empty())
         {
-            Song *song = it->second;
-            id_map.erase(it);
-
-            // Remove from title map
-            auto &title_songs = title_map[song->title];
-            title_songs.erase(
-                std::remove_if(title_songs.begin(), title_songs.end(),
-                               [song_id](Song *s)
-                               { return s->id == song_id; }),
-                title_songs.end());
-
-            if (title_songs.empty())
+            for (size_t i = hash & mask(); slots[i].song; i = (i + 1) & mask())
             {
-                title_map.erase(song->title);
+                if (slots[i].hash == hash && slots[i].song->*Key == song->*Key)
+                {
+                    slots[i].song = song;
+                    return;
+                }
             }
         }
+        place(hash, song);
     }
 
     /**
-     * Lookup song by ID
-     * Time Complexity: O(1) average
-     * Space Complexity: O(1)
+     * Index a song after any others with the same key
      */
-    Song *lookup_by_id(const std::string &id)
+    void append(Song *song) { place(hashOf(song->*Key), song); }
+
+    Song *find(std::string_view key) const
     {
-        auto it = id_map.find(id);
-        return (it != id_map.end()) ? it->second : nullptr;
+        if (slots.empty())
+            return nullptr;
+        uint64_t hash = hashOf(key);
+        for (size_t i = hash & mask(); slots[i].song; i = (i + 1) & mask())
+        {
+            if (slots[i].hash == hash && slots[i].song->*Key == key)
+                return slots[i].song;
+        }
+        return nullptr;
     }
 
     /**
-     * Lookup songs by title
-     * Time Complexity: O(1) average
-     * Space Complexity: O(k) where k is number of songs with that title
+     * Every song indexed under key, in insertion order
+     * Time Complexity: O(r) for a probe run of length r
      */
-    std::vector<Song *> lookup_by_title(const std::string &title)
+    std::vector<Song *> findAll(std::string_view key) const
     {
-        auto it = title_map.find(title);
-        return (it != title_map.end()) ? it->second : std::vector<Song *>();
+        std::vector<Song *> found;
+        if (slots.empty())
+            return found;
+        uint64_t hash = hashOf(key);
+        for (size_t i = hash & mask(); slots[i].song; i = (i + 1) & mask())
+        {
+            if (slots[i].hash == hash && slots[i].song->*Key == key)
+                found.push_back(slots[i].song);
+        }
+        return found;
     }
-};
-
-/**
- * Sorting utilities with different algorithms
- */
-class PlaylistSorter
-{
-public:
-    enum SortCriteria
-    {
-        TITLE_ASC,
-        TITLE_DESC,
-        DURATION_ASC,
-        DURATION_DESC,
-        RECENTLY_ADDED
-    };
 
     /**
-     * Merge Sort implementation
-     * Time Complexity: O(n log n)
-     * Space Complexity: O(n)
+     * Remove this exact song
+     * Time Complexity: O(r) for the probe run
      */
-    static void mergeSort(std::vector<Song *> &songs, SortCriteria criteria)
+    bool erase(Song *song)
     {
-        mergeSortHelper(songs, 0, songs.size() - 1, criteria);
+        if (slots.empty())
+            return false;
+
+        size_t hole = hashOf(song->*Key) & mask();
+        while (slots[hole].song && slots[hole].song != song)
+            hole = (hole + 1) & mask();
+        if (!slots[hole].song)
+            return false;
+
+        // Pull back every later entry of the run that may legally sit in the hole
+        for (size_t next = (hole + 1) & mask(); slots[next].song; next = (next + 1) & mask())
+        {
+            size_t home = slots[next].hash & mask();
+            if (((next - home) & mask()) >= ((next - hole) & mask()))
+            {
+                slots[hole] = slots[next];
+                hole = next;
+            }
+        }
+        slots[hole] = Slot{0, nullptr};
+        count--;
+        return true;
     }
 
     /**
-     * Quick Sort implementation
-     * Time Complexity: O(n log n) average, O(n²) worst case
-     * Space Complexity: O(log n) for recursion stack
+     * Size the table for n songs so inserts never rehash
      */
-    static void quickSort(std::vector<Song *> &songs, SortCriteria criteria)
+    void reserve(size_t n)
     {
-        quickSortHelper(songs, 0, songs.size() - 1, criteria);
+        size_t capacity = 16;
+        while (capacity * 3 < n * 4)
+            capacity *= 2;
+        if (capacity > slots.size())
+            rehash(capacity);
     }
 
-private:
-    static bool compare(Song *a, Song *b, SortCriteria criteria)
+    /**
+     * Slot layout as positions in a song table, for persisting
+     * Empty slots are EMPTY_POSITION
+     */
+    template <typename PositionOf>
+    std::vector<uint32_t> slotPositions(PositionOf position_of) const
     {
-        switch (criteria)
+        std::vector<uint32_t> positions(slots.size(), EMPTY_POSITION);
+        for (size_t i = 0; i < slots.size(); i++)
         {
-        case TITLE_ASC:
-            return a->title < b->title;
-        case TITLE_DESC:
-            return a->title > b->title;
-        case DURATION_ASC:
-            return a->duration < b->duration;
-        case DURATION_DESC:
-            return a->duration > b->duration;
-        case RECENTLY_ADDED:
-            return a->added_time > b->added_time;
-        default:
-            return false;
+            if (slots[i].song)
+                positions[i] = position_of(slots[i].song);
         }
+        return positions;
     }
 
-    static void mergeSortHelper(std::vector<Song *> &songs, int left, int right, SortCriteria criteria)
-    {
-        if (left >= right)
-            return;
-
-        int mid = left + (right - left) / 2;
-        mergeSortHelper(songs, left, mid, criteria);
-        mergeSortHelper(songs, mid + 1, right, criteria);
-        merge(songs, left, mid, right, criteria);
-    }
-
-    static void merge(std::vector<Song *> &songs, int left, int mid, int right, SortCriteria criteria)
+    /**
+     * Rebuild from a persisted slot layout without probing
+     * Hashes are computed in one sequential pass over songs, then every slot
+     * is filled in place.
+     * Time Complexity: O(n + capacity)
+     */
+    void restoreSlots(const std::vector<Song *> &songs, const uint32_t *positions, size_t capacity)
     {
-        std::vector<Song *> temp(right - left + 1);
-        int i = left, j = mid + 1, k = 0;
+        std::vector<uint64_t> hashes(songs.size());
+        for (size_t i = 0; i < songs.size(); i++)
+            hashes[i] = hashOf(songs[i]->*Key);
 
-        while (i <= mid && j <= right)
+        slots.assign(capacity, Slot{0, nullptr});
+        count = 0;
+        for (size_t i = 0; i < capacity; i++)
         {
-            if (compare(songs[i], songs[j], criteria))
-            {
-                temp[k++] = songs[i++];
-            }
-            else
+            if (positions[i] != EMPTY_POSITION)
             {
-                temp[k++] = songs[j++];
+                slots[i] = Slot{hashes[positions[i]], songs[positions[i]]};
+                count++;
             }
         }
+    }
 
-        while (i <= mid)
-            temp[k++] = songs[i++];
-        while (j <= right)
-            temp[k++] = songs[j++];
+    static constexpr uint32_t EMPTY_POSITION = UINT32_MAX;
 
-        for (int x = 0; x < k; x++)
-        {
-            songs[left + x] = temp[x];
-        }
-    }
+    size_t size() const { return count; }
+    size_t memoryBytes() const { return slots.capacity() * sizeof(Slot); }
+
+private:
+    size_t mask() const { return slots.size() - 1; }
 
-    static void quickSortHelper(std::vector<Song *> &songs, int low, int high, SortCriteria criteria)
+    void place(uint64_t hash, Song *song)
     {
-        if (low < high)
-        {
-            int pi = partition(songs, low, high, criteria);
-            quickSortHelper(songs, low, pi - 1, criteria);
-            quickSortHelper(songs, pi + 1, high, criteria);
-        }
+        if ((count + 1) * 4 > slots.size() * 3)
+            rehash(slots.empty() ? 16 : slots.size() * 2);
+
+        size_t i = hash & mask();
+        while (slots[i].song)
+            i = (i + 1) & mask();
+        slots[i] = Slot{hash, song};
+        count++;
     }
 
-    static int partition(std::vector<Song *> &songs, int low, int high, SortCriteria criteria)
+    void rehash(size_t capacity)
     {
-        Song *pivot = songs[high];
-        int i = low - 1;
+        std::vector<Slot> old(capacity, Slot{0, nullptr});
+        old.swap(slots);
+        if (old.empty())
+            return;
 
-        for (int j = low; j < high; j++)
+        // Start just past an empty slot so no run is split by the wrap-around,
+        // which keeps equal keys in their original order
+        size_t start = 0;
+        while (old[start].song)
+            start++;
+        for (size_t n = 1; n <= old.size(); n++)
         {
-            if (compare(songs[j], pivot, criteria))
-            {
-                i++;
-                std::swap(songs[i], songs[j]);
-            }
+            const Slot &slot = old[(start + n) % old.size()];
+            if (!slot.song)
+                continue;
+            size_t i = slot.hash & mask();
+            while (slots[i].song)
+                i = (i + 1) & mask();
+            slots[i] = slot;
         }
-        std::swap(songs[i + 1], songs[high]);
-        return i + 1;
     }
 };
 
 /**
- * Recently Skipped Tracker using Deque
- * Maintains a circular buffer of recently skipped songs
- * Time Complexity: O(1) for add/check operations
- * Space Complexity: O(k) where k is max_size (default 10)
+ * Instant Song Lookup using HashMap
+ * Both indexes are open-addressing tables over the songs' own ID and title
+ * strings (see SongKeyIndex), so adding a song allocates nothing.
+ * Time Complexity: O(1) average for lookup, O(n) worst case
+ * Space Complexity: O(n) where n is number of songs
  */
-class RecentlySkippedTracker
+class InstantLookup
 {
 private:
-    std::deque<std::string> skipped_songs; // Song IDs of recently skipped songs
-    size_t max_size;
+    SongKeyIndex<&Song::id> id_index;       // Latest song per ID
+    SongKeyIndex<&Song::title> title_index; // Every song per title, in insertion order
 
 public:
-    RecentlySkippedTracker(size_t max_size = 10) : max_size(max_size) {}
-
     /**
-     * Add a song to the recently skipped list
-     * Time Complexity: O(1)
+     * Add song to lookup tables
+     * Time Complexity: O(1) average
      * Space Complexity: O(1)
      */
-    void addSkippedSong(const std::string &song_id)
+    void add_song(Song *song)
     {
-        // Remove if already exists to avoid duplicates
-        auto it = std::find(skipped_songs.begin(), skipped_songs.end(), song_id);
-        if (it != skipped_songs.end())
-        {
-            skipped_songs.erase(it);
-        }
+        id_index.assign(song);
+        title_index.append(song);
+    }
 
-        // Add to front
-        skipped_songs.push_front(song_id);
+    // Size the tables for a bulk load so they never rehash
+    void reserve(size_t songs)
+    {
+        id_index.reserve(songs);
+        title_index.reserve(songs);
+    }
 
-        // Maintain size limit using sliding window
-        if (skipped_songs.size() > max_size)
+    /**
+     * Remove song from lookup tables
+     * Time Complexity: O(1) for ID lookup + O(k) for title lookup where k is songs with same title
+     * Space Complexity: O(1)
+     */
+    void remove_song(const std::string &song_id)
+    {
+        Song *song = id_index.find(song_id);
+        if (song)
         {
-            skipped_songs.pop_back();
+            id_index.erase(song);
+
+            // Remove from title index
+            for (Song *titled : title_index.findAll(song->title))
+            {
+                if (titled->id == song_id)
+                    title_index.erase(titled);
+            }
         }
     }
 
     /**
-     * Check if a song was recently skipped
-     * Time Complexity: O(k) where k is max_size
+     * Remove one song object from both tables
+     * Time Complexity: O(1) average
      * Space Complexity: O(1)
      */
-    bool wasRecentlySkipped(const std::string &song_id) const
+    void remove_song(Song *song)
     {
-        return std::find(skipped_songs.begin(), skipped_songs.end(), song_id) != skipped_songs.end();
+        id_index.erase(song);
+        title_index.erase(song);
     }
 
     /**
-     * Get all recently skipped songs
-     * Time Complexity: O(k)
-     * Space Complexity: O(k)
+     * Lookup song by ID
+     * Time Complexity: O(1) average
+     * Space Complexity: O(1)
      */
-    std::vector<std::string> getRecentlySkipped() const
+    Song *lookup_by_id(const std::string &id) const
     {
-        return std::vector<std::string>(skipped_songs.begin(), skipped_songs.end());
+        return id_index.find(id);
     }
 
+    // ID check for parsed fields, without building a std::string
+    bool contains_id(std::string_view id) const { return id_index.find(id) != nullptr; }
+
     /**
-     * Clear the skipped songs list
-     * Time Complexity: O(1)
-     * Space Complexity: O(1)
+     * Lookup songs by title
+     * Time Complexity: O(1) average
+     * Space Complexity: O(k) where k is number of songs with that title
      */
-    void clear()
+    std::vector<Song *> lookup_by_title(const std::string &title) const
     {
-        skipped_songs.clear();
+        return title_index.findAll(title);
+    }
+
+    /**
+     * Persisted form of both indexes, see SongKeyIndex::slotPositions
+     */
+    template <typename PositionOf>
+    void persist(PositionOf position_of, std::vector<uint32_t> &id_slots, std::vector<uint32_t> &title_slots) const
+    {
+        id_slots = id_index.slotPositions(position_of);
+        title_slots = title_index.slotPositions(position_of);
     }
 
-    size_t size() const { return skipped_songs.size(); }
-    bool empty() const { return skipped_songs.empty(); }
+    void restore(const std::vector<Song *> &songs, const uint32_t *id_slots, size_t id_capacity,
+                 const uint32_t *title_slots, size_t title_capacity)
+    {
+        id_index.restoreSlots(songs, id_slots, id_capacity);
+        title_index.restoreSlots(songs, title_slots, title_capacity);
+    }
+
+    size_t memoryBytes() const { return id_index.memoryBytes() + title_index.memoryBytes(); }
+    size_t entryCount() const { return id_index.size() + title_index.size(); }
 };
 
 /**
- * Auto Replay Manager for Genre-based Mood Replay
- * Uses HashMap for play counts and Priority Queue for top-k selection
- * Time Complexity: O(log n) for play count updates, O(n log n) for top-k selection
- * Space Complexity: O(n) where n is number of songs
+ * Stable per-thread index, handed out round-robin on first use
+ * Used to spread threads over shards and reader slots
  */
-class AutoReplayManager
+inline size_t currentThreadSlot()
 {
-private:
-    std::unordered_map<std::string, int> play_counts; // song_id -> play count
-    std::queue<Song *> replay_queue;                  // Queue for auto-replay songs
-    bool auto_replay_enabled;
-    int replay_cycles; // Track how many times we've replayed
+    static std::atomic<size_t> next_slot(0);
+    thread_local size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
 
-public:
-    AutoReplayManager() : auto_replay_enabled(true), replay_cycles(0) {}
+/**
+ * Read-copy-update domain with two-phase grace periods
+ * Readers register in one of two per-slot counters picked by the parity of
+ * a global epoch. A writer that has unpublished an object flips the epoch
+ * and waits for the old parity to drain; after that no reader can still
+ * hold the object and it can be freed. Reader slots are cache-line padded
+ * counters, so any number of threads can share them.
+ * Time Complexity: O(1) to enter/leave a read section, O(S) + reader wait to synchronize
+ * Space Complexity: O(S) for S reader slots
+ */
+class RcuDomain
+{
+private:
+    static const size_t SLOT_COUNT = 64;
 
-    /**
-     * Record a song play and update play count
-     * Time Complexity: O(1) average
-     * Space Complexity: O(1)
-     */
-    void recordPlay(Song *song)
+    struct alignas(64) ReaderSlot
     {
-        if (song)
+        std::atomic<uint32_t> active[2];
+        ReaderSlot()
         {
-            play_counts[song->id]++;
-            song->play_count++;
+            active[0].store(0, std::memory_order_relaxed);
+            active[1].store(0, std::memory_order_relaxed);
         }
-    }
+    };
 
+    ReaderSlot slots[SLOT_COUNT];
+    std::atomic<uint32_t> epoch;
+    std::mutex sync_lock;
+
+public:
     /**
-     * Get top N most played songs from a list, filtered by calming genres
-     * Time Complexity: O(n log n) for sorting
-     * Space Complexity: O(n) for temporary storage
+     * Scope of a read-side critical section
      */
-    std::vector<Song *> getTopCalmingSongs(const std::vector<Song *> &all_songs, int top_n = 3)
+    class ReadGuard
     {
-        // Filter calming songs and create pairs for sorting
-        std::vector<std::pair<int, Song *>> calming_songs;
+    private:
+        ReaderSlot &slot;
+        uint32_t parity;
 
-        for (Song *song : all_songs)
+    public:
+        explicit ReadGuard(RcuDomain &domain) : slot(domain.slots[currentThreadSlot() % SLOT_COUNT]), parity(0)
         {
-            if (song && song->isCalmingGenre() && play_counts[song->id] > 0)
+            for (;;)
             {
-                calming_songs.push_back({play_counts[song->id], song});
+                uint32_t current = domain.epoch.load(std::memory_order_seq_cst);
+                parity = current & 1;
+                slot.active[parity].fetch_add(1, std::memory_order_seq_cst);
+                // A flip in between means the writer may not wait for us; retry in the new epoch
+                if (domain.epoch.load(std::memory_order_seq_cst) == current)
+                    break;
+                slot.active[parity].fetch_sub(1, std::memory_order_release);
             }
         }
 
-        // Sort by play count (descending) using priority queue concept
-        std::sort(calming_songs.begin(), calming_songs.end(),
-                  [](const auto &a, const auto &b)
-                  {
-                      if (a.first == b.first)
-                      {
-                          // If play counts are equal, prefer more recent songs
-                          return a.second->added_time > b.second->added_time;
-                      }
-                      return a.first > b.first;
-                  });
+        ~ReadGuard() { slot.active[parity].fetch_sub(1, std::memory_order_release); }
 
-        // Extract top N songs
-        std::vector<Song *> result;
-        for (int i = 0; i < std::min(top_n, (int)calming_songs.size()); i++)
-        {
-            result.push_back(calming_songs[i].second);
-        }
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+    };
 
-        return result;
-    }
+    RcuDomain() : epoch(0) {}
 
     /**
-     * Setup auto-replay queue with top calming songs
-     * Time Complexity: O(n log n)
+     * Wait until every read section that started before this call has ended
+     * Time Complexity: O(S) plus the length of the longest such read section
+     * Space Complexity: O(1)
+     */
+    void synchronize()
+    {
+        std::lock_guard<std::mutex> lock(sync_lock);
+        uint32_t old_parity = epoch.fetch_add(1, std::memory_order_seq_cst) & 1;
+        for (ReaderSlot &slot : slots)
+        {
+            while (slot.active[old_parity].load(std::memory_order_acquire) != 0)
+                std::this_thread::yield();
+        }
+    }
+};
+
+/**
+ * Read-mostly song index published through RCU
+ * Same lookups as InstantLookup, but readers never lock. Each key maps into
+ * a chained hash table whose entries are immutable once linked: an add
+ * allocates one entry and publishes it with a single release store at the
+ * head of its bucket, so no existing key is copied and no grace period is
+ * needed. Growing the bucket array copies the entries into a new table once
+ * per doubling; the old table is freed after a grace period, as are removed
+ * entries. Readers see every song whose add_song has returned.
+ * Time Complexity: O(1) average lookups, O(1) amortized per add
+ * Space Complexity: O(n)
+ */
+class RcuLookup
+{
+private:
+    struct Entry
+    {
+        size_t hash;
+        std::string key;
+        Song *song;
+        std::atomic<Entry *> next;
+
+        Entry(size_t hash, const std::string &key, Song *song, Entry *next) : hash(hash), key(key), song(song), next(next) {}
+    };
+
+    struct Table
+    {
+        size_t mask;
+        std::unique_ptr<std::atomic<Entry *>[]> buckets;
+
+        explicit Table(size_t capacity) : mask(capacity - 1), buckets(new std::atomic<Entry *>[capacity])
+        {
+            for (size_t i = 0; i < capacity; i++)
+                buckets[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        ~Table()
+        {
+            for (size_t i = 0; i <= mask; i++)
+            {
+                Entry *entry = buckets[i].load(std::memory_order_relaxed);
+                while (entry)
+                {
+                    Entry *next = entry->next.load(std::memory_order_relaxed);
+                    delete entry;
+                    entry = next;
+                }
+            }
+        }
+    };
+
+    /**
+     * One key -> songs table; writers are serialized by RcuLookup::write_lock
+     * Each bucket chain is newest first, so a key's latest song is found first
+     */
+    class Index
+    {
+    private:
+        static constexpr size_t INITIAL_CAPACITY = 64;
+
+        std::atomic<Table *> table;
+        size_t count;
+
+    public:
+        Index() : table(new Table(INITIAL_CAPACITY)), count(0) {}
+        ~Index() { delete table.load(std::memory_order_relaxed); }
+
+        /**
+         * Link a new entry; returns the replaced table after a resize, for the caller to retire
+         * Time Complexity: O(1) amortized
+         */
+        Table *insert(const std::string &key, Song *song)
+        {
+            Table *current = table.load(std::memory_order_relaxed);
+            Table *retired = nullptr;
+            if (count >= current->mask + 1)
+            {
+                retired = current;
+                current = grow(current);
+            }
+            size_t hash = std::hash<std::string>()(key);
+            std::atomic<Entry *> &bucket = current->buckets[hash & current->mask];
+            bucket.store(new Entry(hash, key, song, bucket.load(std::memory_order_relaxed)), std::memory_order_release);
+            count++;
+            return retired;
+        }
+
+        /**
+         * Unlink the entry for (key, song); returns it for the caller to free after a grace period
+         * Time Complexity: O(1) average
+         */
+        Entry *unlink(const std::string &key, Song *song)
+        {
+            Table *current = table.load(std::memory_order_relaxed);
+            size_t hash = std::hash<std::string>()(key);
+            std::atomic<Entry *> *link = &current->buckets[hash & current->mask];
+            for (Entry *entry = link->load(std::memory_order_relaxed); entry; entry = link->load(std::memory_order_relaxed))
+            {
+                if (entry->song == song && entry->hash == hash && entry->key == key)
+                {
+                    // Readers already on the entry still follow its next pointer
+                    link->store(entry->next.load(std::memory_order_relaxed), std::memory_order_release);
+                    count--;
+                    return entry;
+                }
+                link = &entry->next;
+            }
+            return nullptr;
+        }
+
+        /**
+         * Visit the songs stored under key, newest first, until fn returns false
+         * Must run inside an RCU read section
+         */
+        template <typename Fn>
+        void find(const std::string &key, Fn fn) const
+        {
+            const Table *current = table.load(std::memory_order_acquire);
+            size_t hash = std::hash<std::string>()(key);
+            for (const Entry *entry = current->buckets[hash & current->mask].load(std::memory_order_acquire); entry;
+                 entry = entry->next.load(std::memory_order_acquire))
+            {
+                if (entry->hash == hash && entry->key == key && !fn(entry->song))
+                    return;
+            }
+        }
+
+    private:
+        /**
+         * Publish a table of twice the size holding copies of every entry
+         * Readers still in the old table keep using it until it is retired
+         */
+        Table *grow(Table *old)
+        {
+            Table *bigger = new Table((old->mask + 1) * 2);
+            std::vector<Entry *> chain;
+            for (size_t i = 0; i <= old->mask; i++)
+            {
+                chain.clear();
+                for (Entry *entry = old->buckets[i].load(std::memory_order_relaxed); entry;
+                     entry = entry->next.load(std::memory_order_relaxed))
+                    chain.push_back(entry);
+                // Oldest first, so every rebuilt chain stays newest first
+                for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+                {
+                    std::atomic<Entry *> &bucket = bigger->buckets[(*it)->hash & bigger->mask];
+                    bucket.store(new Entry((*it)->hash, (*it)->key, (*it)->song, bucket.load(std::memory_order_relaxed)),
+                                 std::memory_order_relaxed);
+                }
+            }
+            table.store(bigger, std::memory_order_release);
+            return bigger;
+        }
+    };
+
+    Index ids;
+    Index titles;
+    mutable RcuDomain rcu;
+    std::mutex write_lock;
+
+public:
+    RcuLookup() = default;
+    RcuLookup(const RcuLookup &) = delete;
+    RcuLookup &operator=(const RcuLookup &) = delete;
+
+    void add_song(Song *song) { add_songs({song}); }
+
+    /**
+     * Publish a batch of songs; waits for a grace period only if a table grew
+     * Time Complexity: O(b) amortized for b songs
+     * Space Complexity: O(b)
+     */
+    void add_songs(const std::vector<Song *> &songs)
+    {
+        std::lock_guard<std::mutex> lock(write_lock);
+        std::vector<Table *> retired;
+        for (Song *song : songs)
+        {
+            if (Table *old = ids.insert(song->id, song))
+                retired.push_back(old);
+            if (Table *old = titles.insert(song->title, song))
+                retired.push_back(old);
+        }
+        if (retired.empty())
+            return;
+
+        rcu.synchronize();
+        for (Table *table : retired)
+            delete table;
+    }
+
+    /**
+     * Unpublish a song; when this returns no reader can still be inside a
+     * lookup that might return it
+     * Time Complexity: O(1) average plus one grace period
+     * Space Complexity: O(1)
+     */
+    void remove_song(Song *song)
+    {
+        std::lock_guard<std::mutex> lock(write_lock);
+        Entry *retired[] = {ids.unlink(song->id, song), titles.unlink(song->title, song)};
+        rcu.synchronize();
+        delete retired[0];
+        delete retired[1];
+    }
+
+    /**
+     * Lookup song by ID without locking; the newest song wins if an ID repeats
+     * Time Complexity: O(1) average
+     * Space Complexity: O(1)
+     */
+    Song *lookup_by_id(const std::string &id) const
+    {
+        RcuDomain::ReadGuard guard(rcu);
+        Song *found = nullptr;
+        ids.find(id, [&found](Song *song)
+                 {
+            found = song;
+            return false; });
+        return found;
+    }
+
+    /**
+     * Lookup songs by title without locking, in the order they were added
+     * Time Complexity: O(1) average
+     * Space Complexity: O(k) where k is number of songs with that title
+     */
+    std::vector<Song *> lookup_by_title(const std::string &title) const
+    {
+        std::vector<Song *> found;
+        {
+            RcuDomain::ReadGuard guard(rcu);
+            titles.find(title, [&found](Song *song)
+                        {
+                found.push_back(song);
+                return true; });
+        }
+        std::reverse(found.begin(), found.end());
+        return found;
+    }
+
+    RcuDomain &getDomain() { return rcu; }
+};
+
+/**
+ * Sorting utilities with different algorithms
+ */
+class PlaylistSorter
+{
+public:
+    enum SortCriteria
+    {
+        TITLE_ASC,
+        TITLE_DESC,
+        DURATION_ASC,
+        DURATION_DESC,
+        RECENTLY_ADDED,
+        RATING_DESC,
+        MOST_PLAYED,
+        ARTIST_ASC
+    };
+
+    // Below this size the histogram passes cost more than a comparison sort
+    static const size_t RADIX_THRESHOLD = 64;
+
+    /**
+     * Sort using the best algorithm for the criteria
+     * Integer keys (duration, added time, rating, plays) go through radix sort,
+     * string keys use the adaptive merge sort or quick sort
+     * Time Complexity: O(n) for integer keys, O(n log n) otherwise
+     * Space Complexity: O(n)
+     */
+    static void sort(std::vector<Song *> &songs, SortCriteria criteria, bool useQuickSort = false)
+    {
+        PW_TRACE_SPAN("PlaylistSorter::sort");
+        if (hasIntegerKey(criteria) && songs.size() >= RADIX_THRESHOLD)
+        {
+            radixSort(songs, criteria);
+        }
+        else if (useQuickSort)
+        {
+            quickSort(songs, criteria);
+        }
+        else
+        {
+            adaptiveSort(songs, criteria);
+        }
+    }
+
+    static bool hasIntegerKey(SortCriteria criteria)
+    {
+        return criteria == DURATION_ASC || criteria == DURATION_DESC ||
+               criteria == RECENTLY_ADDED || criteria == RATING_DESC ||
+               criteria == MOST_PLAYED;
+    }
+
+    /**
+     * LSD Radix Sort on extracted integer keys
+     * Copies (key, song) pairs into a contiguous buffer so passes never
+     * dereference Song*, then scatters the result back. Stable, so equal
+     * keys keep their playlist order exactly like merge sort.
+     * Byte positions shared by every key are skipped, so durations and
+     * ratings usually need only one or two passes.
+     * Time Complexity: O(n * p) where p <= 8 is the number of varying bytes
+     * Space Complexity: O(n)
+     */
+    static void radixSort(std::vector<Song *> &songs, SortCriteria criteria)
+    {
+        PW_TRACE_SPAN("radixSort");
+        struct KeyedSong
+        {
+            uint64_t key;
+            Song *song;
+        };
+
+        size_t n = songs.size();
+        if (n < 2)
+            return;
+
+        std::vector<KeyedSong> buffer(n);
+        std::vector<KeyedSong> scratch(n);
+        std::vector<std::array<size_t, 256>> counts(8);
+        for (auto &histogram : counts)
+            histogram.fill(0);
+
+        // Extract keys and build all byte histograms in one pass
+        for (size_t i = 0; i < n; i++)
+        {
+            uint64_t key = extractKey(songs[i], criteria);
+            buffer[i] = {key, songs[i]};
+            for (int byte = 0; byte < 8; byte++)
+            {
+                counts[byte][(key >> (byte * 8)) & 0xFF]++;
+            }
+        }
+
+        for (int byte = 0; byte < 8; byte++)
+        {
+            auto &histogram = counts[byte];
+
+            // Every key has the same value in this byte - nothing to do
+            if (histogram[(buffer[0].key >> (byte * 8)) & 0xFF] == n)
+                continue;
+
+            size_t offset = 0;
+            for (size_t &count : histogram)
+            {
+                size_t c = count;
+                count = offset;
+                offset += c;
+            }
+
+            for (const KeyedSong &entry : buffer)
+            {
+                scratch[histogram[(entry.key >> (byte * 8)) & 0xFF]++] = entry;
+            }
+            buffer.swap(scratch);
+        }
+
+        for (size_t i = 0; i < n; i++)
+        {
+            songs[i] = buffer[i].song;
+        }
+    }
+
+    /**
+     * Merge Sort implementation
+     * Time Complexity: O(n log n)
+     * Space Complexity: O(n)
+     */
+    static void mergeSort(std::vector<Song *> &songs, SortCriteria criteria)
+    {
+        PW_TRACE_SPAN("mergeSort");
+        mergeSortHelper(songs, 0, songs.size() - 1, criteria);
+    }
+
+    /**
+     * Quick Sort implementation (introsort)
+     * Median-of-three pivot with three-way partitioning, so sorted input and
+     * runs of equal keys stay O(n log n). Small ranges finish with insertion
+     * sort and heap sort takes over if recursion gets too deep.
+     * Time Complexity: O(n log n) worst case, O(n) for sorted/reversed input
+     * Space Complexity: O(log n) for recursion stack
+     */
+    static void quickSort(std::vector<Song *> &songs, SortCriteria criteria)
+    {
+        PW_TRACE_SPAN("quickSort");
+        int n = songs.size();
+        if (n < 2)
+            return;
+
+        // Already sorted or reverse sorted input costs a single scan
+        int ascending = 1;
+        while (ascending < n && !compare(songs[ascending], songs[ascending - 1], criteria))
+            ascending++;
+        if (ascending == n)
+            return;
+
+        int descending = 1;
+        while (descending < n && !compare(songs[descending - 1], songs[descending], criteria))
+            descending++;
+        if (descending == n)
+        {
+            std::reverse(songs.begin(), songs.end());
+            return;
+        }
+
+        int depthLimit = 0;
+        for (int size = n; size > 1; size >>= 1)
+            depthLimit += 2;
+
+        quickSortHelper(songs, 0, n - 1, depthLimit, criteria);
+    }
+
+    /**
+     * Adaptive natural merge sort (Timsort-like)
+     * Detects existing ascending and strictly descending runs, extends short
+     * runs to a minimum length with binary insertion sort and merges runs
+     * while keeping their lengths balanced. Stable.
+     * Time Complexity: O(n) for presorted input, O(n log n) worst case
+     * Space Complexity: O(n)
+     */
+    static void adaptiveSort(std::vector<Song *> &songs, SortCriteria criteria)
+    {
+        PW_TRACE_SPAN("adaptiveSort");
+        size_t n = songs.size();
+        if (n < 2)
+            return;
+
+        size_t minRun = computeMinRun(n);
+        std::vector<SortRun> runs;
+        std::vector<Song *> buffer;
+
+        size_t start = 0;
+        while (start < n)
+        {
+            size_t runEnd = findRun(songs, start, criteria);
+            size_t length = runEnd - start;
+
+            if (length < minRun)
+            {
+                size_t forced = std::min(minRun, n - start);
+                binaryInsertionSort(songs, start, start + forced, runEnd, criteria);
+                length = forced;
+            }
+
+            runs.push_back({start, length});
+            collapseRuns(songs, runs, buffer, criteria);
+            start += length;
+        }
+
+        while (runs.size() > 1)
+        {
+            mergeRuns(songs, runs, runs.size() - 2, buffer, criteria);
+        }
+    }
+
+    /**
+     * Top-k selection with a bounded heap
+     * Scans the songs once without copying them. The heap root is the
+     * weakest of the current best k, so most songs are rejected in O(1).
+     * Time Complexity: O(n log k)
+     * Space Complexity: O(k)
+     */
+    static std::vector<Song *> topK(const std::vector<Song *> &songs, size_t k, SortCriteria criteria)
+    {
+        std::vector<Song *> heap;
+        if (k == 0)
+            return heap;
+        heap.reserve(k);
+
+        auto better = [criteria](Song *a, Song *b)
+        { return compare(a, b, criteria); };
+
+        for (Song *song : songs)
+        {
+            if (heap.size() < k)
+            {
+                heap.push_back(song);
+                std::push_heap(heap.begin(), heap.end(), better);
+            }
+            else if (better(song, heap.front()))
+            {
+                std::pop_heap(heap.begin(), heap.end(), better);
+                heap.back() = song;
+                std::push_heap(heap.begin(), heap.end(), better);
+            }
+        }
+
+        // Best first
+        std::sort_heap(heap.begin(), heap.end(), better);
+        return heap;
+    }
+
+    /**
+     * Offer a song to a maintained top-k list (kept best first)
+     * Songs tying with an existing entry go after it
+     * Time Complexity: O(k)
+     * Space Complexity: O(1)
+     */
+    static void insertTopK(std::vector<Song *> &top, Song *song, size_t k, SortCriteria criteria)
+    {
+        auto better = [criteria](Song *a, Song *b)
+        { return compare(a, b, criteria); };
+
+        auto pos = std::upper_bound(top.begin(), top.end(), song, better);
+        if (static_cast<size_t>(pos - top.begin()) >= k)
+            return;
+
+        top.insert(pos, song);
+        if (top.size() > k)
+            top.pop_back();
+    }
+
+    /**
+     * Strict weak ordering for the criteria - true if a goes before b
+     */
+    static bool compare(Song *a, Song *b, SortCriteria criteria)
+    {
+        switch (criteria)
+        {
+        case TITLE_ASC:
+            return titleOrder(a, b) < 0;
+        case TITLE_DESC:
+            return titleOrder(a, b) > 0;
+        case ARTIST_ASC:
+        {
+            int order = a->artist_key.compare(b->artist_key);
+            if (order == 0)
+                order = a->artist.compare(b->artist);
+            return order != 0 ? order < 0 : titleOrder(a, b) < 0;
+        }
+        case DURATION_ASC:
+            return a->duration < b->duration;
+        case DURATION_DESC:
+            return a->duration > b->duration;
+        case RECENTLY_ADDED:
+            return a->added_time > b->added_time;
+        case RATING_DESC:
+            return a->rating > b->rating;
+        case MOST_PLAYED:
+            return a->play_count > b->play_count;
+        default:
+            return false;
+        }
+    }
+
+private:
+    /**
+     * Collated title order, falling back to the raw bytes so distinct titles never tie
+     */
+    static int titleOrder(const Song *a, const Song *b)
+    {
+        int order = a->title_key.compare(b->title_key);
+        return order != 0 ? order : a->title.compare(b->title);
+    }
+
+    /**
+     * Map a song to an unsigned key whose ascending order matches the criteria
+     * Signed values get their sign bit flipped, descending orders are inverted
+     */
+    static uint64_t extractKey(const Song *song, SortCriteria criteria)
+    {
+        switch (criteria)
+        {
+        case DURATION_ASC:
+            return static_cast<uint32_t>(song->duration) ^ 0x80000000u;
+        case DURATION_DESC:
+            return ~static_cast<uint64_t>(static_cast<uint32_t>(song->duration) ^ 0x80000000u);
+        case RECENTLY_ADDED:
+            return ~(static_cast<uint64_t>(song->added_time.time_since_epoch().count()) ^ (1ULL << 63));
+        case RATING_DESC:
+            return ~static_cast<uint64_t>(static_cast<uint32_t>(song->rating) ^ 0x80000000u);
+        case MOST_PLAYED:
+            return ~static_cast<uint64_t>(static_cast<uint32_t>(song->play_count) ^ 0x80000000u);
+        default:
+            return 0;
+        }
+    }
+
+    static void mergeSortHelper(std::vector<Song *> &songs, int left, int right, SortCriteria criteria)
+    {
+        if (left >= right)
+            return;
+
+        int mid = left + (right - left) / 2;
+        mergeSortHelper(songs, left, mid, criteria);
+        mergeSortHelper(songs, mid + 1, right, criteria);
+        merge(songs, left, mid, right, criteria);
+    }
+
+    static void merge(std::vector<Song *> &songs, int left, int mid, int right, SortCriteria criteria)
+    {
+        std::vector<Song *> temp(right - left + 1);
+        int i = left, j = mid + 1, k = 0;
+
+        while (i <= mid && j <= right)
+        {
+            if (compare(songs[i], songs[j], criteria))
+            {
+                temp[k++] = songs[i++];
+            }
+            else
+            {
+                temp[k++] = songs[j++];
+            }
+        }
+
+        while (i <= mid)
+            temp[k++] = songs[i++];
+        while (j <= right)
+            temp[k++] = songs[j++];
+
+        for (int x = 0; x < k; x++)
+        {
+            songs[left + x] = temp[x];
+        }
+    }
+
+    // Ranges this small are finished with insertion sort
+    static const int INSERTION_THRESHOLD = 16;
+
+    static void quickSortHelper(std::vector<Song *> &songs, int low, int high, int depthLimit, SortCriteria criteria)
+    {
+        while (high - low + 1 > INSERTION_THRESHOLD)
+        {
+            if (depthLimit-- == 0)
+            {
+                heapSort(songs, low, high, criteria);
+                return;
+            }
+
+            int lt, gt;
+            partition(songs, low, high, lt, gt, criteria);
+
+            // Recurse into the smaller side, loop on the larger one
+            if (lt - low < high - gt)
+            {
+                quickSortHelper(songs, low, lt - 1, depthLimit, criteria);
+                low = gt + 1;
+            }
+            else
+            {
+                quickSortHelper(songs, gt + 1, high, depthLimit, criteria);
+                high = lt - 1;
+            }
+        }
+        insertionSort(songs, low, high, criteria);
+    }
+
+    static void sortThree(std::vector<Song *> &songs, int a, int b, int c, SortCriteria criteria)
+    {
+        if (compare(songs[b], songs[a], criteria))
+            std::swap(songs[b], songs[a]);
+        if (compare(songs[c], songs[a], criteria))
+            std::swap(songs[c], songs[a]);
+        if (compare(songs[c], songs[b], criteria))
+            std::swap(songs[c], songs[b]);
+    }
+
+    /**
+     * Three-way partition around a median-of-three pivot (Tukey's ninther for
+     * large ranges) so organ-pipe and sawtooth inputs still split evenly
+     * Leaves [low, lt) < pivot, [lt, gt] == pivot, (gt, high] > pivot
+     */
+    static void partition(std::vector<Song *> &songs, int low, int high, int &lt, int &gt, SortCriteria criteria)
+    {
+        int mid = low + (high - low) / 2;
+        if (high - low + 1 > 128)
+        {
+            sortThree(songs, low, mid, high, criteria);
+            sortThree(songs, low + 1, mid - 1, high - 1, criteria);
+            sortThree(songs, low + 2, mid + 1, high - 2, criteria);
+            sortThree(songs, mid - 1, mid, mid + 1, criteria);
+        }
+        else
+        {
+            sortThree(songs, low, mid, high, criteria);
+        }
+
+        Song *pivot = songs[mid];
+        lt = low;
+        gt = high;
+        int i = low;
+        while (i <= gt)
+        {
+            if (compare(songs[i], pivot, criteria))
+            {
+                std::swap(songs[lt++], songs[i++]);
+            }
+            else if (compare(pivot, songs[i], criteria))
+            {
+                std::swap(songs[i], songs[gt--]);
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+
+    static void insertionSort(std::vector<Song *> &songs, int low, int high, SortCriteria criteria)
+    {
+        for (int i = low + 1; i <= high; i++)
+        {
+            Song *key = songs[i];
+            int j = i - 1;
+            while (j >= low && compare(key, songs[j], criteria))
+            {
+                songs[j + 1] = songs[j];
+                j--;
+            }
+            songs[j + 1] = key;
+        }
+    }
+
+    static void heapSort(std::vector<Song *> &songs, int low, int high, SortCriteria criteria)
+    {
+        auto less = [criteria](Song *a, Song *b)
+        { return compare(a, b, criteria); };
+        std::make_heap(songs.begin() + low, songs.begin() + high + 1, less);
+        std::sort_heap(songs.begin() + low, songs.begin() + high + 1, less);
+    }
+
+    struct SortRun
+    {
+        size_t start;
+        size_t length;
+    };
+
+    static size_t computeMinRun(size_t n)
+    {
+        size_t r = 0;
+        while (n >= 64)
+        {
+            r |= n & 1;
+            n >>= 1;
+        }
+        return n + r;
+    }
+
+    /**
+     * Find the end of the run starting at start
+     * Strictly descending runs are reversed in place (strictness keeps stability)
+     */
+    static size_t findRun(std::vector<Song *> &songs, size_t start, SortCriteria criteria)
+    {
+        size_t n = songs.size();
+        size_t end = start + 1;
+        if (end == n)
+            return end;
+
+        if (compare(songs[end], songs[end - 1], criteria))
+        {
+            while (end < n && compare(songs[end], songs[end - 1], criteria))
+                end++;
+            std::reverse(songs.begin() + start, songs.begin() + end);
+        }
+        else
+        {
+            while (end < n && !compare(songs[end], songs[end - 1], criteria))
+                end++;
+        }
+        return end;
+    }
+
+    /**
+     * Insertion sort of [start, end) where [start, sortedEnd) is already sorted
+     * Inserts after equal keys so the result stays stable
+     */
+    static void binaryInsertionSort(std::vector<Song *> &songs, size_t start, size_t end,
+                                    size_t sortedEnd, SortCriteria criteria)
+    {
+        auto less = [criteria](Song *a, Song *b)
+        { return compare(a, b, criteria); };
+        for (size_t i = sortedEnd; i < end; i++)
+        {
+            auto pos = std::upper_bound(songs.begin() + start, songs.begin() + i, songs[i], less);
+            std::rotate(pos, songs.begin() + i, songs.begin() + i + 1);
+        }
+    }
+
+    /**
+     * Merge pending runs until the stack satisfies the Timsort invariants
+     * |run[k-2]| > |run[k-1]| + |run[k]| and |run[k-1]| > |run[k]|
+     */
+    static void collapseRuns(std::vector<Song *> &songs, std::vector<SortRun> &runs,
+                             std::vector<Song *> &buffer, SortCriteria criteria)
+    {
+        while (runs.size() > 1)
+        {
+            size_t k = runs.size() - 2;
+            if ((k > 0 && runs[k - 1].length <= runs[k].length + runs[k + 1].length) ||
+                (k > 1 && runs[k - 2].length <= runs[k - 1].length + runs[k].length))
+            {
+                if (runs[k - 1].length < runs[k + 1].length)
+                    k--;
+            }
+            else if (runs[k].length > runs[k + 1].length)
+            {
+                break;
+            }
+            mergeRuns(songs, runs, k, buffer, criteria);
+        }
+    }
+
+    /**
+     * Merge adjacent runs k and k+1, taking from the left run on ties
+     */
+    static void mergeRuns(std::vector<Song *> &songs, std::vector<SortRun> &runs, size_t k,
+                          std::vector<Song *> &buffer, SortCriteria criteria)
+    {
+        size_t left = runs[k].start;
+        size_t mid = left + runs[k].length;
+        size_t right = mid + runs[k + 1].length;
+
+        runs[k].length += runs[k + 1].length;
+        runs.erase(runs.begin() + k + 1);
+
+        // Runs already in order relative to each other need no work
+        if (!compare(songs[mid], songs[mid - 1], criteria))
+            return;
+
+        buffer.assign(songs.begin() + left, songs.begin() + mid);
+        size_t i = 0, j = mid, out = left;
+        while (i < buffer.size() && j < right)
+        {
+            if (compare(songs[j], buffer[i], criteria))
+                songs[out++] = songs[j++];
+            else
+                songs[out++] = buffer[i++];
+        }
+        while (i < buffer.size())
+            songs[out++] = buffer[i++];
+    }
+};
+
+/**
+ * Sorted View Index using balanced BSTs (std::set)
+ * Keeps a materialized ordering of the whole catalog per sort criterion so
+ * switching the playlist order is a linear walk instead of a sort.
+ * Descending criteria share the ascending tree and are walked in reverse.
+ * Songs with equal keys come out in the order they were added, in either
+ * direction, where PlaylistSorter keeps their current playlist order.
+ * Time Complexity: O(v log n) per add/remove where v is the number of views
+ * Space Complexity: O(v * n)
+ */
+class SortedViewIndex
+{
+private:
+    struct ViewOrder
+    {
+        PlaylistSorter::SortCriteria criteria;
+
+        // Ties fall back to add time and then address so every song has a unique slot
+        bool operator()(Song *a, Song *b) const
+        {
+            if (PlaylistSorter::compare(a, b, criteria))
+                return true;
+            if (PlaylistSorter::compare(b, a, criteria))
+                return false;
+            if (a->added_time != b->added_time)
+                return a->added_time < b->added_time;
+            return std::less<Song *>()(a, b);
+        }
+    };
+
+    typedef std::set<Song *, ViewOrder> View;
+    std::unordered_map<int, View> views; // base criteria -> ordered songs
+
+public:
+    /**
+     * Map a criteria to the view that stores it
+     * TITLE_DESC and DURATION_DESC are the reverse walks of the ascending views
+     */
+    static PlaylistSorter::SortCriteria baseCriteria(PlaylistSorter::SortCriteria criteria, bool &reversed)
+    {
+        reversed = false;
+        if (criteria == PlaylistSorter::TITLE_DESC)
+        {
+            reversed = true;
+            return PlaylistSorter::TITLE_ASC;
+        }
+        if (criteria == PlaylistSorter::DURATION_DESC)
+        {
+            reversed = true;
+            return PlaylistSorter::DURATION_ASC;
+        }
+        return criteria;
+    }
+
+    static std::string viewName(PlaylistSorter::SortCriteria criteria)
+    {
+        bool reversed;
+        switch (baseCriteria(criteria, reversed))
+        {
+        case PlaylistSorter::TITLE_ASC:
+            return "by title";
+        case PlaylistSorter::DURATION_ASC:
+            return "by duration";
+        case PlaylistSorter::RECENTLY_ADDED:
+            return "recently added";
+        case PlaylistSorter::RATING_DESC:
+            return "by rating";
+        case PlaylistSorter::MOST_PLAYED:
+            return "most played";
+        case PlaylistSorter::ARTIST_ASC:
+            return "by artist";
+        default:
+            return "unknown";
+        }
+    }
+
+    /**
+     * Materialize a view over the given songs
+     * Time Complexity: O(n log n), once per view
+     * Space Complexity: O(n)
+     */
+    void createView(PlaylistSorter::SortCriteria criteria, const std::vector<Song *> &songs)
+    {
+        bool reversed;
+        PlaylistSorter::SortCriteria base = baseCriteria(criteria, reversed);
+        if (views.count(base))
+            return;
+
+        View view(ViewOrder{base});
+        for (Song *song : songs)
+        {
+            view.insert(song);
+        }
+        views.emplace(base, std::move(view));
+    }
+
+    void dropView(PlaylistSorter::SortCriteria criteria)
+    {
+        bool reversed;
+        views.erase(baseCriteria(criteria, reversed));
+    }
+
+    bool hasView(PlaylistSorter::SortCriteria criteria) const
+    {
+        bool reversed;
+        return views.count(baseCriteria(criteria, reversed)) > 0;
+    }
+
+    /**
+     * Add song to every materialized view
+     * Time Complexity: O(v log n)
+     */
+    void add_song(Song *song)
+    {
+        for (auto &entry : views)
+        {
+            entry.second.insert(song);
+        }
+    }
+
+    /**
+     * Remove song from every materialized view (its keys must be unchanged)
+     * Time Complexity: O(v log n)
+     */
+    void remove_song(Song *song)
+    {
+        for (auto &entry : views)
+        {
+            entry.second.erase(song);
+        }
+    }
+
+    /**
+     * Change a song's sort key without breaking the affected view
+     * The song is taken out under its old key, mutated, then re-inserted
+     * Time Complexity: O(log n) plus the cost of mutate
+     */
+    template <typename Mutator>
+    void update_song(Song *song, PlaylistSorter::SortCriteria affected, Mutator mutate)
+    {
+        bool reversed;
+        auto it = views.find(baseCriteria(affected, reversed));
+        if (it == views.end())
+        {
+            mutate();
+            return;
+        }
+
+        bool present = it->second.erase(song) > 0;
+        mutate();
+        if (present)
+            it->second.insert(song);
+    }
+
+    /**
+     * Visit a view's songs in criteria order
+     * Time Complexity: O(n)
+     * Space Complexity: O(1)
+     */
+    template <typename Visitor>
+    void forEach(PlaylistSorter::SortCriteria criteria, Visitor visit) const
+    {
+        bool reversed;
+        auto it = views.find(baseCriteria(criteria, reversed));
+        if (it == views.end())
+            return;
+
+        if (reversed)
+        {
+            // Walk groups of equal keys from the back, each group front to back
+            const View &view = it->second;
+            auto same_key = [base = it->second.key_comp().criteria](Song *a, Song *b)
+            { return !PlaylistSorter::compare(a, b, base) && !PlaylistSorter::compare(b, a, base); };
+            auto group_end = view.end();
+            while (group_end != view.begin())
+            {
+                auto group_start = std::prev(group_end);
+                while (group_start != view.begin() && same_key(*std::prev(group_start), *group_start))
+                    --group_start;
+                for (auto song = group_start; song != group_end; ++song)
+                    visit(*song);
+                group_end = group_start;
+            }
+        }
+        else
+        {
+            for (Song *song : it->second)
+                visit(song);
+        }
+    }
+
+    std::vector<Song *> getOrdered(PlaylistSorter::SortCriteria criteria) const
+    {
+        std::vector<Song *> ordered;
+        forEach(criteria, [&ordered](Song *song)
+                { ordered.push_back(song); });
+        return ordered;
+    }
+
+    size_t viewCount() const { return views.size(); }
+
+    size_t nodeCount() const
+    {
+        size_t nodes = 0;
+        for (const auto &pair : views)
+            nodes += pair.second.size();
+        return nodes;
+    }
+
+    // Red-black tree nodes: three links and a color word, plus the song pointer
+    size_t memoryBytes() const
+    {
+        return views.bucket_count() * sizeof(void *) + views.size() * (sizeof(std::pair<const int, View>) + sizeof(void *)) +
+               nodeCount() * (4 * sizeof(void *) + sizeof(Song *));
+    }
+};
+
+/**
+ * 64-bit finalizer (splitmix64) used to derive independent sketch hashes
+ */
+inline uint64_t mixHash(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * Count-Min Sketch for approximate play counts
+ * Estimates never undercount; with probability 1 - delta they overcount by
+ * at most epsilon * total. Uses conservative update to tighten estimates.
+ * Time Complexity: O(d) per add/estimate where d = ceil(ln(1/delta))
+ * Space Complexity: O(w * d) counters where w = ceil(e / epsilon)
+ */
+class CountMinSketch
+{
+private:
+    size_t width;
+    size_t depth;
+    std::vector<uint32_t> counters; // depth rows of width counters
+    uint64_t total;
+
+public:
+    CountMinSketch(double epsilon = 0.001, double delta = 0.01)
+        : width(static_cast<size_t>(std::ceil(std::exp(1.0) / epsilon))),
+          depth(static_cast<size_t>(std::ceil(std::log(1.0 / delta)))),
+          total(0)
+    {
+        if (depth == 0)
+            depth = 1;
+        counters.assign(width * depth, 0);
+    }
+
+    void add(const std::string &key, uint32_t count = 1)
+    {
+        uint64_t h1 = std::hash<std::string>()(key);
+        uint64_t h2 = mixHash(h1) | 1;
+
+        // Conservative update: only raise counters that are below the new estimate
+        uint32_t target = estimateHashed(h1, h2) + count;
+        for (size_t row = 0; row < depth; row++)
+        {
+            uint32_t &cell = counters[row * width + (h1 + row * h2) % width];
+            if (cell < target)
+                cell = target;
+        }
+        total += count;
+    }
+
+    uint32_t estimate(const std::string &key) const
+    {
+        uint64_t h1 = std::hash<std::string>()(key);
+        return estimateHashed(h1, mixHash(h1) | 1);
+    }
+
+    void clear()
+    {
+        std::fill(counters.begin(), counters.end(), 0);
+        total = 0;
+    }
+
+    uint64_t getTotal() const { return total; }
+    size_t getWidth() const { return width; }
+    size_t getDepth() const { return depth; }
+    size_t memoryBytes() const { return counters.capacity() * sizeof(uint32_t); }
+
+private:
+    uint32_t estimateHashed(uint64_t h1, uint64_t h2) const
+    {
+        uint32_t result = UINT32_MAX;
+        for (size_t row = 0; row < depth; row++)
+        {
+            result = std::min(result, counters[row * width + (h1 + row * h2) % width]);
+        }
+        return result;
+    }
+};
+
+/**
+ * Counting Bloom Filter with saturating 8-bit counters
+ * Sized from the expected item count and target false positive rate.
+ * Supports removal of items that were added; never gives false negatives
+ * for items that were added and not removed.
+ * Time Complexity: O(k) per operation where k is the number of hashes
+ * Space Complexity: O(m) bytes, m = -n ln(p) / ln(2)^2
+ */
+class CountingBloomFilter
+{
+private:
+    std::vector<uint8_t> counters;
+    size_t hash_count;
+
+public:
+    CountingBloomFilter(size_t expected_items = 1000, double false_positive_rate = 0.01)
+    {
+        double n = std::max<size_t>(expected_items, 1);
+        double ln2 = std::log(2.0);
+        size_t m = static_cast<size_t>(std::ceil(-n * std::log(false_positive_rate) / (ln2 * ln2)));
+        counters.assign(std::max<size_t>(m, 8), 0);
+        hash_count = std::max<size_t>(1, static_cast<size_t>(std::round(counters.size() / n * ln2)));
+    }
+
+    void add(const std::string &key)
+    {
+        uint64_t h1 = std::hash<std::string>()(key);
+        uint64_t h2 = mixHash(h1) | 1;
+        for (size_t i = 0; i < hash_count; i++)
+        {
+            uint8_t &cell = counters[(h1 + i * h2) % counters.size()];
+            if (cell < UINT8_MAX)
+                cell++;
+        }
+    }
+
+    // Only call for keys that were added, otherwise other keys may be lost
+    void remove(const std::string &key)
+    {
+        uint64_t h1 = std::hash<std::string>()(key);
+        uint64_t h2 = mixHash(h1) | 1;
+        for (size_t i = 0; i < hash_count; i++)
+        {
+            uint8_t &cell = counters[(h1 + i * h2) % counters.size()];
+            // Saturated counters stay put, they no longer know their true count
+            if (cell > 0 && cell < UINT8_MAX)
+                cell--;
+        }
+    }
+
+    bool mayContain(const std::string &key) const
+    {
+        uint64_t h1 = std::hash<std::string>()(key);
+        uint64_t h2 = mixHash(h1) | 1;
+        for (size_t i = 0; i < hash_count; i++)
+        {
+            if (counters[(h1 + i * h2) % counters.size()] == 0)
+                return false;
+        }
+        return true;
+    }
+
+    void clear() { std::fill(counters.begin(), counters.end(), 0); }
+    size_t getHashCount() const { return hash_count; }
+    size_t memoryBytes() const { return counters.capacity(); }
+};
+
+/**
+ * Space-Saving heavy hitters (Metwally et al.)
+ * Tracks at most k keys; a new key evicts the current minimum and inherits
+ * its count, so any key with true count > total / k is always tracked and
+ * every estimate overcounts by at most the recorded error.
+ * Time Complexity: O(log k) per add
+ * Space Complexity: O(k)
+ */
+class SpaceSavingCounter
+{
+public:
+    struct HeavyHitter
+    {
+        std::string key;
+        uint64_t count; // upper bound on the true count
+        uint64_t error; // count - error is a lower bound
+    };
+
+private:
+    size_t capacity;
+    std::vector<HeavyHitter> slots;
+    std::unordered_map<std::string, size_t> slot_of;
+    std::set<std::pair<uint64_t, size_t>> by_count; // (count, slot) - minimum first
+
+public:
+    SpaceSavingCounter(size_t k = 100) : capacity(std::max<size_t>(k, 1))
+    {
+        slots.reserve(capacity);
+        slot_of.reserve(capacity);
+    }
+
+    void add(const std::string &key, uint64_t count = 1)
+    {
+        auto it = slot_of.find(key);
+        size_t slot;
+        if (it != slot_of.end())
+        {
+            slot = it->second;
+            by_count.erase({slots[slot].count, slot});
+            slots[slot].count += count;
+        }
+        else if (slots.size() < capacity)
+        {
+            slot = slots.size();
+            slots.push_back({key, count, 0});
+            slot_of.emplace(key, slot);
+        }
+        else
+        {
+            // Replace the minimum, inheriting its count as error
+            slot = by_count.begin()->second;
+            by_count.erase(by_count.begin());
+            slot_of.erase(slots[slot].key);
+            uint64_t floor = slots[slot].count;
+            slots[slot] = {key, floor + count, floor};
+            slot_of.emplace(key, slot);
+        }
+        by_count.insert({slots[slot].count, slot});
+    }
+
+    /**
+     * Top n tracked keys by estimated count
+     * Time Complexity: O(n)
+     */
+    std::vector<HeavyHitter> top(size_t n) const
+    {
+        std::vector<HeavyHitter> result;
+        for (auto it = by_count.rbegin(); it != by_count.rend() && result.size() < n; ++it)
+        {
+            result.push_back(slots[it->second]);
+        }
+        return result;
+    }
+
+    uint64_t estimate(const std::string &key) const
+    {
+        auto it = slot_of.find(key);
+        return it != slot_of.end() ? slots[it->second].count : 0;
+    }
+
+    void clear()
+    {
+        slots.clear();
+        slot_of.clear();
+        by_count.clear();
+    }
+
+    size_t size() const { return slots.size(); }
+
+    size_t memoryBytes() const
+    {
+        // Slots, hash index entries and tree nodes (approximate node overheads)
+        return slots.capacity() * sizeof(HeavyHitter) +
+               slot_of.size() * (sizeof(std::pair<const std::string, size_t>) + 2 * sizeof(void *)) +
+               slot_of.bucket_count() * sizeof(void *) +
+               by_count.size() * (sizeof(std::pair<uint64_t, size_t>) + 4 * sizeof(void *));
+    }
+};
+
+/**
+ * Approximate skip window using two generations of counting Bloom filters
+ * New skips go into the current generation; once it holds capacity skips it
+ * becomes the previous generation and a fresh one starts. Membership checks
+ * both, so a skip is remembered for between capacity and 2 * capacity skips.
+ * There is no remove: a membership guess cannot tell a key's own counts from
+ * a false positive's, so a forgotten key tests as skipped until it rotates out.
+ * Time Complexity: O(k) per operation where k is the number of hashes
+ * Space Complexity: O(capacity * log(1/p)) bytes, no IDs are stored
+ */
+class ApproximateSkipWindow
+{
+private:
+    size_t capacity;
+    double false_positive_rate;
+    CountingBloomFilter current;
+    CountingBloomFilter previous;
+    size_t current_count;
+    size_t previous_count;
+
+public:
+    ApproximateSkipWindow(size_t capacity, double false_positive_rate)
+        : capacity(std::max<size_t>(capacity, 1)), false_positive_rate(false_positive_rate),
+          current(this->capacity, false_positive_rate), previous(this->capacity, false_positive_rate),
+          current_count(0), previous_count(0) {}
+
+    void add(const std::string &key)
+    {
+        if (current.mayContain(key))
+            return;
+
+        if (current_count >= capacity)
+        {
+            std::swap(previous, current);
+            current.clear();
+            previous_count = current_count;
+            current_count = 0;
+        }
+        current.add(key);
+        current_count++;
+    }
+
+    bool mayContain(const std::string &key) const
+    {
+        return current.mayContain(key) || previous.mayContain(key);
+    }
+
+    void clear()
+    {
+        current.clear();
+        previous.clear();
+        current_count = previous_count = 0;
+    }
+
+    size_t size() const { return std::min(capacity, current_count + previous_count); }
+    double getFalsePositiveRate() const { return false_positive_rate; }
+    size_t memoryBytes() const { return current.memoryBytes() + previous.memoryBytes(); }
+};
+
+/**
+ * Recently Skipped Tracker using a hash-indexed LRU list
+ * The list keeps skip order (most recent first), the hash map points each
+ * song ID at its list node so add, refresh and membership never scan.
+ * Map keys are views into the list's strings, so each ID is stored once.
+ * Time Complexity: O(1) average for add/check operations
+ * Space Complexity: O(k) where k is the capacity (default 10)
+ */
+class RecentlySkippedTracker
+{
+private:
+    std::list<std::string> skipped_songs; // Song IDs, most recently skipped first
+    std::unordered_map<std::string_view, std::list<std::string>::iterator> index;
+    size_t max_size;
+    std::unique_ptr<ApproximateSkipWindow> approximate; // Set in approximate mode, replaces the list
+
+public:
+    RecentlySkippedTracker(size_t max_size = 10) : max_size(max_size)
+    {
+        index.reserve(max_size);
+    }
+
+    /**
+     * Switch to approximate mode backed by counting Bloom filters
+     * Drops the exact list; skipped IDs can no longer be listed, only tested
+     * Space Complexity: O(capacity * log(1/p)) bytes instead of O(capacity) strings
+     */
+    void enableApproximate(double false_positive_rate = 0.01)
+    {
+        approximate.reset(new ApproximateSkipWindow(max_size, false_positive_rate));
+        for (const std::string &song_id : skipped_songs)
+        {
+            approximate->add(song_id);
+        }
+        index.clear();
+        skipped_songs.clear();
+    }
+
+    bool isApproximate() const { return approximate != nullptr; }
+
+    /**
+     * Add a song to the recently skipped list, or refresh it if already there
+     * Time Complexity: O(1) average
+     * Space Complexity: O(1)
+     */
+    void addSkippedSong(const std::string &song_id)
+    {
+        if (max_size == 0)
+            return;
+        if (approximate)
+        {
+            approximate->add(song_id);
+            return;
+        }
+
+        auto it = index.find(song_id);
+        if (it != index.end())
+        {
+            // Move existing node to the front without reallocating
+            skipped_songs.splice(skipped_songs.begin(), skipped_songs, it->second);
+            return;
+        }
+
+        skipped_songs.push_front(song_id);
+        index.emplace(skipped_songs.front(), skipped_songs.begin());
+
+        if (skipped_songs.size() > max_size)
+        {
+            evictOldest();
+        }
+    }
+
+    /**
+     * Check if a song was recently skipped
+     * Time Complexity: O(1) average
+     * Space Complexity: O(1)
+     */
+    bool wasRecentlySkipped(const std::string &song_id) const
+    {
+        PW_TRACE_SPAN("wasRecentlySkipped");
+        if (approximate)
+            return approximate->mayContain(song_id);
+        return index.find(song_id) != index.end();
+    }
+
+    /**
+     * Forget a single song
+     * In approximate mode nothing is removed and false is returned; the ID
+     * may still test as skipped until the window rotates past it.
+     * Time Complexity: O(1) average
+     * Space Complexity: O(1)
+     */
+    bool removeSkippedSong(const std::string &song_id)
+    {
+        if (approximate)
+            return false;
+
+        auto it = index.find(song_id);
+        if (it == index.end())
+            return false;
+
+        auto node = it->second;
+        index.erase(it);
+        skipped_songs.erase(node);
+        return true;
+    }
+
+    /**
+     * Change the window size, dropping the oldest skips if it shrinks
+     * Time Complexity: O(d) where d is the number of evicted entries
+     * Space Complexity: O(1)
+     */
+    void setCapacity(size_t capacity)
+    {
+        max_size = capacity;
+        if (approximate)
+        {
+            approximate.reset(new ApproximateSkipWindow(max_size, approximate->getFalsePositiveRate()));
+            return;
+        }
+        while (skipped_songs.size() > max_size)
+        {
+            evictOldest();
+        }
+    }
+
+    /**
+     * Get all recently skipped songs, most recent first
+     * Time Complexity: O(k)
+     * Space Complexity: O(k)
+     */
+    std::vector<std::string> getRecentlySkipped() const
+    {
+        return std::vector<std::string>(skipped_songs.begin(), skipped_songs.end());
+    }
+
+    /**
+     * Clear the skipped songs list
+     * Time Complexity: O(k)
+     * Space Complexity: O(1)
+     */
+    void clear()
+    {
+        index.clear();
+        skipped_songs.clear();
+        if (approximate)
+            approximate->clear();
+    }
+
+    size_t size() const { return approximate ? approximate->size() : skipped_songs.size(); }
+    size_t capacity() const { return max_size; }
+    bool empty() const { return size() == 0; }
+
+    /**
+     * Estimated heap footprint of the tracker
+     * Time Complexity: O(1)
+     */
+    size_t memoryBytes() const
+    {
+        if (approximate)
+            return approximate->memoryBytes();
+
+        size_t bytes = index.bucket_count() * sizeof(void *) +
+                       index.size() * (sizeof(std::pair<const std::string_view, std::list<std::string>::iterator>) + 2 * sizeof(void *));
+        for (const std::string &song_id : skipped_songs)
+        {
+            bytes += sizeof(std::string) + 2 * sizeof(void *);
+            if (song_id.capacity() > 15)
+                bytes += song_id.capacity() + 1;
+        }
+        return bytes;
+    }
+
+private:
+    void evictOldest()
+    {
+        index.erase(skipped_songs.back());
+        skipped_songs.pop_back();
+    }
+};
+
+/**
+ * Genre index maintained as songs are added, removed or re-tagged
+ * Each genre keeps a bucket of its songs; a per-handle back-reference to the
+ * song's bucket and slot makes removal a swap with the bucket's last song.
+ * Genres are listed in the order they first appeared. Songs within a genre
+ * are in add order until one is removed.
+ * Time Complexity: O(1) average for add/remove/count, O(p) for a page of p songs
+ * Space Complexity: O(n + g) for n songs in g genres
+ */
+class GenreIndex
+{
+private:
+    struct Bucket
+    {
+        std::string genre;
+        std::vector<Song *> songs;
+    };
+
+    struct Entry
+    {
+        uint32_t bucket;
+        uint32_t slot;
+    };
+
+    static constexpr uint32_t NOT_INDEXED = UINT32_MAX;
+
+    std::vector<Bucket> buckets;                           // First-seen order
+    std::unordered_map<std::string, uint32_t> bucket_of;   // genre -> bucket
+    std::vector<Entry> entries;                            // Song handle -> position
+    size_t non_empty = 0;                                  // Buckets holding at least one song
+
+public:
+    /**
+     * Add a song under its current genre
+     * Time Complexity: O(1) average
+     */
+    void add_song(Song *song)
+    {
+        auto found = bucket_of.find(song->genre);
+        uint32_t bucket;
+        if (found == bucket_of.end())
+        {
+            bucket = static_cast<uint32_t>(buckets.size());
+            bucket_of.emplace(song->genre, bucket);
+            buckets.push_back({song->genre, {}});
+        }
+        else
+        {
+            bucket = found->second;
+        }
+
+        if (song->handle >= entries.size())
+            entries.resize(song->handle + 1, {NOT_INDEXED, 0});
+        entries[song->handle] = {bucket, static_cast<uint32_t>(buckets[bucket].songs.size())};
+        if (buckets[bucket].songs.empty())
+            non_empty++;
+        buckets[bucket].songs.push_back(song);
+    }
+
+    /**
+     * Remove a song; the last song of its genre takes its slot
+     * Time Complexity: O(1)
+     */
+    bool remove_song(Song *song)
+    {
+        if (song->handle >= entries.size() || entries[song->handle].bucket == NOT_INDEXED)
+            return false;
+
+        Entry entry = entries[song->handle];
+        std::vector<Song *> &songs = buckets[entry.bucket].songs;
+        Song *moved = songs.back();
+        songs[entry.slot] = moved;
+        entries[moved->handle].slot = entry.slot;
+        songs.pop_back();
+        if (songs.empty())
+            non_empty--;
+        entries[song->handle].bucket = NOT_INDEXED;
+        return true;
+    }
+
+    /**
+     * Move a song to another genre and update Song::genre
+     * Time Complexity: O(1) average
+     */
+    void change_genre(Song *song, const std::string &genre)
+    {
+        bool indexed = remove_song(song);
+        song->genre = genre;
+        if (indexed)
+            add_song(song);
+    }
+
+    void reserve(size_t songs) { entries.reserve(songs); }
+
+    /**
+     * Number of songs in a genre
+     * Time Complexity: O(1) average
+     */
+    size_t count(const std::string &genre) const
+    {
+        auto found = bucket_of.find(genre);
+        return found == bucket_of.end() ? 0 : buckets[found->second].songs.size();
+    }
+
+    /**
+     * Up to limit songs of a genre, starting at offset
+     * Time Complexity: O(1) average + O(limit)
+     * Space Complexity: O(limit)
+     */
+    std::vector<Song *> page(const std::string &genre, size_t offset, size_t limit) const
+    {
+        auto found = bucket_of.find(genre);
+        if (found == bucket_of.end())
+            return {};
+        const std::vector<Song *> &songs = buckets[found->second].songs;
+        if (offset >= songs.size())
+            return {};
+        auto first = songs.begin() + offset;
+        return std::vector<Song *>(first, first + std::min(limit, songs.size() - offset));
+    }
+
+    /**
+     * Genres that currently have songs, with their counts, in first-seen order
+     * Time Complexity: O(g)
+     */
+    std::vector<std::pair<std::string, size_t>> genre_counts() const
+    {
+        std::vector<std::pair<std::string, size_t>> counts;
+        for (const Bucket &bucket : buckets)
+        {
+            if (!bucket.songs.empty())
+                counts.emplace_back(bucket.genre, bucket.songs.size());
+        }
+        return counts;
+    }
+
+    /**
+     * Visit every non-empty genre with its songs
+     */
+    template <typename Visitor>
+    void forEachGenre(Visitor visit) const
+    {
+        for (const Bucket &bucket : buckets)
+        {
+            if (!bucket.songs.empty())
+                visit(bucket.genre, bucket.songs);
+        }
+    }
+
+    // Genres that currently have songs; emptied buckets are kept for reuse but not counted
+    size_t genreCount() const { return non_empty; }
+
+    size_t memoryBytes() const
+    {
+        size_t bytes = entries.capacity() * sizeof(Entry) + buckets.capacity() * sizeof(Bucket) +
+                       bucket_of.bucket_count() * sizeof(void *);
+        for (const Bucket &bucket : buckets)
+        {
+            bytes += bucket.songs.capacity() * sizeof(Song *) +
+                     sizeof(std::pair<const std::string, uint32_t>) + 2 * sizeof(void *);
+        }
+        return bytes;
+    }
+};
+
+/**
+ * Time-decayed skip scores stored as one float per song handle
+ * A skip adds 1 to the song's score and scores halve every half-life.
+ * Instead of decaying every entry, scores are kept scaled by 2^(t/half_life)
+ * relative to a base time, so a skip is one add and a query is one multiply.
+ * Once the scale factor gets large all entries are rebased (amortized O(1)).
+ * Time Complexity: O(1) for recordSkip/score
+ * Space Complexity: O(n) floats where n is the number of song handles
+ */
+class SkipScoreTable
+{
+private:
+    std::vector<float> scaled_scores; // score * 2^((t - base_time) / half_life)
+    double half_life;                 // seconds
+    double base_time;                 // seconds, reference point for scaled_scores
+
+    // Rebase well before 2^exponent can overflow a float (max ~2^127)
+    static constexpr double MAX_EXPONENT = 60.0;
+
+public:
+    SkipScoreTable(double half_life_seconds = 1800.0) : half_life(half_life_seconds), base_time(0.0) {}
+
+    /**
+     * Record a skip at time now (seconds)
+     * Time Complexity: O(1) amortized
+     * Space Complexity: O(1) amortized
+     */
+    void recordSkip(uint32_t handle, double now, float weight = 1.0f)
+    {
+        if (handle >= scaled_scores.size())
+            scaled_scores.resize(handle + 1, 0.0f);
+
+        double exponent = (now - base_time) / half_life;
+        if (exponent > MAX_EXPONENT)
+        {
+            rebase(now);
+            exponent = 0.0;
+        }
+        scaled_scores[handle] += weight * static_cast<float>(std::exp2(exponent));
+    }
+
+    /**
+     * Decayed score at time now
+     * Time Complexity: O(1)
+     * Space Complexity: O(1)
+     */
+    float score(uint32_t handle, double now) const
+    {
+        if (handle >= scaled_scores.size() || scaled_scores[handle] == 0.0f)
+            return 0.0f;
+        return static_cast<float>(scaled_scores[handle] * std::exp2(-(now - base_time) / half_life));
+    }
+
+    /**
+     * Change the half-life, keeping current scores
+     * Time Complexity: O(n)
+     */
+    void setHalfLife(double half_life_seconds, double now)
+    {
+        rebase(now);
+        half_life = half_life_seconds;
+    }
+
+    void reset(uint32_t handle)
+    {
+        if (handle < scaled_scores.size())
+            scaled_scores[handle] = 0.0f;
+    }
+
+    void clear() { std::fill(scaled_scores.begin(), scaled_scores.end(), 0.0f); }
+    void reserve(size_t handles) { scaled_scores.reserve(handles); }
+    double getHalfLife() const { return half_life; }
+    size_t memoryBytes() const { return scaled_scores.capacity() * sizeof(float); }
+    size_t slotCount() const { return scaled_scores.size(); }
+
+private:
+    void rebase(double now)
+    {
+        float factor = static_cast<float>(std::exp2(-(now - base_time) / half_life));
+        for (float &value : scaled_scores)
+        {
+            value *= factor;
+        }
+        base_time = now;
+    }
+};
+
+/**
+ * Indexed min-heap holding the k songs with the highest play counts
+ * The root is the weakest member, and a position index lets a member's count
+ * be raised in place (increase-key). Counts only ever grow, so a song outside
+ * the heap can only enter by beating the root.
+ * Ties prefer more recently added songs.
+ * Time Complexity: O(log k) per offer, O(k log k) to read in order
+ * Space Complexity: O(k)
+ */
+class IndexedTopK
+{
+private:
+    struct Entry
+    {
+        Song *song;
+        int count;
+    };
+
+    std::vector<Entry> heap;
+    std::unordered_map<Song *, size_t> position; // song -> index in heap
+    size_t capacity;
+
+public:
+    IndexedTopK(size_t k = 3) : capacity(k)
+    {
+        heap.reserve(k);
+        position.reserve(k);
+    }
+
+    /**
+     * Report a song's new (non-decreasing) play count
+     * Time Complexity: O(log k)
+     * Space Complexity: O(1)
+     */
+    void offer(Song *song, int count)
+    {
+        auto it = position.find(song);
+        if (it != position.end())
+        {
+            // Increase-key in a min-heap moves the entry towards the leaves
+            heap[it->second].count = count;
+            siftDown(it->second);
+            return;
+        }
+
+        Entry entry{song, count};
+        if (heap.size() < capacity)
+        {
+            heap.push_back(entry);
+            position[song] = heap.size() - 1;
+            siftUp(heap.size() - 1);
+        }
+        else if (capacity > 0 && weaker(heap[0], entry))
+        {
+            position.erase(heap[0].song);
+            heap[0] = entry;
+            position[song] = 0;
+            siftDown(0);
+        }
+    }
+
+    /**
+     * Members ordered from most to least played
+     * Time Complexity: O(k log k)
+     * Space Complexity: O(k)
+     */
+    std::vector<Song *> top() const
+    {
+        std::vector<Entry> ordered = heap;
+        std::sort(ordered.begin(), ordered.end(), [](const Entry &a, const Entry &b)
+                  { return weaker(b, a); });
+
+        std::vector<Song *> songs;
+        songs.reserve(ordered.size());
+        for (const Entry &entry : ordered)
+        {
+            songs.push_back(entry.song);
+        }
+        return songs;
+    }
+
+    /**
+     * Drop a member; the owner re-offers candidates to refill its place
+     * Time Complexity: O(log k)
+     * Space Complexity: O(1)
+     */
+    bool remove(Song *song)
+    {
+        auto it = position.find(song);
+        if (it == position.end())
+            return false;
+
+        size_t i = it->second;
+        position.erase(it);
+        if (i + 1 < heap.size())
+        {
+            Song *moved = heap.back().song;
+            heap[i] = heap.back();
+            heap.pop_back();
+            position[moved] = i;
+            siftUp(i);
+            siftDown(position[moved]);
+        }
+        else
+        {
+            heap.pop_back();
+        }
+        return true;
+    }
+
+    bool contains(Song *song) const { return position.count(song) > 0; }
+    size_t size() const { return heap.size(); }
+
+    size_t memoryBytes() const
+    {
+        return heap.capacity() * sizeof(Entry) + position.bucket_count() * sizeof(void *) +
+               position.size() * (sizeof(std::pair<Song *const, size_t>) + sizeof(void *));
+    }
+
+    void clear()
+    {
+        heap.clear();
+        position.clear();
+    }
+
+private:
+    static bool weaker(const Entry &a, const Entry &b)
+    {
+        if (a.count != b.count)
+            return a.count < b.count;
+        return a.song->added_time < b.song->added_time;
+    }
+
+    void swapEntries(size_t i, size_t j)
+    {
+        std::swap(heap[i], heap[j]);
+        position[heap[i].song] = i;
+        position[heap[j].song] = j;
+    }
+
+    void siftUp(size_t i)
+    {
+        while (i > 0)
+        {
+            size_t parent = (i - 1) / 2;
+            if (!weaker(heap[i], heap[parent]))
+                break;
+            swapEntries(i, parent);
+            i = parent;
+        }
+    }
+
+    void siftDown(size_t i)
+    {
+        while (true)
+        {
+            size_t smallest = i;
+            size_t left = 2 * i + 1, right = 2 * i + 2;
+            if (left < heap.size() && weaker(heap[left], heap[smallest]))
+                smallest = left;
+            if (right < heap.size() && weaker(heap[right], heap[smallest]))
+                smallest = right;
+            if (smallest == i)
+                break;
+            swapEntries(i, smallest);
+            i = smallest;
+        }
+    }
+};
+
+/**
+ * Sharded play counters for concurrent recordPlay
+ * Each shard owns a counter array indexed by song handle and every thread
+ * sticks to one shard, so concurrent increments rarely share a cache line.
+ * Counter arrays are allocated in chunks on first use. Readers drain the
+ * shards with atomic exchange, so an increment is either picked up by the
+ * current drain or left for the next one - updates are never lost.
+ * Time Complexity: O(1) per increment, O(S * H) per drain
+ * Space Complexity: O(S * H) counters for S shards and H touched handles
+ */
+class ShardedPlayCounter
+{
+private:
+    static const size_t CHUNK_SIZE = 4096;
+
+    struct CountChunk
+    {
+        std::atomic<uint32_t> counts[CHUNK_SIZE];
+        CountChunk()
+        {
+            for (auto &count : counts)
+                count.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    struct SongChunk
+    {
+        std::atomic<Song *> songs[CHUNK_SIZE];
+        SongChunk()
+        {
+            for (auto &song : songs)
+                song.store(nullptr, std::memory_order_relaxed);
+        }
+    };
+
+    // Shards start on their own cache line so their chunk tables never false-share
+    struct alignas(64) Shard
+    {
+        std::unique_ptr<std::atomic<CountChunk *>[]> chunks;
+    };
+
+    size_t chunk_count;
+    size_t shard_mask;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::unique_ptr<std::atomic<SongChunk *>[]> registry; // handle -> Song*, shared by all shards
+    std::atomic<uint32_t> handle_limit;                   // one past the highest handle seen
+
+public:
+    /**
+     * max_handles bounds the song handles that can be counted; shard_count 0
+     * picks the hardware thread count (rounded up to a power of two, at most 16)
+     */
+    ShardedPlayCounter(size_t max_handles = 1 << 22, size_t shard_count = 0)
+        : chunk_count((max_handles + CHUNK_SIZE - 1) / CHUNK_SIZE), handle_limit(0)
+    {
+        if (shard_count == 0)
+            shard_count = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), 16);
+        size_t rounded = 1;
+        while (rounded < shard_count)
+            rounded <<= 1;
+        shard_mask = rounded - 1;
+
+        for (size_t i = 0; i < rounded; i++)
+        {
+            shards.emplace_back(new Shard());
+            shards.back()->chunks.reset(new std::atomic<CountChunk *>[chunk_count]);
+            for (size_t c = 0; c < chunk_count; c++)
+                shards.back()->chunks[c].store(nullptr, std::memory_order_relaxed);
+        }
+        registry.reset(new std::atomic<SongChunk *>[chunk_count]);
+        for (size_t c = 0; c < chunk_count; c++)
+            registry[c].store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~ShardedPlayCounter()
+    {
+        for (auto &shard : shards)
+        {
+            for (size_t c = 0; c < chunk_count; c++)
+                delete shard->chunks[c].load(std::memory_order_relaxed);
+        }
+        for (size_t c = 0; c < chunk_count; c++)
+            delete registry[c].load(std::memory_order_relaxed);
+    }
+
+    ShardedPlayCounter(const ShardedPlayCounter &) = delete;
+    ShardedPlayCounter &operator=(const ShardedPlayCounter &) = delete;
+
+    /**
+     * Count one play - safe to call from any number of threads
+     * Time Complexity: O(1)
+     * Space Complexity: O(1) amortized (chunks are allocated on first touch)
+     */
+    bool increment(Song *song)
+    {
+        uint32_t handle = song->handle;
+        size_t chunk = handle / CHUNK_SIZE;
+        size_t slot = handle % CHUNK_SIZE;
+        if (chunk >= chunk_count)
+            return false;
+
+        // Publish the song before its count so a drain never sees a count without an owner
+        std::atomic<Song *> &owner = getOrCreate(registry[chunk])->songs[slot];
+        if (owner.load(std::memory_order_relaxed) != song)
+            owner.store(song, std::memory_order_relaxed);
+
+        Shard &shard = *shards[currentThreadSlot() & shard_mask];
+        getOrCreate(shard.chunks[chunk])->counts[slot].fetch_add(1, std::memory_order_release);
+
+        uint32_t limit = handle_limit.load(std::memory_order_relaxed);
+        while (handle >= limit &&
+               !handle_limit.compare_exchange_weak(limit, handle + 1, std::memory_order_relaxed))
+        {
+        }
+        return true;
+    }
+
+    /**
+     * Take all pending counts, calling visit(song, plays) per song
+     * Safe to run while other threads keep incrementing
+     * Time Complexity: O(S * H)
+     * Space Complexity: O(1)
+     */
+    template <typename Visitor>
+    void drain(Visitor visit)
+    {
+        uint32_t limit = handle_limit.load(std::memory_order_acquire);
+        for (size_t chunk = 0; chunk * CHUNK_SIZE < limit; chunk++)
+        {
+            SongChunk *owners = registry[chunk].load(std::memory_order_acquire);
+            if (!owners)
+                continue;
+
+            for (size_t slot = 0; slot < CHUNK_SIZE && chunk * CHUNK_SIZE + slot < limit; slot++)
+            {
+                uint64_t plays = 0;
+                for (auto &shard : shards)
+                {
+                    CountChunk *counts = shard->chunks[chunk].load(std::memory_order_acquire);
+                    if (counts && counts->counts[slot].load(std::memory_order_relaxed) != 0)
+                        plays += counts->counts[slot].exchange(0, std::memory_order_acq_rel);
+                }
+                if (plays > 0)
+                    visit(owners->songs[slot].load(std::memory_order_relaxed), plays);
+            }
+        }
+    }
+
+    size_t shardCount() const { return shards.size(); }
+
+    size_t memoryBytes() const
+    {
+        size_t bytes = shards.size() * (sizeof(Shard) + chunk_count * sizeof(void *)) +
+                       chunk_count * sizeof(void *);
+        for (const auto &shard : shards)
+        {
+            for (size_t c = 0; c < chunk_count; c++)
+                bytes += shard->chunks[c].load(std::memory_order_relaxed) ? sizeof(CountChunk) : 0;
+        }
+        for (size_t c = 0; c < chunk_count; c++)
+            bytes += registry[c].load(std::memory_order_relaxed) ? sizeof(SongChunk) : 0;
+        return bytes;
+    }
+
+private:
+    template <typename T>
+    static T *getOrCreate(std::atomic<T *> &slot)
+    {
+        T *current = slot.load(std::memory_order_acquire);
+        if (current)
+            return current;
+
+        T *fresh = new T();
+        if (slot.compare_exchange_strong(current, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+            return fresh;
+        delete fresh; // another thread won the race
+        return current;
+    }
+};
+
+/**
+ * Fixed-capacity replay rotation
+ * The songs stay in place and a cursor walks around them, so taking the
+ * next replay song never pops or re-pushes anything.
+ * Time Complexity: O(1) per next(), O(k) to assign
+ * Space Complexity: O(k)
+ */
+class ReplayRing
+{
+private:
+    std::vector<Song *> slots;
+    size_t count;
+    size_t cursor;
+
+public:
+    ReplayRing(size_t capacity = 3) : slots(capacity, nullptr), count(0), cursor(0) {}
+
+    void assign(const std::vector<Song *> &songs)
+    {
+        count = std::min(songs.size(), slots.size());
+        std::copy(songs.begin(), songs.begin() + count, slots.begin());
+        cursor = 0;
+    }
+
+    Song *next()
+    {
+        if (count == 0)
+            return nullptr;
+        Song *song = slots[cursor];
+        cursor = cursor + 1 == count ? 0 : cursor + 1;
+        return song;
+    }
+
+    void rewind() { cursor = 0; }
+
+    // Take a song out of the rotation, keeping the others in order
+    bool remove(Song *song)
+    {
+        size_t i = std::find(slots.begin(), slots.begin() + count, song) - slots.begin();
+        if (i == count)
+            return false;
+        std::copy(slots.begin() + i + 1, slots.begin() + count, slots.begin() + i);
+        count--;
+        if (cursor > i)
+            cursor--;
+        if (cursor >= count)
+            cursor = 0;
+        return true;
+    }
+
+    void clear()
+    {
+        count = 0;
+        cursor = 0;
+    }
+
+    Song *at(size_t i) const { return slots[i]; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t memoryBytes() const { return slots.capacity() * sizeof(Song *); }
+};
+
+/**
+ * Rolling mood counts over the last W plays
+ * A ring of mood indices plus one counter per mood; the dominant mood is
+ * cached and only rescanned when its own count drops.
+ * Time Complexity: O(1) per play, O(M) rescan for M moods when the leader drops
+ * Space Complexity: O(W + M)
+ */
+class MoodWindow
+{
+private:
+    std::vector<int> window; // mood index per play, -1 when the genre has no mood
+    std::vector<int> counts; // plays per mood inside the window
+    size_t head;             // oldest play
+    size_t filled;
+    int dominant;
+
+    void rescan()
+    {
+        dominant = -1;
+        for (size_t mood = 0; mood < counts.size(); mood++)
+        {
+            if (counts[mood] > 0 && (dominant < 0 || counts[mood] > counts[dominant]))
+                dominant = static_cast<int>(mood);
+        }
+    }
+
+    void uncount(int mood)
+    {
+        if (mood < 0)
+            return;
+        counts[mood]--;
+        if (mood == dominant)
+            rescan();
+    }
+
+public:
+    MoodWindow(size_t size = 20) : window(std::max<size_t>(size, 1), -1), head(0), filled(0), dominant(-1) {}
+
+    void addMood() { counts.push_back(0); }
+
+    /**
+     * Record a play, evicting the oldest once the window is full
+     * Ties keep the current leader, so the dominant mood does not flicker
+     */
+    void push(int mood)
+    {
+        if (filled == window.size())
+        {
+            uncount(window[head]);
+            window[head] = mood;
+            head = (head + 1) % window.size();
+        }
+        else
+        {
+            window[(head + filled) % window.size()] = mood;
+            filled++;
+        }
+
+        if (mood >= 0)
+        {
+            counts[mood]++;
+            if (dominant < 0 || counts[mood] > counts[dominant])
+                dominant = mood;
+        }
+    }
+
+    /**
+     * Take back the newest play (undo); the evicted play is not restored
+     */
+    void popNewest()
+    {
+        if (filled == 0)
+            return;
+        filled--;
+        uncount(window[(head + filled) % window.size()]);
+    }
+
+    void resize(size_t size)
+    {
+        std::vector<int> recent;
+        for (size_t i = 0; i < filled; i++)
+            recent.push_back(window[(head + i) % window.size()]);
+
+        window.assign(std::max<size_t>(size, 1), -1);
+        std::fill(counts.begin(), counts.end(), 0);
+        head = 0;
+        filled = 0;
+        dominant = -1;
+        size_t start = recent.size() > window.size() ? recent.size() - window.size() : 0;
+        for (size_t i = start; i < recent.size(); i++)
+            push(recent[i]);
+    }
+
+    int getDominant() const { return dominant; }
+    int getCount(int mood) const { return mood >= 0 ? counts[mood] : 0; }
+    size_t size() const { return filled; }
+    size_t capacity() const { return window.size(); }
+    size_t memoryBytes() const { return (window.capacity() + counts.capacity()) * sizeof(int); }
+};
+
+/**
+ * Auto Replay Manager for Genre-based Mood Replay
+ * Uses HashMap for play counts and, per mood, an indexed heap of its top-k
+ * songs plus a precomputed replay rotation. The listener's current mood is
+ * the dominant one over a rolling window of recent plays.
+ * Time Complexity: O(log k) for play count updates, O(k) for replay setup
+ * Space Complexity: O(n) where n is number of played songs
+ */
+class AutoReplayManager
+{
+private:
+    struct Mood
+    {
+        std::string name;
+        IndexedTopK top;       // Most played songs of this mood, maintained on recordPlay
+        ReplayRing rotation;   // Replay order, rebuilt from top when stale
+        bool rotation_stale;
+
+        Mood(const std::string &n, size_t k) : name(n), top(k), rotation(k), rotation_stale(true) {}
+    };
+
+    std::unordered_map<std::string, int> play_counts; // song_id -> play count
+    bool auto_replay_enabled;
+    int replay_cycles; // Track how many times we've replayed
+
+    std::vector<Mood> moods;
+    using GenreMoodMap = std::unordered_map<std::string, int>;
+    std::shared_ptr<const GenreMoodMap> mood_of_genre; // lower-case genre -> mood index, shared until redefined
+    MoodWindow recent_moods;                            // Rolling mood counts of recent plays
+    int replay_mood;                                    // Mood whose rotation is playing, -1 if none
+
+    // Approximate mode: sketches replace play_counts
+    std::unique_ptr<CountMinSketch> play_sketch;
+    std::unique_ptr<SpaceSavingCounter> heavy_hitters;
+
+    // Concurrent mode: recordPlay only bumps these, readers merge them in
+    std::unique_ptr<ShardedPlayCounter> pending_plays;
+
+    // Wraps every change to Song::play_count so owners can keep indexes in order
+    std::function<void(Song *, const std::function<void()> &)> play_count_guard;
+
+    static const int REPLAY_SONG_COUNT = 3;
+    static const int CALMING_MOOD = 0;
+
+    static const std::vector<std::pair<std::string, std::vector<std::string>>> &defaultMoods()
+    {
+        static const std::vector<std::pair<std::string, std::vector<std::string>>> defaults = {
+            {"calming", {"lo-fi", "lofi", "jazz", "classical", "ambient", "chill"}},
+            {"energetic", {"rock", "pop", "edm", "electronic", "dance", "hip-hop", "metal"}},
+            {"focus", {"instrumental", "soundtrack", "piano", "post-rock", "study"}}};
+        return defaults;
+    }
+
+public:
+    AutoReplayManager() : auto_replay_enabled(true), replay_cycles(0), replay_mood(-1)
+    {
+        // Every manager starts from one shared genre table, copied on its first defineMood
+        static const std::shared_ptr<const GenreMoodMap> default_genres = []()
+        {
+            auto genres = std::make_shared<GenreMoodMap>();
+            for (size_t i = 0; i < defaultMoods().size(); i++)
+            {
+                for (const std::string &genre : defaultMoods()[i].second)
+                    (*genres)[genre] = static_cast<int>(i);
+            }
+            return genres;
+        }();
+
+        for (const auto &mood : defaultMoods())
+        {
+            moods.emplace_back(mood.first, static_cast<size_t>(REPLAY_SONG_COUNT));
+            recent_moods.addMood();
+        }
+        mood_of_genre = default_genres;
+    }
+
+    /**
+     * Add a mood, or give an existing mood more genres
+     * A genre belongs to one mood; moving it restarts the ranking of the
+     * mood it left. Plays recorded before a genre was mapped are not back-filled.
+     * Time Complexity: O(g) for g genres, plus O(k) per mood that lost a genre
+     * Space Complexity: O(g + k)
+     */
+    int defineMood(const std::string &name, const std::vector<std::string> &genres)
+    {
+        int index = findMood(name);
+        if (index < 0)
+        {
+            index = static_cast<int>(moods.size());
+            moods.emplace_back(name, static_cast<size_t>(REPLAY_SONG_COUNT));
+            recent_moods.addMood();
+        }
+
+        auto updated = std::make_shared<GenreMoodMap>(*mood_of_genre);
+        for (const std::string &genre : genres)
+        {
+            std::string key = genre;
+            std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+            auto it = updated->find(key);
+            if (it != updated->end() && it->second != index)
+            {
+                Mood &previous = moods[it->second];
+                previous.top.clear();
+                previous.rotation_stale = true;
+            }
+            (*updated)[key] = index;
+        }
+        mood_of_genre = updated;
+        return index;
+    }
+
+    int findMood(const std::string &name) const
+    {
+        for (size_t i = 0; i < moods.size(); i++)
+        {
+            if (moods[i].name == name)
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    /**
+     * Mood index for a song's genre, -1 if the genre has no mood
+     * Time Complexity: O(m) for genre length m
+     * Space Complexity: O(m)
+     */
+    int moodOf(const Song *song) const
+    {
+        std::string key = song->genre;
+        std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+        auto it = mood_of_genre->find(key);
+        return it != mood_of_genre->end() ? it->second : -1;
+    }
+
+    /**
+     * Feed the rolling mood window from playback history
+     * The engine calls trackListeningMood on every play and
+     * untrackListeningMood when a play is undone
+     * Time Complexity: O(m) to classify the genre, O(1) to update the counts
+     * Space Complexity: O(1)
+     */
+    void trackListeningMood(const Song *song)
+    {
+        if (song)
+            recent_moods.push(moodOf(song));
+    }
+
+    void untrackListeningMood() { recent_moods.popNewest(); }
+
+    void setMoodWindow(size_t plays) { recent_moods.resize(plays); }
+
+    size_t getMoodWindow() const { return recent_moods.capacity(); }
+
+    /**
+     * Dominant mood over the recent plays, empty when none has a mood
+     * Time Complexity: O(1)
+     * Space Complexity: O(1)
+     */
+    std::string getDominantMood() const
+    {
+        int mood = recent_moods.getDominant();
+        return mood >= 0 ? moods[mood].name : "";
+    }
+
+    std::string getMoodName(const Song *song) const
+    {
+        int mood = moodOf(song);
+        return mood >= 0 ? moods[mood].name : "";
+    }
+
+    std::string getReplayMood() const { return replay_mood >= 0 ? moods[replay_mood].name : ""; }
+
+    std::vector<std::string> getMoodNames() const
+    {
+        std::vector<std::string> names;
+        for (const Mood &mood : moods)
+            names.push_back(mood.name);
+        return names;
+    }
+
+    /**
+     * Switch play counting to a count-min sketch plus Space-Saving heavy hitters
+     * Counts overestimate by at most epsilon * total plays with probability
+     * 1 - delta; the top_k most played are tracked for statistics
+     * Space Complexity: O(e/epsilon * ln(1/delta) + top_k)
+     */
+    void enableApproximateCounting(double epsilon = 0.001, double delta = 0.01, size_t top_k = 100)
+    {
+        play_sketch.reset(new CountMinSketch(epsilon, delta));
+        heavy_hitters.reset(new SpaceSavingCounter(top_k));
+        for (const auto &pair : play_counts)
+        {
+            play_sketch->add(pair.first, pair.second);
+            heavy_hitters->add(pair.first, pair.second);
+        }
+        play_counts.clear();
+    }
+
+    bool isApproximateCounting() const { return play_sketch != nullptr; }
+
+    /**
+     * Make recordPlay safe to call from many threads at once
+     * Plays are counted in sharded per-song counters and merged into the
+     * play counts, Song::play_count and the mood top-k lists when they are read.
+     * Every other method must still be called from one thread at a time.
+     * Space Complexity: O(S * H) - see ShardedPlayCounter
+     */
+    void enableConcurrentCounting(size_t max_handles = 1 << 22, size_t shard_count = 0)
+    {
+        flushPendingPlays();
+        pending_plays.reset(new ShardedPlayCounter(max_handles, shard_count));
+    }
+
+    bool isConcurrentCounting() const { return pending_plays != nullptr; }
+
+    void setPlayCountGuard(std::function<void(Song *, const std::function<void()> &)> guard)
+    {
+        play_count_guard = std::move(guard);
+    }
+
+    /**
+     * Record a song play, update its play count and its mood's top-k
+     * In concurrent mode only a sharded counter is bumped
+     * Time Complexity: O(log k) average, O(d + log k) in approximate mode,
+     * O(1) in concurrent mode
+     * Space Complexity: O(1)
+     */
+    void recordPlay(Song *song)
+    {
+        if (!song)
+            return;
+
+        if (pending_plays && pending_plays->increment(song))
+            return;
+
+        applyPlays(song, 1);
+    }
+
+    /**
+     * Credit plays restored from saved state, bypassing the concurrent counter
+     * Time Complexity: O(log k) average
+     */
+    void restorePlays(Song *song, int plays)
+    {
+        if (song && plays > 0)
+            applyPlays(song, plays);
+    }
+
+    /**
+     * Forget a song that is leaving the catalog
+     * Pending concurrent plays must be flushed first. The song leaves its
+     * mood's top-k and any rotation; a freed top-k place is refilled from
+     * the mood's genres in the catalog's genre index, so the next most
+     * played song moves up. Approximate counts cannot be undone and stay
+     * in the sketch under the song's ID.
+     * Time Complexity: O(m + log k) for m moods, plus O(g + s log k) when
+     * the song was in a top-k (g genres, s songs in the mood's genres)
+     * Space Complexity: O(1)
+     */
+    void forgetSong(Song *song, const GenreIndex &genres)
+    {
+        play_counts.erase(song->id);
+        for (size_t i = 0; i < moods.size(); i++)
+        {
+            Mood &mood = moods[i];
+            if (mood.top.remove(song))
+            {
+                refillTop(static_cast<int>(i), genres, song);
+                mood.rotation_stale = true;
+            }
+            mood.rotation.remove(song);
+            if (static_cast<int>(i) == replay_mood && mood.rotation.empty())
+                replay_mood = -1;
+        }
+    }
+
+    /**
+     * Merge plays recorded concurrently since the last read
+     * Time Complexity: O(S * H) in concurrent mode, O(1) otherwise
+     * Space Complexity: O(1)
+     */
+    void flushPendingPlays()
+    {
+        if (!pending_plays)
+            return;
+        pending_plays->drain([this](Song *song, uint64_t plays)
+                             { applyPlays(song, static_cast<int>(plays)); });
+    }
+
+    /**
+     * Play count for a song ID (an upper-bound estimate in approximate mode)
+     * Time Complexity: O(1) average, plus a merge in concurrent mode
+     * Space Complexity: O(1)
+     */
+    int getPlayCount(const std::string &song_id)
+    {
+        flushPendingPlays();
+        return lookupPlayCount(song_id);
+    }
+
+    /**
+     * Heap footprint of this manager's per-listener state
+     * The default genre table is shared by all managers and not counted
+     * Time Complexity: O(n + M) for n counted songs and M moods
+     * Space Complexity: O(1)
+     */
+    size_t memoryBytes() const
+    {
+        size_t bytes = playCountMemoryBytes() + recent_moods.memoryBytes() + moods.capacity() * sizeof(Mood);
+        for (const Mood &mood : moods)
+        {
+            bytes += mood.top.memoryBytes() + mood.rotation.memoryBytes();
+        }
+        if (mood_of_genre.use_count() == 1)
+        {
+            bytes += mood_of_genre->bucket_count() * sizeof(void *) +
+                     mood_of_genre->size() * (sizeof(GenreMoodMap::value_type) + sizeof(void *));
+        }
+        if (pending_plays)
+            bytes += pending_plays->memoryBytes();
+        return bytes;
+    }
+
+    size_t playCountMemoryBytes() const
+    {
+        if (play_sketch)
+            return play_sketch->memoryBytes() + heavy_hitters->memoryBytes();
+
+        size_t bytes = play_counts.bucket_count() * sizeof(void *);
+        for (const auto &pair : play_counts)
+        {
+            bytes += sizeof(pair) + 2 * sizeof(void *);
+            if (pair.first.capacity() > 15)
+                bytes += pair.first.capacity() + 1;
+        }
+        return bytes;
+    }
+
+    // Songs with a play count (the heavy hitters in approximate mode)
+    size_t trackedSongCount() const { return play_sketch ? heavy_hitters->size() : play_counts.size(); }
+
+    /**
+     * Get top N most played songs of a mood from a list
+     * Time Complexity: O(n log n) for sorting
+     * Space Complexity: O(n) for temporary storage
+     */
+    std::vector<Song *> getTopMoodSongs(const std::vector<Song *> &all_songs, const std::string &mood_name, int top_n = 3)
+    {
+        flushPendingPlays();
+
+        int mood = findMood(mood_name);
+        std::vector<std::pair<int, Song *>> mood_songs;
+
+        for (Song *song : all_songs)
+        {
+            if (song && mood >= 0 && moodOf(song) == mood)
+            {
+                int plays = lookupPlayCount(song->id);
+                if (plays > 0)
+                    mood_songs.push_back({plays, song});
+            }
+        }
+
+        // Sort by play count (descending) using priority queue concept
+        std::sort(mood_songs.begin(), mood_songs.end(),
+                  [](const auto &a, const auto &b)
+                  {
+                      if (a.first == b.first)
+                      {
+                          // If play counts are equal, prefer more recent songs
+                          return a.second->added_time > b.second->added_time;
+                      }
+                      return a.first > b.first;
+                  });
+
+        // Extract top N songs
+        std::vector<Song *> result;
+        for (int i = 0; i < std::min(top_n, (int)mood_songs.size()); i++)
+        {
+            result.push_back(mood_songs[i].second);
+        }
+
+        return result;
+    }
+
+    std::vector<Song *> getTopCalmingSongs(const std::vector<Song *> &all_songs, int top_n = 3)
+    {
+        return getTopMoodSongs(all_songs, moods[CALMING_MOOD].name, top_n);
+    }
+
+    /**
+     * Setup auto-replay from the rotation of the listener's dominant mood
+     * Falls back to calming when there is no recent mood or it has no plays
+     * Time Complexity: O(1) when the rotation is current, O(k log k) to refresh it
+     * Space Complexity: O(k)
+     */
+    void setupAutoReplay()
+    {
+        if (!auto_replay_enabled)
+            return;
+        flushPendingPlays();
+
+        int mood = recent_moods.getDominant();
+        if (mood < 0 || moods[mood].top.size() == 0)
+            mood = CALMING_MOOD;
+
+        Mood &chosen = moods[mood];
+        if (chosen.rotation_stale)
+        {
+            chosen.rotation.assign(chosen.top.top());
+            chosen.rotation_stale = false;
+        }
+        startReplay(mood);
+    }
+
+    /**
+     * Setup auto-replay with the top songs of the dominant mood among the given songs
+     * Time Complexity: O(n log n)
      * Space Complexity: O(k) where k is number of replay songs
      */
-    void setupAutoReplay(const std::vector<Song *> &all_songs)
+    void setupAutoReplay(const std::vector<Song *> &all_songs)
+    {
+        if (!auto_replay_enabled)
+            return;
+
+        int mood = recent_moods.getDominant();
+        std::vector<Song *> top;
+        if (mood >= 0)
+            top = getTopMoodSongs(all_songs, moods[mood].name, REPLAY_SONG_COUNT);
+        if (top.empty())
+        {
+            mood = CALMING_MOOD;
+            top = getTopCalmingSongs(all_songs, REPLAY_SONG_COUNT);
+        }
+
+        // The scan may cover fewer songs than the maintained top-k
+        moods[mood].rotation.assign(top);
+        moods[mood].rotation_stale = true;
+        startReplay(mood);
+    }
+
+private:
+    void applyPlays(Song *song, int plays)
+    {
+        int count;
+        if (play_sketch)
+        {
+            play_sketch->add(song->id, plays);
+            heavy_hitters->add(song->id, plays);
+            count = play_sketch->estimate(song->id);
+        }
+        else
+        {
+            count = (play_counts[song->id] += plays);
+        }
+
+        auto bump = [song, plays]()
+        { song->play_count += plays; };
+        if (play_count_guard)
+            play_count_guard(song, bump);
+        else
+            bump();
+
+        int mood = moodOf(song);
+        if (mood >= 0)
+        {
+            moods[mood].top.offer(song, count);
+            moods[mood].rotation_stale = true;
+        }
+    }
+
+    /**
+     * Rebuild a mood's top-k from the played songs of its genres
+     * Time Complexity: O(g + s log k) for g genres and s songs in the mood's genres
+     * Space Complexity: O(1)
+     */
+    void refillTop(int mood, const GenreIndex &genres, const Song *leaving)
+    {
+        IndexedTopK &top = moods[mood].top;
+        top.clear();
+        genres.forEachGenre([&](const std::string &, const std::vector<Song *> &songs)
+                            {
+            if (moodOf(songs.front()) != mood)
+                return;
+            for (Song *candidate : songs)
+            {
+                int count = candidate == leaving ? 0 : lookupPlayCount(candidate->id);
+                if (count > 0)
+                    top.offer(candidate, count);
+            } });
+    }
+
+    int lookupPlayCount(const std::string &song_id) const
+    {
+        if (play_sketch)
+            return play_sketch->estimate(song_id);
+
+        auto it = play_counts.find(song_id);
+        return it != play_counts.end() ? it->second : 0;
+    }
+
+    void startReplay(int mood)
+    {
+        ReplayRing &rotation = moods[mood].rotation;
+        replay_mood = rotation.empty() ? -1 : mood;
+        if (rotation.empty())
+            return;
+
+        rotation.rewind();
+        std::cout << "\n🎵 Auto-replay activated! Top " << moods[mood].name << " songs:" << std::endl;
+        for (size_t i = 0; i < rotation.size(); i++)
+        {
+            std::cout << (i + 1) << ". " << rotation.at(i)->toString() << std::endl;
+        }
+        replay_cycles++;
+        std::cout << "Replay cycle #" << replay_cycles << " starting...\n"
+                  << std::endl;
+    }
+
+public:
+    /**
+     * Get next song from the active replay rotation
+     * Time Complexity: O(1)
+     * Space Complexity: O(1)
+     */
+    Song *getNextReplaySong()
+    {
+        return replay_mood >= 0 ? moods[replay_mood].rotation.next() : nullptr;
+    }
+
+    /**
+     * Get play count statistics
+     * Time Complexity: O(n)
+     * Space Complexity: O(n)
+     */
+    std::unordered_map<std::string, int> getPlayCountStats()
+    {
+        flushPendingPlays();
+        if (heavy_hitters)
+        {
+            // Only the tracked heavy hitters are known in approximate mode
+            std::unordered_map<std::string, int> stats;
+            for (const auto &hitter : heavy_hitters->top(heavy_hitters->size()))
+            {
+                stats[hitter.key] = static_cast<int>(hitter.count);
+            }
+            return stats;
+        }
+        return play_counts;
+    }
+
+    std::vector<Song *> getTopSongsForMood(const std::string &mood_name)
+    {
+        flushPendingPlays();
+        int mood = findMood(mood_name);
+        return mood >= 0 ? moods[mood].top.top() : std::vector<Song *>();
+    }
+
+    std::vector<Song *> getTopCalming() { return getTopSongsForMood(moods[CALMING_MOOD].name); }
+
+    bool hasReplaySongs() const { return replay_mood >= 0 && !moods[replay_mood].rotation.empty(); }
+    void enableAutoReplay(bool enable) { auto_replay_enabled = enable; }
+    bool isAutoReplayEnabled() const { return auto_replay_enabled; }
+    int getReplayCycles() const { return replay_cycles; }
+
+    /**
+     * Display auto-replay statistics
+     */
+    void displayStats()
+    {
+        flushPendingPlays();
+        std::cout << "\n=== Auto-Replay Statistics ===" << std::endl;
+        std::cout << "Auto-replay enabled: " << (auto_replay_enabled ? "Yes" : "No") << std::endl;
+        std::cout << "Replay cycles completed: " << replay_cycles << std::endl;
+        std::cout << "Songs in replay queue: " << (replay_mood >= 0 ? moods[replay_mood].rotation.size() : 0)
+                  << (replay_mood >= 0 ? " (" + moods[replay_mood].name + ")" : "") << std::endl;
+        std::string dominant = getDominantMood();
+        std::cout << "Listening mood (last " << recent_moods.size() << " plays): "
+                  << (dominant.empty() ? "none yet" : dominant) << std::endl;
+        if (pending_plays)
+            std::cout << "Play counting: concurrent (" << pending_plays->shardCount() << " shards)" << std::endl;
+
+        if (heavy_hitters)
+        {
+            std::cout << "Play counting: approximate (count-min "
+                      << play_sketch->getWidth() << "x" << play_sketch->getDepth()
+                      << ", " << playCountMemoryBytes() << " bytes)" << std::endl;
+            auto top = heavy_hitters->top(5);
+            if (!top.empty())
+                std::cout << "\nTop played songs (estimated):" << std::endl;
+            for (size_t i = 0; i < top.size(); i++)
+            {
+                std::cout << (i + 1) << ". Song ID: " << top[i].key << " (~" << top[i].count
+                          << " plays, error <= " << top[i].error << ")" << std::endl;
+            }
+        }
+        else if (!play_counts.empty())
+        {
+            std::cout << "\nTop played songs:" << std::endl;
+            std::vector<std::pair<int, std::string>> sorted_plays;
+            for (const auto &pair : play_counts)
+            {
+                sorted_plays.push_back({pair.second, pair.first});
+            }
+            std::sort(sorted_plays.rbegin(), sorted_plays.rend());
+
+            for (size_t i = 0; i < std::min(size_t(5), sorted_plays.size()); i++)
+            {
+                std::cout << (i + 1) << ". Song ID: " << sorted_plays[i].second
+                          << " (" << sorted_plays[i].first << " plays)" << std::endl;
+            }
+        }
+        std::cout << "==============================\n"
+                  << std::endl;
+    }
+};
+
+/**
+ * Versioned binary engine state, see PlayWiseEngine::saveState
+ * Layout, in host byte order (little-endian on all supported targets):
+ *   Header
+ *   SongRecord[song_count]   fixed size, read in place from the mapping
+ *   uint32_t id_slots[id_slot_count], title_slots[title_slot_count],
+ *            playlist[playlist_count], history[history_count] (oldest first),
+ *            skipped[skipped_count] (oldest first)
+ *   string bytes             each song's fields back to back, in Field order
+ * Songs are referenced by their index in the record table. Collation keys and
+ * the lookup tables' slot layouts are persisted, so loading neither re-folds
+ * titles nor re-probes the ID and title indexes.
+ */
+struct EngineStateFormat
+{
+    static const uint32_t VERSION = 2;
+
+    enum Flags : uint32_t
+    {
+        PLAYLIST_ENDED = 1,
+        AUTO_REPLAY = 2
+    };
+
+    enum Field
+    {
+        ID,
+        TITLE,
+        ARTIST,
+        GENRE,
+        TITLE_KEY,
+        ARTIST_KEY,
+        FIELD_COUNT
+    };
+
+    struct Header
+    {
+        char magic[4]; // "PWST"
+        uint32_t version;
+        uint64_t file_size;
+        uint64_t song_count;
+        uint64_t id_slot_count;    // lookup table capacities, zero or a power of two
+        uint64_t title_slot_count;
+        uint64_t playlist_count;
+        uint64_t history_count;
+        uint64_t skipped_count;
+        uint64_t skip_capacity;
+        uint64_t string_bytes;
+        int64_t current_song; // record index, -1 when nothing is playing
+        uint32_t flags;
+        uint32_t reserved;
+        uint64_t hash_fingerprint; // hashFingerprint() of the writer; lookup slots are only reused on a match
+    };
+
+    struct SongRecord
+    {
+        uint64_t text_offset; // start of this song's fields in the string section
+        uint32_t lengths[FIELD_COUNT];
+        int32_t duration;
+        int32_t rating;
+        int32_t play_count;
+        uint32_t reserved;
+        uint64_t title_prefix;
+        uint64_t artist_prefix;
+        int64_t added_ns; // system_clock time since epoch
+    };
+
+    /**
+     * Identifies the string hash that placed the persisted lookup slots
+     * Another standard library or a seeded hash gives different probe
+     * positions, so a mismatch means the tables must be rebuilt
+     */
+    static uint64_t hashFingerprint()
+    {
+        using Index = SongKeyIndex<&Song::id>;
+        return Index::hashOf("PWST") ^ (Index::hashOf("playwise lookup probe") * 31);
+    }
+
+    /**
+     * Check that a whole state image is well formed before anything is built from it
+     * Returns nullptr when valid, otherwise what is wrong
+     * Time Complexity: O(n + p + h + s)
+     */
+    static const char *validate(const char *data, size_t size)
+    {
+        if (size < sizeof(Header))
+            return "file too small";
+
+        const Header &header = *reinterpret_cast<const Header *>(data);
+        if (!std::equal(header.magic, header.magic + 4, "PWST"))
+            return "not a PlayWise state file";
+        if (header.version != VERSION)
+            return "unsupported version";
+        if (header.file_size != size)
+            return "truncated or padded";
+
+        // Bound every count by the file size first so the sums below cannot overflow
+        if (header.song_count > size / sizeof(SongRecord) || header.id_slot_count > size / 4 ||
+            header.title_slot_count > size / 4 || header.playlist_count > size / 4 ||
+            header.history_count > size / 4 || header.skipped_count > size / 4 || header.string_bytes > size)
+            return "section sizes exceed the file";
+        uint64_t expected = sizeof(Header) + header.song_count * sizeof(SongRecord) +
+                            (header.id_slot_count + header.title_slot_count + header.playlist_count +
+                             header.history_count + header.skipped_count) *
+                                4 +
+                            header.string_bytes;
+        if (expected != size)
+            return "section sizes do not add up";
+        if (header.current_song < -1 || header.current_song >= static_cast<int64_t>(header.song_count))
+            return "current song out of range";
+
+        const SongRecord *records = reinterpret_cast<const SongRecord *>(data + sizeof(Header));
+        for (uint64_t i = 0; i < header.song_count; i++)
+        {
+            const SongRecord &record = records[i];
+            uint64_t text = 0;
+            for (uint32_t length : record.lengths)
+                text += length;
+            if (record.text_offset > header.string_bytes || text > header.string_bytes - record.text_offset)
+                return "song text out of range";
+            if (record.rating < 0 || record.rating > 5 || record.play_count < 0)
+                return "song fields out of range";
+        }
+
+        // Lookup tables must keep an empty slot so probes terminate
+        const uint32_t *slots = reinterpret_cast<const uint32_t *>(records + header.song_count);
+        for (uint64_t capacity : {header.id_slot_count, header.title_slot_count})
+        {
+            if ((capacity & (capacity - 1)) != 0 || (capacity == 0) != (header.song_count == 0))
+                return "lookup table size invalid";
+            uint64_t used = 0;
+            for (uint64_t i = 0; i < capacity; i++)
+            {
+                if (slots[i] == SongKeyIndex<&Song::id>::EMPTY_POSITION)
+                    continue;
+                if (slots[i] >= header.song_count)
+                    return "lookup slot out of range";
+                used++;
+            }
+            if (used >= capacity && capacity > 0)
+                return "lookup table full";
+            slots += capacity;
+        }
+
+        const uint32_t *indexes = slots;
+        uint64_t index_count = header.playlist_count + header.history_count + header.skipped_count;
+        for (uint64_t i = 0; i < index_count; i++)
+        {
+            if (indexes[i] >= header.song_count)
+                return "song reference out of range";
+        }
+        return nullptr;
+    }
+};
+
+/**
+ * Read-only memory mapping of a whole file
+ */
+class MappedFile
+{
+private:
+    const char *bytes;
+    size_t length;
+
+public:
+    explicit MappedFile(const std::string &path) : bytes(nullptr), length(0)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            void *mapped = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED)
+            {
+                bytes = static_cast<const char *>(mapped);
+                length = info.st_size;
+                ::madvise(mapped, length, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (bytes)
+            ::munmap(const_cast<char *>(bytes), length);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool isOpen() const { return bytes != nullptr; }
+    const char *data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+/**
+ * Description of a song for bulk ingest
+ * Fields are views and only need to outlive the addSongs call.
+ */
+struct SongSpec
+{
+    std::string_view id;
+    std::string_view title;
+    std::string_view artist;
+    std::string_view genre = "Unknown";
+    int duration = 0;
+    int rating = 0;
+};
+
+/**
+ * Bytes and object counts per engine component
+ * Rows come from each structure's size estimator (capacities, node layouts
+ * and heap-allocated string buffers), so reserved slack is counted but
+ * allocator headers are not. Catalog rows are shared by every session on
+ * the catalog; session rows belong to one engine. Both forms report bytes
+ * per 1k catalog songs so footprints compare across catalog sizes.
+ */
+struct MemoryReport
+{
+    struct Component
+    {
+        const char *scope; // "catalog" or "session"
+        const char *name;
+        size_t bytes;
+        size_t objects;
+        const char *unit; // what objects counts
+    };
+
+    std::vector<Component> components;
+    size_t catalog_songs = 0;
+
+    void add(const char *scope, const char *name, size_t bytes, size_t objects, const char *unit)
+    {
+        components.push_back(Component{scope, name, bytes, objects, unit});
+    }
+
+    // Bytes over every component, or over one scope
+    size_t totalBytes(const char *scope = nullptr) const
+    {
+        size_t bytes = 0;
+        for (const Component &component : components)
+        {
+            if (!scope || std::strcmp(component.scope, scope) == 0)
+                bytes += component.bytes;
+        }
+        return bytes;
+    }
+
+    double perThousandSongs(size_t bytes) const
+    {
+        return catalog_songs > 0 ? bytes * 1000.0 / catalog_songs : 0.0;
+    }
+
+    void print(std::ostream &out) const
+    {
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+
+        out << std::left << std::setw(9) << "Scope" << std::setw(14) << "Component" << std::right
+            << std::setw(12) << "Bytes" << std::setw(10) << "Objects" << "  " << std::left << std::setw(9) << "Unit"
+            << std::right << std::setw(12) << "Bytes/1k" << std::endl;
+        out << std::fixed << std::setprecision(0);
+        for (const Component &component : components)
+        {
+            out << std::left << std::setw(9) << component.scope << std::setw(14) << component.name << std::right
+                << std::setw(12) << component.bytes << std::setw(10) << component.objects << "  " << std::left
+                << std::setw(9) << component.unit << std::right << std::setw(12)
+                << perThousandSongs(component.bytes) << std::endl;
+        }
+        out << "Total: " << totalBytes() << " bytes (catalog " << totalBytes("catalog") << ", session "
+            << totalBytes("session") << "), " << perThousandSongs(totalBytes()) << " bytes per 1k songs" << std::endl;
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    // One JSON object on one line
+    void writeJson(std::ostream &out) const
+    {
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+
+        out << std::fixed << std::setprecision(1);
+        out << "{\"songs\":" << catalog_songs << ",\"total_bytes\":" << totalBytes()
+            << ",\"bytes_per_1k_songs\":" << perThousandSongs(totalBytes()) << ",\"components\":[";
+        for (size_t i = 0; i < components.size(); i++)
+        {
+            const Component &component = components[i];
+            out << (i > 0 ? "," : "") << "{\"scope\":\"" << component.scope << "\",\"name\":\"" << component.name
+                << "\",\"bytes\":" << component.bytes << ",\"objects\":" << component.objects
+                << ",\"unit\":\"" << component.unit << "\",\"bytes_per_1k_songs\":"
+                << perThousandSongs(component.bytes) << "}";
+        }
+        out << "]}" << std::endl;
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+};
+
+/**
+ * Song catalog shared by listener sessions
+ * Owns the songs and the catalog-wide indexes (ID/title lookup, rating tree,
+ * sorted views, longest songs). Per-listener state lives in PlayWiseEngine,
+ * so one catalog can back many sessions.
+ * Time Complexity: O(log n) per addSong
+ * Space Complexity: O(n) where n is number of songs
+ */
+class SongCatalog
+{
+private:
+    std::vector<Song *> songDatabase;      // Owns the song objects
+    std::vector<uint32_t> database_slot;   // Song handle -> index in songDatabase
+    InstantLookup lookup;
+    SongRatingTree ratingTree;
+    SortedViewIndex sorted_views;          // Materialized catalog orderings
+    GenreIndex genre_index;                // Songs per genre, maintained on add and re-tag
+    std::vector<Song *> top_longest_songs; // Maintained on addSong for the dashboard
+    std::unordered_map<int, int> rating_counts; // Rated songs per star, maintained for the dashboard
+    uint32_t next_handle;                  // Next Song::handle to assign
+    uint64_t revision;                     // Bumped on every change the dashboard shows
+
+    static const size_t TOP_LONGEST_COUNT = 5;
+
+public:
+    SongCatalog() : next_handle(0), revision(0) {}
+
+    ~SongCatalog()
+    {
+        // Clean up songs
+        for (Song *song : songDatabase)
+        {
+            delete song;
+        }
+    }
+
+    SongCatalog(const SongCatalog &) = delete;
+    SongCatalog &operator=(const SongCatalog &) = delete;
+
+    /**
+     * Add new song to the catalog
+     * IDs are unique, so removeSong can always reach every song:
+     * returns nullptr when the ID is already in the catalog
+     * Time Complexity: O(log n) due to BST insertion
+     * Space Complexity: O(1)
+     */
+    Song *addSong(const std::string &id, const std::string &title,
+                  const std::string &artist, int duration, int rating = 0,
+                  const std::string &genre = "Unknown")
+    {
+        if (lookup.contains_id(id))
+            return nullptr;
+        return adoptSong(new Song(id, title, artist, duration, rating, genre));
+    }
+
+    /**
+     * Add a batch of songs, building the indexes in one pass
+     * Storage is reserved up front, the clock is read once (songs are stamped
+     * one tick apart to keep their add order) and the rating tree takes the
+     * batch grouped by rating. Specs whose ID is already in the catalog, or
+     * earlier in the batch, are skipped.
+     * Time Complexity: O(b log n) for b songs
+     * Space Complexity: O(b)
+     */
+    std::vector<Song *> addSongs(const SongSpec *specs, size_t count)
+    {
+        reserve(songDatabase.size() + count);
+        std::vector<Song *> batch;
+        batch.reserve(count);
+
+        auto batch_time = std::chrono::system_clock::now();
+        for (size_t i = 0; i < count; i++)
+        {
+            const SongSpec &spec = specs[i];
+            if (lookup.contains_id(spec.id))
+                continue;
+            Song *song = new Song(std::string(spec.id), std::string(spec.title), std::string(spec.artist),
+                                  std::string(spec.genre), spec.duration, spec.rating,
+                                  batch_time + std::chrono::system_clock::duration(i));
+            song->handle = next_handle++;
+            database_slot.push_back(static_cast<uint32_t>(songDatabase.size()));
+            songDatabase.push_back(song);
+            lookup.add_song(song);
+            if (song->rating >= 1 && song->rating <= 5)
+                rating_counts[song->rating]++;
+            PlaylistSorter::insertTopK(top_longest_songs, song, TOP_LONGEST_COUNT, PlaylistSorter::DURATION_DESC);
+            sorted_views.add_song(song);
+            genre_index.add_song(song);
+            batch.push_back(song);
+        }
+        ratingTree.insert_songs(batch);
+        revision++;
+
+        return batch;
+    }
+
+    /**
+     * Take ownership of a fully built song and index it
+     * Bulk loaders that restore the lookup tables afterwards pass index_lookup = false
+     * Time Complexity: O(log n)
+     * Space Complexity: O(1)
+     */
+    Song *adoptSong(Song *song, bool index_lookup = true)
+    {
+        song->handle = next_handle++;
+        database_slot.push_back(static_cast<uint32_t>(songDatabase.size()));
+        songDatabase.push_back(song);
+
+        if (index_lookup)
+            lookup.add_song(song);
+        int rating = song->rating;
+        if (rating >= 1 && rating <= 5)
+        {
+            ratingTree.insert_song(song, rating);
+            rating_counts[rating]++;
+        }
+        PlaylistSorter::insertTopK(top_longest_songs, song, TOP_LONGEST_COUNT, PlaylistSorter::DURATION_DESC);
+        sorted_views.add_song(song);
+        genre_index.add_song(song);
+        revision++;
+
+        return song;
+    }
+
+    /**
+     * Rate (or re-rate) a song
+     * Moves the song between rating buckets and keeps the rating view in order
+     * Time Complexity: O(b) to leave the old bucket + O(log n) for tree and view
+     * Space Complexity: O(1)
+     */
+    bool rateSong(const std::string &song_id, int rating)
+    {
+        Song *song = lookup.lookup_by_id(song_id);
+        if (!song || rating < 1 || rating > 5)
+            return false;
+
+        if (song->rating >= 1 && song->rating <= 5) // Out-of-range ratings were never indexed
+        {
+            ratingTree.delete_song(song_id);
+            rating_counts[song->rating]--; // Empty buckets stay at 0, as in the rating tree
+        }
+        sorted_views.update_song(song, PlaylistSorter::RATING_DESC, [&]()
+                                 { ratingTree.insert_song(song, rating); });
+        rating_counts[rating]++;
+        revision++;
+        return true;
+    }
+
+    /**
+     * Remove a song from every catalog index and delete it
+     * Each index finds the song through a back-reference: the lookup tables
+     * by hash, the rating bucket and genre bucket by stored slot, the song
+     * list by database_slot (the last song takes the freed place). Only
+     * removing one of the five longest songs rescans for a replacement.
+     * Sessions must have dropped the song first.
+     * Time Complexity: O(log n) for the rating tree and sorted views, O(n) when a top-5 longest song goes
+     * Space Complexity: O(1)
+     */
+    void removeSong(Song *song)
+    {
+        lookup.remove_song(song);
+        if (song->rating >= 1 && song->rating <= 5 && ratingTree.remove_song(song))
+            rating_counts[song->rating]--;
+        sorted_views.remove_song(song);
+        genre_index.remove_song(song);
+
+        uint32_t slot = database_slot[song->handle];
+        songDatabase[slot] = songDatabase.back();
+        database_slot[songDatabase[slot]->handle] = slot;
+        songDatabase.pop_back();
+
+        auto longest = std::find(top_longest_songs.begin(), top_longest_songs.end(), song);
+        if (longest != top_longest_songs.end())
+        {
+            top_longest_songs.clear();
+            for (Song *candidate : songDatabase)
+                PlaylistSorter::insertTopK(top_longest_songs, candidate, TOP_LONGEST_COUNT, PlaylistSorter::DURATION_DESC);
+        }
+        revision++;
+        delete song;
+    }
+
+    /**
+     * Change a song's genre, keeping the genre index current
+     * Time Complexity: O(1) average
+     * Space Complexity: O(1)
+     */
+    bool setGenre(const std::string &song_id, const std::string &genre)
+    {
+        Song *song = lookup.lookup_by_id(song_id);
+        if (!song)
+            return false;
+        genre_index.change_genre(song, genre);
+        revision++;
+        return true;
+    }
+
+    /**
+     * Apply a change to Song::play_count, keeping the MOST_PLAYED view in order
+     */
+    void updatePlayCount(Song *song, const std::function<void()> &apply)
+    {
+        sorted_views.update_song(song, PlaylistSorter::MOST_PLAYED, apply);
+    }
+
+    void reserve(size_t songs)
+    {
+        songDatabase.reserve(songs);
+        database_slot.reserve(next_handle + (songs - std::min(songs, songDatabase.size())));
+        lookup.reserve(songs);
+        genre_index.reserve(songs);
+    }
+
+    /**
+     * Install persisted lookup tables; slot positions index getSongs()
+     */
+    void restoreLookup(const uint32_t *id_slots, size_t id_capacity, const uint32_t *title_slots, size_t title_capacity)
+    {
+        lookup.restore(songDatabase, id_slots, id_capacity, title_slots, title_capacity);
+    }
+
+    void materializeSortedView(PlaylistSorter::SortCriteria criteria)
+    {
+        sorted_views.createView(criteria, songDatabase);
+    }
+
+    void dropSortedView(PlaylistSorter::SortCriteria criteria)
+    {
+        sorted_views.dropView(criteria);
+    }
+
+    /**
+     * Add a row per catalog structure to a memory report
+     * Time Complexity: O(n + r) for n songs and r rating nodes
+     * Space Complexity: O(1)
+     */
+    void memoryUsage(MemoryReport &report) const
+    {
+        auto heapString = [](const std::string &text)
+        { return text.capacity() > 15 ? text.capacity() + 1 : 0; };
+
+        size_t song_bytes = 0;
+        for (const Song *song : songDatabase)
+        {
+            song_bytes += sizeof(Song) + heapString(song->id) + heapString(song->title) +
+                          heapString(song->artist) + heapString(song->genre) +
+                          heapString(song->title_key.folded) + heapString(song->artist_key.folded);
+        }
+        size_t table_bytes = sizeof(SongCatalog) + songDatabase.capacity() * sizeof(Song *) +
+                             database_slot.capacity() * sizeof(uint32_t) +
+                             top_longest_songs.capacity() * sizeof(Song *) +
+                             rating_counts.bucket_count() * sizeof(void *) +
+                             rating_counts.size() * (sizeof(std::pair<const int, int>) + sizeof(void *));
+
+        report.catalog_songs = songDatabase.size();
+        report.add("catalog", "songs", song_bytes, songDatabase.size(), "songs");
+        report.add("catalog", "song_table", table_bytes, songDatabase.size(), "slots");
+        report.add("catalog", "lookup", lookup.memoryBytes(), lookup.entryCount(), "entries");
+        report.add("catalog", "rating_tree", ratingTree.memoryBytes(), ratingTree.nodeCount(), "nodes");
+        report.add("catalog", "sorted_views", sorted_views.memoryBytes(), sorted_views.nodeCount(), "nodes");
+        report.add("catalog", "genre_index", genre_index.memoryBytes(), genre_index.genreCount(), "genres");
+    }
+
+    /**
+     * Approximate heap footprint of the songs and catalog indexes
+     * Time Complexity: O(n)
+     * Space Complexity: O(1)
+     */
+    size_t memoryBytes() const
+    {
+        MemoryReport report;
+        memoryUsage(report);
+        return report.totalBytes();
+    }
+
+    const std::vector<Song *> &getSongs() const { return songDatabase; }
+    const InstantLookup &getLookup() const { return lookup; }
+    const SongRatingTree &getRatingTree() const { return ratingTree; }
+    const SortedViewIndex &getSortedViews() const { return sorted_views; }
+    const GenreIndex &getGenreIndex() const { return genre_index; }
+    const std::vector<Song *> &getTopLongest() const { return top_longest_songs; }
+    const std::unordered_map<int, int> &getRatingCounts() const { return rating_counts; }
+    uint64_t getRevision() const { return revision; }
+    size_t size() const { return songDatabase.size(); }
+};
+
+/**
+ * Log-bucketed latency histogram (HDR-style)
+ * Each power of two is split into SUB_BUCKETS linear sub-buckets, so every
+ * value is reported within 1/SUB_BUCKETS (about 3%) of itself whatever its
+ * magnitude. Values are timer ticks; anything at or above 2^(MAX_MAGNITUDE+1)
+ * lands in the last bucket. Counters are relaxed atomics with one writing
+ * thread, so readers may merge them while the owner keeps recording.
+ * Time Complexity: O(1) to record, O(B) to merge or query B buckets
+ * Space Complexity: O(B), B = (MAX_MAGNITUDE - SUB_BITS + 2) * SUB_BUCKETS
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int SUB_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BITS;
+    static constexpr int MAX_MAGNITUDE = 36; // 2^37 TSC ticks is well over 20 s
+    static constexpr size_t BUCKET_COUNT = (MAX_MAGNITUDE - SUB_BITS + 2) * SUB_BUCKETS;
+
+private:
+    std::atomic<uint64_t> counts[BUCKET_COUNT];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> largest;
+
+    // Single-writer increment: no locked instruction on the recording path
+    static void bump(std::atomic<uint64_t> &counter, uint64_t by)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+public:
+    LatencyHistogram() { clear(); }
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    static size_t bucketOf(uint64_t value)
+    {
+        if (value < SUB_BUCKETS)
+            return static_cast<size_t>(value);
+        int magnitude = 63 - __builtin_clzll(value);
+        if (magnitude > MAX_MAGNITUDE)
+            return BUCKET_COUNT - 1;
+        int shift = magnitude - SUB_BITS;
+        return static_cast<size_t>((shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS));
+    }
+
+    // Midpoint of the values that share the bucket
+    static uint64_t bucketValue(size_t bucket)
+    {
+        if (bucket < SUB_BUCKETS)
+            return bucket;
+        int shift = static_cast<int>(bucket / SUB_BUCKETS) - 1;
+        uint64_t floor = (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+        return floor + ((uint64_t(1) << shift) >> 1);
+    }
+
+    void record(uint64_t value)
+    {
+        bump(counts[bucketOf(value)], 1);
+        bump(total, 1);
+        bump(sum, value);
+        if (value > largest.load(std::memory_order_relaxed))
+            largest.store(value, std::memory_order_relaxed);
+    }
+
+    // Add another histogram's counts to this one; this one must not be shared
+    void merge(const LatencyHistogram &other)
+    {
+        for (size_t b = 0; b < BUCKET_COUNT; b++)
+        {
+            uint64_t count = other.counts[b].load(std::memory_order_relaxed);
+            if (count > 0)
+                bump(counts[b], count);
+        }
+        bump(total, other.total.load(std::memory_order_relaxed));
+        bump(sum, other.sum.load(std::memory_order_relaxed));
+        largest.store(std::max(largest.load(std::memory_order_relaxed), other.largest.load(std::memory_order_relaxed)),
+                      std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        for (std::atomic<uint64_t> &count : counts)
+            count.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        sum.store(0, std::memory_order_relaxed);
+        largest.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * Nearest-rank percentile, 0 when empty
+     */
+    uint64_t percentile(double p) const
+    {
+        uint64_t count = total.load(std::memory_order_relaxed);
+        if (count == 0)
+            return 0;
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * count)));
+        uint64_t seen = 0;
+        for (size_t b = 0; b < BUCKET_COUNT; b++)
+        {
+            seen += counts[b].load(std::memory_order_relaxed);
+            if (seen >= rank)
+                return std::min(bucketValue(b), max());
+        }
+        return max();
+    }
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t totalValue() const { return sum.load(std::memory_order_relaxed); }
+    uint64_t max() const { return largest.load(std::memory_order_relaxed); }
+};
+
+/**
+ * Always-on counters and latency histograms for PlayWiseEngine operations
+ * Every public engine operation opens a Scope, which counts the call and
+ * records into the calling thread's own shard: no locks and no shared cache
+ * lines on the hot path. Calls are counted exactly; latency is timed on one
+ * call in every sampleInterval() per thread, since two timer reads alone
+ * cost more than the 20 ns budget on some machines. collect() merges all
+ * shards; report() prints the "stats" table and exposition() the Prometheus
+ * text format. Metrics are process-wide, shared by every engine. A shard is
+ * handed to the next new thread when its thread exits, so short-lived
+ * threads do not grow memory.
+ * Time Complexity: O(1) per operation, O(T * OP_COUNT * B) to collect over T shards
+ * Space Complexity: O(T * OP_COUNT * B)
+ */
+class EngineMetrics
+{
+public:
+    enum Op : uint8_t
+    {
+        ADD_SONG,
+        ADD_SONGS,
+        REMOVE_SONG,
+        QUEUE_SONG,
+        PLAY_SONG,
+        SKIP_SONG,
+        AUTO_PLAY_NEXT,
+        UNDO_PLAY,
+        RATE_SONG,
+        SET_GENRE,
+        SONGS_BY_GENRE,
+        SORT_PLAYLIST,
+        MATERIALIZE_VIEW,
+        APPLY_VIEW,
+        EXPORT_SNAPSHOT,
+        REFRESH_SNAPSHOT,
+        SAVE_STATE,
+        LOAD_STATE,
+        OP_COUNT
+    };
+
+    static const char *opName(Op op)
+    {
+        static const char *names[OP_COUNT] = {
+            "addSong", "addSongs", "removeSong", "queueSong", "playSong", "skipCurrentSong",
+            "autoPlayNext", "undoLastPlay", "rateSong", "setSongGenre", "getSongsByGenre",
+            "sortPlaylist", "materializeSortedView", "applySortedView", "export_snapshot",
+            "refresh_snapshot", "saveState", "loadState"};
+        return op < OP_COUNT ? names[op] : "unknown";
+    }
+
+    // Timer ticks: the time-stamp counter on x86, steady_clock nanoseconds elsewhere
+    static uint64_t ticks()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+    static constexpr uint32_t DEFAULT_SAMPLE_INTERVAL = 4;
+
+private:
+    struct Shard
+    {
+        std::atomic<uint64_t> calls[OP_COUNT];
+        LatencyHistogram histograms[OP_COUNT];
+        uint32_t countdown = 1; // calls until the next timed one; owner thread only
+
+        Shard()
+        {
+            for (std::atomic<uint64_t> &count : calls)
+                count.store(0, std::memory_order_relaxed);
+        }
+
+        // Count a call; returns its start tick if it is timed, else 0
+        uint64_t begin(Op op)
+        {
+            calls[op].store(calls[op].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if (--countdown > 0)
+                return 0;
+            countdown = sample_interval.load(std::memory_order_relaxed);
+            return ticks();
+        }
+    };
+
+    static std::atomic<uint32_t> sample_interval;
+
+public:
+    /**
+     * Counts the enclosing scope as one operation, timing it when sampled
+     */
+    class Scope
+    {
+    private:
+        Op op;
+        Shard &shard;
+        uint64_t start;
+
+    public:
+        explicit Scope(Op timed) : op(timed), shard(localShard()), start(shard.begin(timed)) {}
+        ~Scope()
+        {
+            if (start != 0)
+                shard.histograms[op].record(ticks() - start);
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    /**
+     * Time one call in every interval per thread (1 times every call)
+     */
+    static void setSampleInterval(uint32_t interval)
+    {
+        sample_interval.store(std::max<uint32_t>(interval, 1), std::memory_order_relaxed);
+    }
+
+    static uint32_t sampleInterval() { return sample_interval.load(std::memory_order_relaxed); }
+
+    /**
+     * Exact call counts and sampled latencies, merged over every thread
+     */
+    struct Summary
+    {
+        std::vector<uint64_t> calls;
+        std::vector<LatencyHistogram> latency;
+
+        Summary() : calls(OP_COUNT, 0), latency(OP_COUNT) {}
+    };
+
+    static Summary collect()
+    {
+        Summary merged;
+        Registry &state = registry();
+        std::lock_guard<std::mutex> guard(state.lock);
+        for (const auto &shard : state.shards)
+        {
+            for (size_t op = 0; op < OP_COUNT; op++)
+            {
+                merged.calls[op] += shard->calls[op].load(std::memory_order_relaxed);
+                merged.latency[op].merge(shard->histograms[op]);
+            }
+        }
+        return merged;
+    }
+
+    /**
+     * Zero every counter; call while no operation is running
+     */
+    static void reset()
+    {
+        Registry &state = registry();
+        std::lock_guard<std::mutex> guard(state.lock);
+        for (const auto &shard : state.shards)
+        {
+            for (size_t op = 0; op < OP_COUNT; op++)
+            {
+                shard->calls[op].store(0, std::memory_order_relaxed);
+                shard->histograms[op].clear();
+            }
+        }
+    }
+
+    /**
+     * Nanoseconds per tick, measured against steady_clock since first use
+     */
+    static double nanosPerTick()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        Registry &state = registry();
+        // A short baseline gives a noisy ratio; stretch it to a millisecond
+        std::chrono::steady_clock::time_point now;
+        while ((now = std::chrono::steady_clock::now()) - state.start_time < std::chrono::milliseconds(1))
+        {
+        }
+        uint64_t elapsed_ticks = ticks() - state.start_ticks;
+        double elapsed_nanos = std::chrono::duration<double, std::nano>(now - state.start_time).count();
+        return elapsed_ticks > 0 ? elapsed_nanos / elapsed_ticks : 1.0;
+#else
+        return 1.0;
+#endif
+    }
+
+    /**
+     * The "stats" table: calls and sampled p50/p99/p999/max per operation that ran
+     */
+    static void report(std::ostream &out)
+    {
+        Summary merged = collect();
+        double scale = nanosPerTick() / 1000.0;
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+
+        out << "\n=== Operation Latency ===" << std::endl;
+        out << std::left << std::setw(24) << "Operation" << std::right << std::setw(10) << "Count"
+            << std::setw(11) << "p50(us)" << std::setw(11) << "p99(us)" << std::setw(11) << "p999(us)"
+            << std::setw(11) << "max(us)" << std::endl;
+        out << std::fixed << std::setprecision(2);
+        for (size_t op = 0; op < OP_COUNT; op++)
+        {
+            const LatencyHistogram &histogram = merged.latency[op];
+            if (merged.calls[op] == 0)
+                continue;
+            out << std::left << std::setw(24) << opName(static_cast<Op>(op)) << std::right
+                << std::setw(10) << merged.calls[op]
+                << std::setw(11) << histogram.percentile(0.50) * scale
+                << std::setw(11) << histogram.percentile(0.99) * scale
+                << std::setw(11) << histogram.percentile(0.999) * scale
+                << std::setw(11) << histogram.max() * scale << std::endl;
+        }
+        out << "Latency sampled on 1 in " << sampleInterval() << " calls per thread" << std::endl;
+        out << "=========================" << std::endl;
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    /**
+     * Prometheus text exposition: a call counter and a latency summary
+     * (over the sampled calls, in seconds) per operation
+     */
+    static void exposition(std::ostream &out)
+    {
+        Summary merged = collect();
+        double scale = nanosPerTick() / 1e9;
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+
+        const char *counter = "playwise_operations_total";
+        out << "# HELP " << counter << " Calls of PlayWiseEngine operations." << std::endl;
+        out << "# TYPE " << counter << " counter" << std::endl;
+        for (size_t op = 0; op < OP_COUNT; op++)
+            out << counter << "{op=\"" << opName(static_cast<Op>(op)) << "\"} " << merged.calls[op] << std::endl;
+
+        const char *metric = "playwise_operation_duration_seconds";
+        out << "# HELP " << metric << " Latency of sampled PlayWiseEngine operations." << std::endl;
+        out << "# TYPE " << metric << " summary" << std::endl;
+        out << std::setprecision(9);
+        for (size_t op = 0; op < OP_COUNT; op++)
+        {
+            const LatencyHistogram &histogram = merged.latency[op];
+            std::string label = std::string("op=\"") + opName(static_cast<Op>(op)) + "\"";
+            for (double quantile : {0.5, 0.99, 0.999})
+            {
+                out << metric << "{" << label << ",quantile=\"" << quantile << "\"} ";
+                if (histogram.count() == 0)
+                    out << "NaN";
+                else
+                    out << histogram.percentile(quantile) * scale;
+                out << std::endl;
+            }
+            out << metric << "_sum{" << label << "} " << histogram.totalValue() * scale << std::endl;
+            out << metric << "_count{" << label << "} " << histogram.count() << std::endl;
+        }
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+private:
+    struct Registry
+    {
+        std::mutex lock;
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::vector<Shard *> idle; // shards of threads that have exited
+        uint64_t start_ticks = ticks();
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    };
+
+    // Leased to a thread for its lifetime, returned to the registry on exit
+    struct ShardLease
+    {
+        Shard *shard;
+
+        ShardLease()
+        {
+            Registry &state = registry();
+            std::lock_guard<std::mutex> guard(state.lock);
+            if (!state.idle.empty())
+            {
+                shard = state.idle.back();
+                state.idle.pop_back();
+            }
+            else
+            {
+                state.shards.push_back(std::make_unique<Shard>());
+                shard = state.shards.back().get();
+            }
+        }
+
+        ~ShardLease()
+        {
+            Registry &state = registry();
+            std::lock_guard<std::mutex> guard(state.lock);
+            state.idle.push_back(shard);
+        }
+    };
+
+    // Never destroyed, so threads exiting during shutdown can still return shards
+    static Registry &registry()
+    {
+        static Registry *state = new Registry();
+        return *state;
+    }
+
+    static Shard &localShard()
+    {
+        thread_local Shard *shard = nullptr; // trivially initialized: no TLS guard on the hot path
+        if (!shard)
+        {
+            thread_local ShardLease lease;
+            shard = lease.shard;
+        }
+        return *shard;
+    }
+};
+
+std::atomic<uint32_t> EngineMetrics::sample_interval(EngineMetrics::DEFAULT_SAMPLE_INTERVAL);
+
+/**
+ * Main PlayWise Engine Class - Integrates all components
+ * Holds one listener session: playlist, history, skips, replay and the
+ * current song. The catalog is either private to the engine or shared
+ * read-only with other sessions.
+ */
+class PlayWiseEngine
+{
+private:
+    std::shared_ptr<const SongCatalog> catalog;
+    SongCatalog *writable_catalog;          // Null when the catalog is shared read-only
+    PlaylistEngine playlist;
+    PlaybackHistory history;
+    RecentlySkippedTracker skipped_tracker; // New: Recently skipped tracker
+    AutoReplayManager replay_manager;       // New: Auto replay manager
+    Song *current_song;                     // Track currently playing song
+    bool playlist_ended;                    // Track if playlist has ended
+    SkipScoreTable skip_scores;             // Decayed skip score per song handle
+    float skip_threshold;                   // autoPlayNext avoids songs at or above this score
+    std::chrono::steady_clock::time_point start_time;
+
+public:
+    PlayWiseEngine() : PlayWiseEngine(std::make_shared<SongCatalog>())
+    {
+    }
+
+    /**
+     * Engine that owns (or co-owns) a writable catalog
+     */
+    explicit PlayWiseEngine(std::shared_ptr<SongCatalog> owned)
+        : catalog(owned), writable_catalog(owned.get()), current_song(nullptr), playlist_ended(false),
+          skip_threshold(0.5f), start_time(std::chrono::steady_clock::now())
+    {
+        // Play counts may be merged in lazily, so every change re-keys the MOST_PLAYED view
+        replay_manager.setPlayCountGuard([this](Song *song, const std::function<void()> &apply)
+                                         { writable_catalog->updatePlayCount(song, apply); });
+    }
+
+    /**
+     * Lightweight listener session on a shared, read-only catalog
+     * The session starts with an empty playlist (see queueSong). Its play
+     * counts stay in its own replay manager; Song::play_count is catalog-wide
+     * and left to the catalog owner.
+     */
+    explicit PlayWiseEngine(std::shared_ptr<const SongCatalog> shared)
+        : catalog(std::move(shared)), writable_catalog(nullptr), current_song(nullptr), playlist_ended(false),
+          skip_threshold(0.5f), start_time(std::chrono::steady_clock::now())
+    {
+        replay_manager.setPlayCountGuard([](Song *, const std::function<void()> &) {});
+    }
+
+    PlayWiseEngine(const PlayWiseEngine &) = delete;
+    PlayWiseEngine &operator=(const PlayWiseEngine &) = delete;
+
+    /**
+     * Add new song to the catalog and the playlist
+     * Ratings outside 0 (unrated) to 5 are refused, so every song can be saved
+     * and loaded, as are IDs already in the catalog
+     * Time Complexity: O(log n) due to BST insertion
+     * Space Complexity: O(1)
+     */
+    Song *addSong(const std::string &id, const std::string &title,
+                  const std::string &artist, int duration, int rating = 0,
+                  const std::string &genre = "Unknown")
+    {
+        EngineMetrics::Scope timed(EngineMetrics::ADD_SONG);
+        PW_TRACE_SPAN("addSong");
+        if (!writable_catalog)
+        {
+            std::cout << "❌ Catalog is shared read-only; songs cannot be added from a session" << std::endl;
+            return nullptr;
+        }
+        if (rating < 0 || rating > 5)
+        {
+            std::cout << "❌ Rating must be between 0 and 5: " << id << std::endl;
+            return nullptr;
+        }
+
+        Song *song = writable_catalog->addSong(id, title, artist, duration, rating, genre);
+        if (!song)
+        {
+            std::cout << "❌ Song ID already exists: " << id << std::endl;
+            return nullptr;
+        }
+        playlist.add_song(song);
+        return song;
+    }
+
+    /**
+     * Add a batch of songs to the catalog and the playlist, in order
+     * Equivalent to calling addSong for each spec, but the catalog indexes
+     * are built in one pass and the playlist nodes come from one allocation.
+     * Specs addSong would refuse are skipped; returns the number added.
+     * Time Complexity: O(b log n) for a batch of b songs
+     * Space Complexity: O(b)
+     */
+    size_t addSongs(const SongSpec *specs, size_t count)
+    {
+        EngineMetrics::Scope timed(EngineMetrics::ADD_SONGS);
+        PW_TRACE_SPAN("addSongs");
+        if (!writable_catalog)
+        {
+            std::cout << "❌ Catalog is shared read-only; songs cannot be added from a session" << std::endl;
+            return 0;
+        }
+
+        // Only a batch with refused specs pays for a filtered copy
+        auto refused = [](const SongSpec &spec)
+        { return spec.rating < 0 || spec.rating > 5; };
+        std::vector<SongSpec> accepted;
+        if (std::any_of(specs, specs + count, refused))
+        {
+            std::copy_if(specs, specs + count, std::back_inserter(accepted), [&](const SongSpec &spec)
+                         { return !refused(spec); });
+            std::cout << "❌ Skipped " << count - accepted.size() << " songs with a rating outside 0-5" << std::endl;
+            specs = accepted.data();
+            count = accepted.size();
+        }
+
+        std::vector<Song *> songs = writable_catalog->addSongs(specs, count);
+        if (songs.size() < count)
+            std::cout << "❌ Skipped " << count - songs.size() << " songs whose ID already exists" << std::endl;
+        playlist.append_songs(songs.data(), songs.size());
+        return songs.size();
+    }
+
+    size_t addSongs(const std::vector<SongSpec> &specs) { return addSongs(specs.data(), specs.size()); }
+
+    /**
+     * Remove a song from the catalog and from every structure of this session
+     * Refused while other sessions share the catalog, since their playlists
+     * and histories may still point at the song.
+     * Time Complexity: O(k) for k playlist/history occurrences + O(log n) per catalog index
+     * Space Complexity: O(1)
+     */
+    bool removeSong(const std::string &song_id)
+    {
+        EngineMetrics::Scope timed(EngineMetrics::REMOVE_SONG);
+        PW_TRACE_SPAN("removeSong");
+        if (!writable_catalog)
+        {
+            std::cout << "❌ Catalog is shared read-only; songs cannot be removed from a session" << std::endl;
+            return false;
+        }
+        if (catalog.use_count() > 1)
+        {
+            std::cout << "❌ Catalog is shared with other sessions; close them before removing songs" << std::endl;
+            return false;
+        }
+        Song *song = catalog->getLookup().lookup_by_id(song_id);
+        if (!song)
+            return false;
+
+        replay_manager.flushPendingPlays(); // No pending play may still name the song
+        playlist.remove_all(song);
+        history.remove_all(song);
+        skipped_tracker.removeSkippedSong(song->id);
+        skip_scores.reset(song->handle);
+        replay_manager.forgetSong(song, catalog->getGenreIndex());
+        if (current_song == song)
+            current_song = nullptr;
+        writable_catalog->removeSong(song);
+        return true;
+    }
+
+    /**
+     * Append a catalog song to this session's playlist
+     * Time Complexity: O(1) average
+     * Space Complexity: O(1)
+     */
+    bool queueSong(const std::string &song_id)
+    {
+        EngineMetrics::Scope timed(EngineMetrics::QUEUE_SONG);
+        Song *song = catalog->getLookup().lookup_by_id(song_id);
+        if (!song)
+            return false;
+        playlist.add_song(song);
+        return true;
+    }
+
+    void playSong(const std::string &song_id)
+    {
+        EngineMetrics::Scope timed(EngineMetrics::PLAY_SONG);
+        PW_TRACE_SPAN("playSong");
+        Song *song = catalog->getLookup().lookup_by_id(song_id);
+        if (song)
+        {
+            // Check if song was recently skipped
+            if (skipped_tracker.wasRecentlySkipped(song_id))
+            {
+                std::cout << "⚠️  Warning: This song was recently skipped. Playing anyway..." << std::endl;
+            }
+
+            current_song = song;
+            history.play_song(song);
+            replay_manager.trackListeningMood(song);
+            replay_manager.recordPlay(song); // Record play count
+            playlist_ended = false;
+
+            std::cout << "🎵 Now playing: " << song->toString() << std::endl;
+        }
+        else
+        {
+            std::cout << "❌ Song not found!" << std::endl;
+        }
+    }
+
+    /**
+     * Skip current song and add to recently skipped tracker
+     * Time Complexity: O(1)
+     * Space Complexity: O(1)
+     */
+    void skipCurrentSong()
+    {
+        EngineMetrics::Scope timed(EngineMetrics::SKIP_SONG);
+        PW_TRACE_SPAN("skipCurrentSong");
+        if (current_song)
+        {
+            skipped_tracker.addSkippedSong(current_song->id);
+            skip_scores.recordSkip(current_song->handle, nowSeconds());
+            std::cout << "⏭️  Skipped: " << current_song->toString() << std::endl;
+            std::cout << "Added to recently skipped list (" << skipped_tracker.size() << "/"
+                      << skipped_tracker.capacity() << ")" << std::endl;
+            current_song = nullptr;
+        }
+        else
+        {
+            std::cout << "❌ No song is currently playing!" << std::endl;
+        }
+    }
+
+    /**
+     * Auto-play next song with smart selection
+     * Avoids songs whose decayed skip score is at or above the threshold
+     * unless no alternatives, then plays the least-skipped one
+     * Time Complexity: O(n) where n is playlist size (O(1) score check per song)
+     * Space Complexity: O(n) for the playlist snapshot
+     */
+    Song *autoPlayNext()
+    {
+        EngineMetrics::Scope timed(EngineMetrics::AUTO_PLAY_NEXT);
+        PW_TRACE_SPAN("autoPlayNext");
+        auto all_songs = playlist.getAllSongs();
+        double now = nowSeconds();
+
+        // First, try to find a song that hasn't been skipped much lately
+        Song *least_skipped = nullptr;
+        float least_score = 0.0f;
+        for (Song *song : all_songs)
+        {
+            if (!song)
+                continue;
+
+            float score = skip_scores.score(song->handle, now);
+            if (score < skip_threshold)
+            {
+                playSong(song->id);
+                return song;
+            }
+            if (!least_skipped || score < least_score)
+            {
+                least_skipped = song;
+                least_score = score;
+            }
+        }
+
+        // If all songs were skipped, check for auto-replay
+        if (all_songs.empty() || checkAndHandlePlaylistEnd())
+        {
+            return nullptr;
+        }
+
+        // Last resort: play the song with the lowest skip score
+        if (least_skipped)
+        {
+            std::cout << "🔄 All songs were recently skipped. Playing least skipped..." << std::endl;
+            playSong(least_skipped->id);
+            return least_skipped;
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Configure skip score decay
+     * A skip adds 1 and halves every half_life_seconds; autoPlayNext avoids
+     * songs scoring at or above threshold
+     */
+    void setSkipDecay(double half_life_seconds, float threshold)
+    {
+        skip_scores.setHalfLife(half_life_seconds, nowSeconds());
+        skip_threshold = threshold;
+    }
+
+    /**
+     * Switch per-session play counts and the skip window to probabilistic
+     * structures for large deployments (see CountMinSketch, SpaceSavingCounter
+     * and ApproximateSkipWindow for the error bounds)
+     */
+    void enableApproximateMode(double epsilon = 0.001, double delta = 0.01,
+                               size_t top_k = 100, double skip_false_positive_rate = 0.01)
+    {
+        replay_manager.enableApproximateCounting(epsilon, delta, top_k);
+        skipped_tracker.enableApproximate(skip_false_positive_rate);
+    }
+
+    float getSkipScore(const std::string &song_id) const
+    {
+        const Song *song = catalog->getLookup().lookup_by_id(song_id);
+        return song ? skip_scores.score(song->handle, nowSeconds()) : 0.0f;
+    }
+
+    /**
+     * Check if playlist ended and auto-replay the top songs of the listening mood
+     * Time Complexity: O(k log k) for auto-replay setup
+     * Space Complexity: O(k) where k is replay queue size
+     */
+    bool checkAndHandlePlaylistEnd()
+    {
+        if (playlist.getSize() == 0)
+        {
+            playlist_ended = true;
+            std::cout << "📋 Playlist ended!" << std::endl;
+
+            if (replay_manager.isAutoReplayEnabled())
+            {
+                replay_manager.setupAutoReplay();
+
+                Song *replay_song = replay_manager.getNextReplaySong();
+                if (replay_song)
+                {
+                    std::cout << "🔁 Auto-replaying " << replay_manager.getReplayMood() << " song..." << std::endl;
+                    playSong(replay_song->id);
+                    return false; // Continue playing
+                }
+            }
+
+            std::cout << "🎵 No more songs to play. Add more songs or enable auto-replay!" << std::endl;
+            return true; // Playlist truly ended
+        }
+        return false;
+    }
+
+    void undoLastPlay()
+    {
+        EngineMetrics::Scope timed(EngineMetrics::UNDO_PLAY);
+        Song *song = history.undo_last_play();
+        if (song)
+        {
+            replay_manager.untrackListeningMood();
+            playlist.add_song(song);
+            std::cout << "Re-added to playlist: " << song->toString() << std::endl;
+        }
+    }
+
+    /**
+     * Rate (or re-rate) a song
+     * Moves the song between rating buckets and keeps the rating view in order
+     * Time Complexity: O(b) to leave the old bucket + O(log n) for tree and view
+     * Space Complexity: O(1)
+     */
+    bool rateSong(const std::string &song_id, int rating)
+    {
+        EngineMetrics::Scope timed(EngineMetrics::RATE_SONG);
+        return writable_catalog && writable_catalog->rateSong(song_id, rating);
+    }
+
+    void sortPlaylist(PlaylistSorter::SortCriteria criteria, bool useQuickSort = false)
+    {
+        EngineMetrics::Scope timed(EngineMetrics::SORT_PLAYLIST);
+        PW_TRACE_SPAN("sortPlaylist");
+        replay_manager.flushPendingPlays(); // MOST_PLAYED needs merged counts
+        if (catalog->getSortedViews().hasView(criteria))
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            applySortedView(criteria);
+            auto end = std::chrono::high_resolution_clock::now();
+
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+            std::cout << "Applied sorted view '" << SortedViewIndex::viewName(criteria) << "' in "
+                      << duration.count() << " microseconds" << std::endl;
+            return;
+        }
+
+        auto songs = playlist.getAllSongs();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        PlaylistSorter::sort(songs, criteria, useQuickSort);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        playlist.rebuildFromVector(songs);
+
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        std::cout << "Sorting completed in " << duration.count() << " microseconds" << std::endl;
+    }
+
+    /**
+     * Materialize a sorted view of the catalog for a criteria
+     * Later sortPlaylist calls with that criteria (or its reverse) relink
+     * the playlist from the view instead of sorting
+     * Time Complexity: O(n log n) once, then O(log n) per catalog update
+     * Space Complexity: O(n)
+     */
+    bool materializeSortedView(PlaylistSorter::SortCriteria criteria)
+    {
+        EngineMetrics::Scope timed(EngineMetrics::MATERIALIZE_VIEW);
+        if (!writable_catalog)
+            return false;
+        writable_catalog->materializeSortedView(criteria);
+        return true;
+    }
+
+    void dropSortedView(PlaylistSorter::SortCriteria criteria)
+    {
+        if (writable_catalog)
+            writable_catalog->dropSortedView(criteria);
+    }
+
+    /**
+     * Reorder the playlist by walking a materialized view
+     * Songs queued more than once keep all their entries
+     * Time Complexity: O(N + m) where N is catalog size and m is playlist size
+     * Space Complexity: O(m)
+     */
+    void applySortedView(PlaylistSorter::SortCriteria criteria)
+    {
+        EngineMetrics::Scope timed(EngineMetrics::APPLY_VIEW);
+        PW_TRACE_SPAN("applySortedView");
+        auto songs = playlist.getAllSongs();
+        std::unordered_map<Song *, int> membership;
+        membership.reserve(songs.size());
+        for (Song *song : songs)
+        {
+            membership[song]++;
+        }
+
+        std::vector<Song *> ordered;
+        ordered.reserve(songs.size());
+        catalog->getSortedViews().forEach(criteria, [&](Song *song)
+                             {
+            auto it = membership.find(song);
+            if (it == membership.end())
+                return;
+            for (int i = 0; i < it->second; i++)
+                ordered.push_back(song); });
+
+        playlist.rebuildFromVector(ordered);
+    }
+
+    /**
+     * System Snapshot for Dashboard
+     * Every field is maintained as the catalog, history and playlist change,
+     * so exporting only copies them.
+     * Time Complexity: O(k) for the top longest and recently played songs
+     * Space Complexity: O(k)
+     */
+    struct SystemSnapshot
+    {
+        std::vector<Song *> top_longest_songs;
+        std::vector<Song *> recently_played;
+        std::unordered_map<int, int> rating_counts;
+        int total_songs = 0;
+        int playlist_size = 0;
+        uint64_t version = UINT64_MAX; // snapshot_version() when exported; never a real version by default
+    };
+
+    SystemSnapshot export_snapshot() const
+    {
+        EngineMetrics::Scope timed(EngineMetrics::EXPORT_SNAPSHOT);
+        SystemSnapshot snapshot;
+        snapshot.version = snapshot_version();
+
+        // Top 5 longest songs
+        snapshot.top_longest_songs = catalog->getTopLongest();
+
+        // Recently played songs
+        snapshot.recently_played = history.getRecentlyPlayed(5);
+
+        // Song count by rating
+        snapshot.rating_counts = catalog->getRatingCounts();
+
+        // General stats
+        snapshot.total_songs = catalog->size();
+        snapshot.playlist_size = playlist.getSize();
+
+        return snapshot;
+    }
+
+    /**
+     * Changes whenever any snapshot field may have changed
+     * Time Complexity: O(1)
+     */
+    uint64_t snapshot_version() const
+    {
+        return catalog->getRevision() + history.getRevision() + playlist.getRevision();
+    }
+
+    /**
+     * Bring a previously exported snapshot up to date
+     * Returns false without touching it when nothing has changed since
+     * Time Complexity: O(1) when unchanged, O(k) otherwise
+     */
+    bool refresh_snapshot(SystemSnapshot &snapshot) const
+    {
+        EngineMetrics::Scope timed(EngineMetrics::REFRESH_SNAPSHOT);
+        if (snapshot.version == snapshot_version())
+            return false;
+        snapshot = export_snapshot();
+        return true;
+    }
+
+    void displaySnapshot()
+    {
+        auto snapshot = export_snapshot();
+
+        std::cout << "\n=== PlayWise System Snapshot ===" << std::endl;
+        std::cout << "Total Songs: " << snapshot.total_songs << std::endl;
+        std::cout << "Playlist Size: " << snapshot.playlist_size << std::endl;
+
+        std::cout << "\nTop 5 Longest Songs:" << std::endl;
+        for (size_t i = 0; i < snapshot.top_longest_songs.size(); i++)
+        {
+            std::cout << (i + 1) << ". " << snapshot.top_longest_songs[i]->toString() << std::endl;
+        }
+
+        std::cout << "\nRecently Played:" << std::endl;
+        for (size_t i = 0; i < snapshot.recently_played.size(); i++)
+        {
+            std::cout << (i + 1) << ". " << snapshot.recently_played[i]->toString() << std::endl;
+        }
+
+        std::cout << "\nSong Count by Rating:" << std::endl;
+        for (int rating = 1; rating <= 5; rating++)
+        {
+            int count = (snapshot.rating_counts.find(rating) != snapshot.rating_counts.end())
+                            ? snapshot.rating_counts[rating]
+                            : 0;
+            std::cout << rating << " stars: " << count << " songs" << std::endl;
+        }
+
+        std::cout << "\nMemory by Component:" << std::endl;
+        memoryReport().print(std::cout);
+        std::cout << "================================\n"
+                  << std::endl;
+    }
+
+    /**
+     * Save songs, playlist order, history, ratings, skips and play counts
+     * Written to a temporary file and renamed over path, so a failed save
+     * never leaves a torn state file behind.
+     * Time Complexity: O(n + p + h) for n songs, p playlist entries and h plays
+     * Space Complexity: O(n) for the record table
+     */
+    bool saveState(const std::string &path)
+    {
+        EngineMetrics::Scope timed(EngineMetrics::SAVE_STATE);
+        PW_TRACE_SPAN("saveState");
+        if (!writable_catalog)
+        {
+            std::cout << "❌ Only the catalog owner can save engine state" << std::endl;
+            return false;
+        }
+        replay_manager.flushPendingPlays();
+
+        const std::vector<Song *> &songs = catalog->getSongs();
+        uint32_t handle_bound = 0;
+        for (Song *song : songs)
+            handle_bound = std::max(handle_bound, song->handle + 1);
+        std::vector<uint32_t> position_of(handle_bound);
+        for (size_t i = 0; i < songs.size(); i++)
+            position_of[songs[i]->handle] = static_cast<uint32_t>(i);
+
+        std::vector<EngineStateFormat::SongRecord> records(songs.size());
+        uint64_t string_bytes = 0;
+        for (size_t i = 0; i < songs.size(); i++)
+        {
+            const Song *song = songs[i];
+            EngineStateFormat::SongRecord &record = records[i];
+            const std::string *fields[] = {&song->id, &song->title, &song->artist, &song->genre,
+                                           &song->title_key.folded, &song->artist_key.folded};
+            record.text_offset = string_bytes;
+            for (int field = 0; field < EngineStateFormat::FIELD_COUNT; field++)
+            {
+                record.lengths[field] = static_cast<uint32_t>(fields[field]->size());
+                string_bytes += fields[field]->size();
+            }
+            record.duration = song->duration;
+            record.rating = song->rating;
+            record.play_count = song->play_count;
+            record.reserved = 0;
+            record.title_prefix = song->title_key.prefix;
+            record.artist_prefix = song->artist_key.prefix;
+            record.added_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  song->added_time.time_since_epoch())
+                                  .count();
+        }
+
+        std::vector<uint32_t> id_slots, title_slots;
+        catalog->getLookup().persist([&position_of](Song *song)
+                                     { return position_of[song->handle]; },
+                                     id_slots, title_slots);
+
+        std::vector<uint32_t> indexes;
+        for (Song *song : playlist.getAllSongs())
+            indexes.push_back(position_of[song->handle]);
+        size_t playlist_count = indexes.size();
+
+        std::vector<Song *> played = history.getRecentlyPlayed(history.size());
+        for (auto it = played.rbegin(); it != played.rend(); ++it)
+            indexes.push_back(position_of[(*it)->handle]);
+
+        std::vector<std::string> skipped = skipped_tracker.getRecentlySkipped();
+        size_t skipped_count = 0;
+        for (auto it = skipped.rbegin(); it != skipped.rend(); ++it)
+        {
+            Song *song = catalog->getLookup().lookup_by_id(*it);
+            if (song)
+            {
+                indexes.push_back(position_of[song->handle]);
+                skipped_count++;
+            }
+        }
+
+        EngineStateFormat::Header header = {};
+        std::copy_n("PWST", 4, header.magic);
+        header.version = EngineStateFormat::VERSION;
+        header.hash_fingerprint = EngineStateFormat::hashFingerprint();
+        header.song_count = songs.size();
+        header.id_slot_count = id_slots.size();
+        header.title_slot_count = title_slots.size();
+        header.playlist_count = playlist_count;
+        header.history_count = played.size();
+        header.skipped_count = skipped_count;
+        header.skip_capacity = skipped_tracker.capacity();
+        header.string_bytes = string_bytes;
+        header.current_song = current_song ? static_cast<int64_t>(position_of[current_song->handle]) : -1;
+        header.flags = (playlist_ended ? EngineStateFormat::PLAYLIST_ENDED : 0u) |
+                       (replay_manager.isAutoReplayEnabled() ? EngineStateFormat::AUTO_REPLAY : 0u);
+        header.file_size = sizeof(header) + records.size() * sizeof(EngineStateFormat::SongRecord) +
+                           (id_slots.size() + title_slots.size() + indexes.size()) * sizeof(uint32_t) + string_bytes;
+
+        std::string temp_path = path + ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(EngineStateFormat::SongRecord));
+            out.write(reinterpret_cast<const char *>(id_slots.data()), id_slots.size() * sizeof(uint32_t));
+            out.write(reinterpret_cast<const char *>(title_slots.data()), title_slots.size() * sizeof(uint32_t));
+            out.write(reinterpret_cast<const char *>(indexes.data()), indexes.size() * sizeof(uint32_t));
+            for (const Song *song : songs)
+            {
+                out << song->id << song->title << song->artist << song->genre
+                    << song->title_key.folded << song->artist_key.folded;
+            }
+            out.close();
+            if (!out)
+            {
+                std::remove(temp_path.c_str());
+                std::cout << "❌ Cannot write state file: " << path << std::endl;
+                return false;
+            }
+        }
+        if (std::rename(temp_path.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temp_path.c_str());
+            std::cout << "❌ Cannot replace state file: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Load state written by saveState into an empty engine
+     * The file is memory-mapped and validated before anything is built; song
+     * records are read in place, the lookup tables are copied from their
+     * persisted layout (or rebuilt if the file was written under a different
+     * string hash) and the other indexes are filled in one pass.
+     * Skip scores are time-relative and start fresh.
+     * Time Complexity: O(n + p + h)
+     * Space Complexity: O(n)
+     */
+    bool loadState(const std::string &path)
+    {
+        EngineMetrics::Scope timed(EngineMetrics::LOAD_STATE);
+        PW_TRACE_SPAN("loadState");
+        if (!writable_catalog || catalog->size() > 0 || playlist.getSize() > 0 || !history.isEmpty())
+        {
+            std::cout << "❌ State can only be loaded into an empty engine that owns its catalog" << std::endl;
+            return false;
+        }
+
+        MappedFile file(path);
+        if (!file.isOpen())
+        {
+            std::cout << "❌ Cannot open state file: " << path << std::endl;
+            return false;
+        }
+        const char *error = EngineStateFormat::validate(file.data(), file.size());
+        if (error)
+        {
+            std::cout << "❌ Invalid state file " << path << ": " << error << std::endl;
+            return false;
+        }
+
+        const auto &header = *reinterpret_cast<const EngineStateFormat::Header *>(file.data());
+        const auto *records = reinterpret_cast<const EngineStateFormat::SongRecord *>(file.data() + sizeof(header));
+        const uint32_t *id_slots = reinterpret_cast<const uint32_t *>(records + header.song_count);
+        const uint32_t *title_slots = id_slots + header.id_slot_count;
+        const uint32_t *playlist_order = title_slots + header.title_slot_count;
+        const uint32_t *played = playlist_order + header.playlist_count;
+        const uint32_t *skipped = played + header.history_count;
+        const char *strings = reinterpret_cast<const char *>(skipped + header.skipped_count);
+
+        // Persisted slots are only valid under the hash that placed them; otherwise re-index
+        bool same_hash = header.hash_fingerprint == EngineStateFormat::hashFingerprint();
+        std::vector<Song *> loaded;
+        loaded.reserve(header.song_count);
+        writable_catalog->reserve(header.song_count);
+        skip_scores.reserve(header.song_count);
+        for (uint64_t i = 0; i < header.song_count; i++)
+        {
+            const EngineStateFormat::SongRecord &record = records[i];
+            const char *text = strings + record.text_offset;
+            auto field = [&](int index)
+            {
+                std::string value(text, record.lengths[index]);
+                text += record.lengths[index];
+                return value;
+            };
+
+            std::string id = field(EngineStateFormat::ID);
+            std::string title = field(EngineStateFormat::TITLE);
+            std::string artist = field(EngineStateFormat::ARTIST);
+            std::string genre = field(EngineStateFormat::GENRE);
+            CollationKey title_key, artist_key;
+            title_key.folded = field(EngineStateFormat::TITLE_KEY);
+            title_key.prefix = record.title_prefix;
+            artist_key.folded = field(EngineStateFormat::ARTIST_KEY);
+            artist_key.prefix = record.artist_prefix;
+            std::chrono::system_clock::time_point added(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(record.added_ns)));
+
+            loaded.push_back(writable_catalog->adoptSong(new Song(std::move(id), std::move(title), std::move(artist),
+                                                                  std::move(genre), record.duration, record.rating,
+                                                                  std::move(title_key), std::move(artist_key), added),
+                                                         !same_hash));
+        }
+        if (same_hash)
+            writable_catalog->restoreLookup(id_slots, header.id_slot_count, title_slots, header.title_slot_count);
+
+        for (uint64_t i = 0; i < header.song_count; i++)
+            replay_manager.restorePlays(loaded[i], records[i].play_count);
+        std::vector<Song *> queued(header.playlist_count);
+        for (uint64_t i = 0; i < header.playlist_count; i++)
+            queued[i] = loaded[playlist_order[i]];
+        playlist.append_songs(queued.data(), queued.size());
+        for (uint64_t i = 0; i < header.history_count; i++)
+        {
+            history.play_song(loaded[played[i]]);
+            replay_manager.trackListeningMood(loaded[played[i]]);
+        }
+        skipped_tracker.setCapacity(header.skip_capacity);
+        for (uint64_t i = 0; i < header.skipped_count; i++)
+            skipped_tracker.addSkippedSong(loaded[skipped[i]]->id);
+
+        current_song = header.current_song >= 0 ? loaded[header.current_song] : nullptr;
+        playlist_ended = (header.flags & EngineStateFormat::PLAYLIST_ENDED) != 0;
+        replay_manager.enableAutoReplay((header.flags & EngineStateFormat::AUTO_REPLAY) != 0);
+        return true;
+    }
+
+    /**
+     * Memory held by one listener session, excluding the shared catalog
+     */
+    struct SessionFootprint
+    {
+        size_t engine;   // the PlayWiseEngine object itself
+        size_t playlist; // playlist nodes
+        size_t history;
+        size_t skips;    // recently-skipped tracker and skip scores
+        size_t replay;   // play counts, mood rankings and rotations
+
+        size_t total() const { return engine + playlist + history + skips + replay; }
+    };
+
+    /**
+     * Time Complexity: O(n) over this session's counted songs
+     * Space Complexity: O(1)
+     */
+    SessionFootprint sessionFootprint() const
+    {
+        SessionFootprint footprint;
+        footprint.engine = sizeof(PlayWiseEngine);
+        footprint.playlist = playlist.memoryBytes();
+        footprint.history = history.memoryBytes();
+        footprint.skips = skipped_tracker.memoryBytes() + skip_scores.memoryBytes();
+        footprint.replay = replay_manager.memoryBytes();
+        return footprint;
+    }
+
+    /**
+     * Per-structure bytes and object counts: the catalog's rows, then this session's
+     * Time Complexity: O(n) over the catalog songs and this session's counted songs
+     * Space Complexity: O(1)
+     */
+    MemoryReport memoryReport() const
+    {
+        MemoryReport report;
+        catalog->memoryUsage(report);
+        report.add("session", "engine", sizeof(PlayWiseEngine), 1, "engines");
+        report.add("session", "playlist", playlist.memoryBytes(), playlist.getSize(), "nodes");
+        report.add("session", "history", history.memoryBytes(), history.size(), "plays");
+        report.add("session", "skip_tracker", skipped_tracker.memoryBytes(), skipped_tracker.size(), "songs");
+        report.add("session", "skip_scores", skip_scores.memoryBytes(), skip_scores.slotCount(), "slots");
+        report.add("session", "replay", replay_manager.memoryBytes(), replay_manager.trackedSongCount(), "songs");
+        return report;
+    }
+
+    void displayMemoryFootprint() const
+    {
+        SessionFootprint footprint = sessionFootprint();
+        std::cout << "\n=== Memory Footprint ===" << std::endl;
+        std::cout << "Session: " << footprint.total() << " bytes (engine " << footprint.engine
+                  << ", playlist " << footprint.playlist << ", history " << footprint.history
+                  << ", skips " << footprint.skips << ", replay " << footprint.replay << ")" << std::endl;
+        std::cout << "Catalog: " << catalog->memoryBytes() << " bytes for " << catalog->size()
+                  << " songs, shared by " << catalog.use_count() << " holder(s)" << std::endl;
+        std::cout << "========================\n"
+                  << std::endl;
+    }
+
+    // Accessor methods for testing
+    PlaylistEngine &getPlaylist() { return playlist; }
+    PlaybackHistory &getHistory() { return history; }
+    const SongRatingTree &getRatingTree() const { return catalog->getRatingTree(); }
+    const InstantLookup &getLookup() const { return catalog->getLookup(); }
+    RecentlySkippedTracker &getSkippedTracker() { return skipped_tracker; }
+    AutoReplayManager &getReplayManager() { return replay_manager; }
+    const std::vector<Song *> &getSongDatabase() const { return catalog->getSongs(); }
+    const SortedViewIndex &getSortedViews() const { return catalog->getSortedViews(); }
+    std::shared_ptr<const SongCatalog> getCatalog() const { return catalog; }
+    bool ownsCatalog() const { return writable_catalog != nullptr; }
+    SkipScoreTable &getSkipScores() { return skip_scores; }
+
+    // Seconds since the engine started, the time base for skip scores
+    double nowSeconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    }
+
+    /**
+     * Display recently skipped songs
+     */
+    void displayRecentlySkipped() const
+    {
+        std::cout << "\n=== Recently Skipped Songs ===" << std::endl;
+        if (skipped_tracker.empty())
+        {
+            std::cout << "No recently skipped songs." << std::endl;
+        }
+        else if (skipped_tracker.isApproximate())
+        {
+            std::cout << "Approximate mode: about " << skipped_tracker.size()
+                      << " songs in the skip window (IDs are not stored)" << std::endl;
+        }
+        else
+        {
+            auto skipped_ids = skipped_tracker.getRecentlySkipped();
+            std::cout << "Last " << skipped_ids.size() << " skipped songs:" << std::endl;
+            for (size_t i = 0; i < skipped_ids.size(); i++)
+            {
+                const Song *song = catalog->getLookup().lookup_by_id(skipped_ids[i]);
+                if (song)
+                {
+                    std::cout << (i + 1) << ". " << song->toString() << std::endl;
+                }
+            }
+        }
+        std::cout << "=============================\n"
+                  << std::endl;
+    }
+
+    /**
+     * Clear recently skipped songs
+     */
+    void clearRecentlySkipped()
+    {
+        skipped_tracker.clear();
+        skip_scores.clear();
+        std::cout << "✅ Recently skipped songs cleared!" << std::endl;
+    }
+
+    /**
+     * Toggle auto-replay feature
+     */
+    void toggleAutoReplay()
+    {
+        bool current_state = replay_manager.isAutoReplayEnabled();
+        replay_manager.enableAutoReplay(!current_state);
+        std::cout << "🔄 Auto-replay " << (!current_state ? "enabled" : "disabled") << std::endl;
+    }
+
+    /**
+     * Change a song's genre (catalog owner only)
+     * Plays already counted toward the old genre's mood stay there
+     * Time Complexity: O(1) average
+     */
+    bool setSongGenre(const std::string &song_id, const std::string &genre)
+    {
+        EngineMetrics::Scope timed(EngineMetrics::SET_GENRE);
+        return writable_catalog && writable_catalog->setGenre(song_id, genre);
+    }
+
+    /**
+     * Page through the songs of one genre
+     * Time Complexity: O(1) average + O(limit)
+     * Space Complexity: O(limit)
+     */
+    std::vector<Song *> getSongsByGenre(const std::string &genre, size_t offset = 0, size_t limit = SIZE_MAX) const
+    {
+        EngineMetrics::Scope timed(EngineMetrics::SONGS_BY_GENRE);
+        return catalog->getGenreIndex().page(genre, offset, limit);
+    }
+
+    size_t getGenreCount(const std::string &genre) const { return catalog->getGenreIndex().count(genre); }
+
+    /**
+     * Display songs by genre, read from the maintained genre index
+     * Time Complexity: O(n) to print n songs
+     */
+    void displaySongsByGenre() const
+    {
+        std::cout << "\n=== Songs by Genre ===" << std::endl;
+        catalog->getGenreIndex().forEachGenre([](const std::string &genre, const std::vector<Song *> &songs)
+                                              {
+            std::cout << "\n📁 " << genre << " (" << songs.size() << " songs):" << std::endl;
+            for (size_t i = 0; i < songs.size(); i++)
+            {
+                std::cout << "  " << (i + 1) << ". " << songs[i]->toString() << std::endl;
+            } });
+        std::cout << "======================\n"
+                  << std::endl;
+    }
+};
+
+/**
+ * Concurrent engine mode
+ * Consistency model:
+ * - lookupById/lookupByTitle never lock; they go through an RCU index and
+ *   see every song whose addSong has returned.
+ * - Mutations (addSong, removeSong, playSong, skips, sorting, rating) are
+ *   serialized by an exclusive writer lock.
+ * - Snapshot and playlist reads take the lock shared, so each sees the state
+ *   between two whole mutations and they run in parallel with each other.
+ * - A Song's id, title, artist, duration, genre and added_time never change
+ *   after publication and can be read through any returned pointer until
+ *   removeSong for that song is called; play count and rating are mutable,
+ *   so read them with readSong.
+ */
+class ConcurrentPlayWiseEngine
+{
+private:
+    PlayWiseEngine engine;
+    RcuLookup published;
+    mutable std::shared_mutex engine_lock;
+
+public:
+    Song *addSong(const std::string &id, const std::string &title,
+                  const std::string &artist, int duration, int rating = 0,
+                  const std::string &genre = "Unknown")
+    {
+        std::unique_lock<std::shared_mutex> lock(engine_lock);
+        Song *song = engine.addSong(id, title, artist, duration, rating, genre);
+        if (song)
+            published.add_song(song);
+        return song;
+    }
+
+    /**
+     * Add a batch of songs and publish them together
+     * The catalog appends new songs, so the batch is the tail of its song list
+     */
+    size_t addSongs(const std::vector<SongSpec> &specs)
+    {
+        std::unique_lock<std::shared_mutex> lock(engine_lock);
+        const std::vector<Song *> &songs = engine.getCatalog()->getSongs();
+        size_t before = songs.size();
+        size_t added = engine.addSongs(specs);
+        published.add_songs(std::vector<Song *>(songs.begin() + before, songs.end()));
+        return added;
+    }
+
+    /**
+     * Load a saved state into the empty engine and publish every loaded song
+     */
+    bool loadState(const std::string &path)
+    {
+        std::unique_lock<std::shared_mutex> lock(engine_lock);
+        if (!engine.loadState(path))
+            return false;
+        published.add_songs(engine.getCatalog()->getSongs());
+        return true;
+    }
+
+    /**
+     * Unpublish a song, wait out lookups that may be returning it, then remove it
+     */
+    bool removeSong(const std::string &song_id)
+    {
+        std::unique_lock<std::shared_mutex> lock(engine_lock);
+        Song *song = engine.getLookup().lookup_by_id(song_id);
+        if (!song)
+            return false;
+        published.remove_song(song);
+        if (engine.removeSong(song_id))
+            return true;
+        published.add_song(song);
+        return false;
+    }
+
+    void playSong(const std::string &song_id)
+    {
+        std::unique_lock<std::shared_mutex> lock(engine_lock);
+        engine.playSong(song_id);
+    }
+
+    void skipCurrentSong()
+    {
+        std::unique_lock<std::shared_mutex> lock(engine_lock);
+        engine.skipCurrentSong();
+    }
+
+    bool rateSong(const std::string &song_id, int rating)
+    {
+        std::unique_lock<std::shared_mutex> lock(engine_lock);
+        return engine.rateSong(song_id, rating);
+    }
+
+    void sortPlaylist(PlaylistSorter::SortCriteria criteria, bool useQuickSort = false)
+    {
+        std::unique_lock<std::shared_mutex> lock(engine_lock);
+        engine.sortPlaylist(criteria, useQuickSort);
+    }
+
+    Song *lookupById(const std::string &id) const { return published.lookup_by_id(id); }
+
+    std::vector<Song *> lookupByTitle(const std::string &title) const { return published.lookup_by_title(title); }
+
+    /**
+     * Copy of a song's current state, consistent with concurrent mutations
+     */
+    bool readSong(const std::string &id, Song &out) const
+    {
+        std::shared_lock<std::shared_mutex> lock(engine_lock); // Held across the lookup so removeSong cannot interleave
+        Song *song = published.lookup_by_id(id);
+        if (!song)
+            return false;
+        out = *song;
+        return true;
+    }
+
+    PlayWiseEngine::SystemSnapshot exportSnapshot()
+    {
+        std::shared_lock<std::shared_mutex> lock(engine_lock);
+        return engine.export_snapshot();
+    }
+
+    bool refreshSnapshot(PlayWiseEngine::SystemSnapshot &snapshot)
+    {
+        std::shared_lock<std::shared_mutex> lock(engine_lock);
+        return engine.refresh_snapshot(snapshot);
+    }
+
+    std::vector<Song *> getPlaylistSongs()
+    {
+        std::shared_lock<std::shared_mutex> lock(engine_lock);
+        return engine.getPlaylist().getAllSongs();
+    }
+
+    /**
+     * Run fn(engine) under the writer lock, for operations without a wrapper
+     * fn must not add, load or remove songs: lock-free lookups would not see
+     * the change, so use the addSong/addSongs/loadState/removeSong wrappers
+     */
+    template <typename Fn>
+    auto write(Fn fn) -> decltype(fn(engine))
+    {
+        std::unique_lock<std::shared_mutex> lock(engine_lock);
+        return fn(engine);
+    }
+
+    /**
+     * Run fn(engine) under the shared lock; fn must not mutate the engine
+     */
+    template <typename Fn>
+    auto read(Fn fn) -> decltype(fn(engine))
+    {
+        std::shared_lock<std::shared_mutex> lock(engine_lock);
+        return fn(engine);
+    }
+};
+
+/**
+ * Stream buffer that swallows everything written to it
+ * Used to silence engine console output in headless modes
+ */
+class NullStreamBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+};
+
+/**
+ * Headless command-script runner
+ * Reads one command per line and runs it against a PlayWiseEngine with the
+ * engine's console output discarded, timing every command:
+ *   add <id> "<title>" "<artist>" <duration> [rating] [genre]
+ *   play <id> | skip | next | undo | snapshot
+ *   sort <title|title_desc|duration|duration_desc|recent|rating|played|artist> [quick]
+ *   view <criteria> - keep that order materialized so later sorts relink
+ *   rate <id> <rating> | remove <id>
+ *   search <id> | search title "<title>"
+ * Blank lines and lines starting with '#' are ignored. Latencies go into
+ * one log-bucketed histogram per command, so a long-running server keeps
+ * constant memory however many requests it serves.
+ * Time Complexity: O(1) per command, O(C) for the report over C command types
+ * Space Complexity: O(C) histograms
+ */
+class CommandScriptRunner
+{
+private:
+    PlayWiseEngine &engine;
+    std::map<std::string, LatencyHistogram> latencies; // command -> nanoseconds
+    std::vector<std::string> errors;
+    size_t error_count;
+    size_t line_number;
+    size_t search_hits; // keeps search results observable
+    double elapsed_seconds;
+
+    static const size_t MAX_REPORTED_ERRORS = 10;
+
+public:
+    explicit CommandScriptRunner(PlayWiseEngine &target)
+        : engine(target), error_count(0), line_number(0), search_hits(0), elapsed_seconds(0.0) {}
+
+    /**
+     * Split a line on whitespace; double quotes group words into one token
+     */
+    static std::vector<std::string> tokenize(const std::string &line)
+    {
+        std::vector<std::string> tokens;
+        std::string current;
+        bool quoted = false;
+        bool has_token = false;
+        for (char c : line)
+        {
+            if (c == '"')
+            {
+                quoted = !quoted;
+                has_token = true;
+            }
+            else if (!quoted && std::isspace(static_cast<unsigned char>(c)))
+            {
+                if (has_token)
+                    tokens.push_back(current);
+                current.clear();
+                has_token = false;
+            }
+            else
+            {
+                current += c;
+                has_token = true;
+            }
+        }
+        if (has_token)
+            tokens.push_back(current);
+        return tokens;
+    }
+
+    /**
+     * Run every command in the stream; engine output is discarded
+     * Returns the number of commands executed
+     */
+    size_t run(std::istream &in)
+    {
+        NullStreamBuffer sink;
+        std::streambuf *old_buf = std::cout.rdbuf(&sink);
+
+        size_t executed = 0;
+        std::string line;
+        auto start = std::chrono::steady_clock::now();
+        while (std::getline(in, line))
+        {
+            line_number++;
+            executed += execute(line) ? 1 : 0;
+        }
+        elapsed_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout.rdbuf(old_buf);
+        return executed;
+    }
+
+    /**
+     * Run a single command line, recording its latency
+     * Returns false for blank/comment lines and for errors
+     */
+    bool execute(const std::string &line)
+    {
+        auto tokens = tokenize(line);
+        if (tokens.empty() || tokens[0][0] == '#')
+            return false;
+        return executeTokens(tokens).empty();
+    }
+
+    /**
+     * Run an already tokenized command, recording its latency
+     * Returns an error message, or an empty string on success
+     */
+    std::string executeTokens(const std::vector<std::string> &tokens)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::string problem = dispatch(tokens);
+        auto end = std::chrono::steady_clock::now();
+
+        if (!problem.empty())
+        {
+            error_count++;
+            if (errors.size() < MAX_REPORTED_ERRORS)
+                errors.push_back(line_number > 0 ? "line " + std::to_string(line_number) + ": " + problem : problem);
+            return problem;
+        }
+        latencies[tokens[0]].record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        return problem;
+    }
+
+    /**
+     * Throughput and per-command latency percentiles
+     */
+    void report(std::ostream &out) const
+    {
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        size_t total = 0;
+        for (const auto &pair : latencies)
+            total += pair.second.count();
+
+        out << "\n=== Command Script Report ===" << std::endl;
+        out << "Commands: " << total << std::fixed;
+        if (elapsed_seconds > 0)
+            out << " in " << std::setprecision(3) << elapsed_seconds << " s ("
+                << std::setprecision(0) << total / elapsed_seconds << " ops/sec)";
+        out << std::endl;
+        out << "Errors: " << error_count << std::endl;
+        for (const std::string &error : errors)
+            out << "  " << error << std::endl;
+
+        out << "\nCommand\tCount\tp50(us)\tp90(us)\tp99(us)\tmax(us)" << std::endl;
+        for (const auto &pair : latencies)
+        {
+            const LatencyHistogram &histogram = pair.second;
+            out << pair.first << "\t" << histogram.count() << std::setprecision(2)
+                << "\t" << histogram.percentile(0.50) / 1000.0
+                << "\t" << histogram.percentile(0.90) / 1000.0
+                << "\t" << histogram.percentile(0.99) / 1000.0
+                << "\t" << histogram.max() / 1000.0 << std::endl;
+        }
+        out << "=============================\n"
+            << std::endl;
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    size_t commandCount(const std::string &command) const
+    {
+        auto it = latencies.find(command);
+        return it != latencies.end() ? it->second.count() : 0;
+    }
+
+    size_t getErrorCount() const { return error_count; }
+    size_t getSearchHits() const { return search_hits; }
+    double getElapsedSeconds() const { return elapsed_seconds; }
+
+    // Nearest-rank percentile of sorted samples
+    static uint64_t percentile(const std::vector<uint64_t> &sorted, double p)
+    {
+        if (sorted.empty())
+            return 0;
+        size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+        return sorted[rank > 0 ? rank - 1 : 0];
+    }
+
+private:
+    static bool parseInt(const std::string &text, int &value)
+    {
+        char *end = nullptr;
+        long parsed = std::strtol(text.c_str(), &end, 10);
+        if (text.empty() || *end != '\0')
+            return false;
+        value = static_cast<int>(parsed);
+        return true;
+    }
+
+    static bool parseCriteria(const std::string &name, PlaylistSorter::SortCriteria &criteria)
+    {
+        static const std::unordered_map<std::string, PlaylistSorter::SortCriteria> names = {
+            {"title", PlaylistSorter::TITLE_ASC},
+            {"title_desc", PlaylistSorter::TITLE_DESC},
+            {"duration", PlaylistSorter::DURATION_ASC},
+            {"duration_desc", PlaylistSorter::DURATION_DESC},
+            {"recent", PlaylistSorter::RECENTLY_ADDED},
+            {"rating", PlaylistSorter::RATING_DESC},
+            {"played", PlaylistSorter::MOST_PLAYED},
+            {"artist", PlaylistSorter::ARTIST_ASC}};
+        auto it = names.find(name);
+        if (it == names.end())
+            return false;
+        criteria = it->second;
+        return true;
+    }
+
+    // Returns an error message, or an empty string on success
+    std::string dispatch(const std::vector<std::string> &args)
+    {
+        const std::string &command = args[0];
+        if (command == "add")
+        {
+            int duration = 0, rating = 0;
+            if (args.size() < 5 || !parseInt(args[4], duration) ||
+                (args.size() > 5 && !parseInt(args[5], rating)))
+                return "usage: add <id> \"<title>\" \"<artist>\" <duration> [rating] [genre]";
+            if (!engine.addSong(args[1], args[2], args[3], duration, rating, args.size() > 6 ? args[6] : "Unknown"))
+                return "add rejected";
+        }
+        else if (command == "play")
+        {
+            if (args.size() != 2)
+                return "usage: play <id>";
+            if (!engine.getLookup().lookup_by_id(args[1]))
+                return "no song with id " + args[1];
+            engine.playSong(args[1]);
+        }
+        else if (command == "skip")
+        {
+            engine.skipCurrentSong();
+        }
+        else if (command == "next")
+        {
+            engine.autoPlayNext();
+        }
+        else if (command == "undo")
+        {
+            engine.undoLastPlay();
+        }
+        else if (command == "snapshot")
+        {
+            engine.export_snapshot();
+        }
+        else if (command == "sort")
+        {
+            PlaylistSorter::SortCriteria criteria;
+            if (args.size() < 2 || !parseCriteria(args[1], criteria))
+                return "usage: sort <title|title_desc|duration|duration_desc|recent|rating|played|artist> [quick]";
+            engine.sortPlaylist(criteria, args.size() > 2 && args[2] == "quick");
+        }
+        else if (command == "view")
+        {
+            PlaylistSorter::SortCriteria criteria;
+            if (args.size() != 2 || !parseCriteria(args[1], criteria))
+                return "usage: view <title|title_desc|duration|duration_desc|recent|rating|played|artist>";
+            if (!engine.materializeSortedView(criteria))
+                return "view rejected: catalog is shared read-only";
+        }
+        else if (command == "remove")
+        {
+            if (args.size() != 2)
+                return "usage: remove <id>";
+            if (!engine.removeSong(args[1]))
+                return "remove rejected for " + args[1];
+        }
+        else if (command == "rate")
+        {
+            int rating = 0;
+            if (args.size() != 3 || !parseInt(args[2], rating))
+                return "usage: rate <id> <rating>";
+            if (!engine.rateSong(args[1], rating))
+                return "rate rejected for " + args[1];
+        }
+        else if (command == "search")
+        {
+            if (args.size() == 3 && args[1] == "title")
+                search_hits += engine.getLookup().lookup_by_title(args[2]).size();
+            else if (args.size() == 2)
+                search_hits += engine.getLookup().lookup_by_id(args[1]) != nullptr;
+            else
+                return "usage: search <id> | search title \"<title>\"";
+        }
+        else
+        {
+            return "unknown command '" + command + "'";
+        }
+        return "";
+    }
+};
+
+/**
+ * Compact binary trace of engine-level operations
+ * File layout: "PWTR" magic and a version byte, then one record per operation:
+ *   [op: u8][microseconds since the previous record: varint][arguments]
+ * Integer arguments are zigzag varints and strings are a varint length plus
+ * the bytes, so a typical play record is under 10 bytes.
+ */
+class EngineTrace
+{
+public:
+    enum Op : uint8_t
+    {
+        ADD_SONG = 1,
+        PLAY_SONG,
+        SKIP_SONG,
+        AUTO_PLAY_NEXT,
+        UNDO_PLAY,
+        SORT_PLAYLIST,
+        RATE_SONG,
+        SEARCH_ID,
+        SEARCH_TITLE,
+        SEARCH_RATING,
+        MOVE_SONG,
+        DELETE_SONG,
+        REVERSE_PLAYLIST,
+        CLEAR_SKIPPED,
+        SET_SKIP_WINDOW,
+        TOGGLE_REPLAY,
+        SETUP_REPLAY,
+        SONGS_BY_GENRE,
+        SNAPSHOT,
+        REMOVE_SONG,
+        MATERIALIZE_VIEW,
+        OP_COUNT
+    };
+
+    struct Event
+    {
+        Op op;
+        uint64_t delta_us; // time since the previous event
+        std::vector<std::string> text;
+        std::vector<int64_t> numbers;
+    };
+
+    static const uint8_t VERSION = 1;
+
+    static const char *opName(Op op)
+    {
+        static const char *names[] = {"?", "add", "play", "skip", "next", "undo", "sort", "rate",
+                                      "search_id", "search_title", "search_rating", "move", "delete",
+                                      "reverse", "clear_skipped", "skip_window", "toggle_replay",
+                                      "setup_replay", "genres", "snapshot", "remove", "view"};
+        return op < OP_COUNT ? names[op] : "?";
+    }
+
+    // Argument kinds in order: 's' string, 'i' integer
+    static const char *schema(Op op)
+    {
+        switch (op)
+        {
+        case ADD_SONG:
+            return "sssiis"; // id, title, artist, duration, rating, genre
+        case PLAY_SONG:
+        case SEARCH_ID:
+        case SEARCH_TITLE:
+        case REMOVE_SONG:
+            return "s";
+        case RATE_SONG:
+            return "si";
+        case SORT_PLAYLIST: // criteria, quick sort
+        case MOVE_SONG:     // from, to
+            return "ii";
+        case SEARCH_RATING:
+        case DELETE_SONG:
+        case SET_SKIP_WINDOW:
+        case MATERIALIZE_VIEW: // criteria
+            return "i";
+        default:
+            return "";
+        }
+    }
+
+    static void writeHeader(std::ostream &out)
+    {
+        out.write("PWTR", 4);
+        out.put(static_cast<char>(VERSION));
+    }
+
+    static bool readHeader(std::istream &in)
+    {
+        char header[5];
+        return in.read(header, 5) && std::equal(header, header + 4, "PWTR") &&
+               static_cast<uint8_t>(header[4]) == VERSION;
+    }
+
+    static void write(std::ostream &out, const Event &event)
+    {
+        out.put(static_cast<char>(event.op));
+        writeVarint(out, event.delta_us);
+        size_t next_text = 0, next_number = 0;
+        for (const char *kind = schema(event.op); *kind; kind++)
+        {
+            if (*kind == 's')
+            {
+                const std::string &text = event.text[next_text++];
+                writeVarint(out, text.size());
+                out.write(text.data(), text.size());
+            }
+            else
+            {
+                int64_t value = event.numbers[next_number++];
+                writeVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+            }
+        }
+    }
+
+    /**
+     * Read the next event; false at end of trace or on a malformed record
+     */
+    static bool read(std::istream &in, Event &event)
+    {
+        int op = in.get();
+        if (op == std::char_traits<char>::eof() || op == 0 || op >= OP_COUNT)
+            return false;
+
+        event.op = static_cast<Op>(op);
+        event.text.clear();
+        event.numbers.clear();
+        if (!readVarint(in, event.delta_us))
+            return false;
+
+        for (const char *kind = schema(event.op); *kind; kind++)
+        {
+            uint64_t value;
+            if (!readVarint(in, value))
+                return false;
+            if (*kind == 's')
+            {
+                if (value > MAX_STRING)
+                    return false;
+                std::string text(value, '\0');
+                if (!in.read(&text[0], value))
+                    return false;
+                event.text.push_back(std::move(text));
+            }
+            else
+            {
+                event.numbers.push_back(static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1));
+            }
+        }
+        return true;
+    }
+
+private:
+    static const uint64_t MAX_STRING = 1 << 20;
+
+    static void writeVarint(std::ostream &out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.put(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.put(static_cast<char>(value));
+    }
+
+    static bool readVarint(std::istream &in, uint64_t &value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            int byte = in.get();
+            if (byte == std::char_traits<char>::eof())
+                return false;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+};
+
+/**
+ * Appends timestamped engine operations to a binary trace
+ * Time Complexity: O(a) per record for a bytes of arguments
+ * Space Complexity: O(1) beyond the stream buffer
+ */
+class TraceRecorder
+{
+private:
+    std::unique_ptr<std::ofstream> file;
+    std::ostream *out;
+    std::chrono::steady_clock::time_point last;
+    size_t records;
+
+public:
+    explicit TraceRecorder(const std::string &path)
+        : file(new std::ofstream(path, std::ios::binary | std::ios::trunc)), out(file.get()),
+          last(std::chrono::steady_clock::now()), records(0)
+    {
+        if (*out)
+            EngineTrace::writeHeader(*out);
+    }
+
+    explicit TraceRecorder(std::ostream &stream)
+        : out(&stream), last(std::chrono::steady_clock::now()), records(0)
+    {
+        EngineTrace::writeHeader(*out);
+    }
+
+    bool isOpen() const { return out->good(); }
+
+    void record(EngineTrace::Op op, std::vector<std::string> text = {}, std::vector<int64_t> numbers = {})
+    {
+        auto now = std::chrono::steady_clock::now();
+        EngineTrace::Event event{op,
+                                 static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - last).count()),
+                                 std::move(text), std::move(numbers)};
+        last = now;
+        EngineTrace::write(*out, event);
+        records++;
+    }
+
+    void flush() { out->flush(); }
+    size_t size() const { return records; }
+};
+
+/**
+ * Replays a binary trace against an engine and reports time per operation type
+ * Runs as fast as possible, or at the recorded pace when realtime is set
+ * Time Complexity: O(E) events plus the cost of the operations themselves
+ * Space Complexity: O(1)
+ */
+class TraceReplayer
+{
+private:
+    struct OpStats
+    {
+        size_t count = 0;
+        uint64_t total_ns = 0;
+        uint64_t max_ns = 0;
+    };
+
+    PlayWiseEngine &engine;
+    std::array<OpStats, EngineTrace::OP_COUNT> stats;
+    size_t events;
+    double elapsed_seconds;
+    double recorded_seconds;
+    bool truncated;
+
+public:
+    explicit TraceReplayer(PlayWiseEngine &target)
+        : engine(target), events(0), elapsed_seconds(0.0), recorded_seconds(0.0), truncated(false) {}
+
+    /**
+     * Replay every event in the stream with engine output discarded
+     * Returns the number of events replayed, or 0 if the header is invalid
+     */
+    size_t replay(std::istream &in, bool realtime = false)
+    {
+        if (!EngineTrace::readHeader(in))
+        {
+            truncated = true;
+            return 0;
+        }
+
+        NullStreamBuffer sink;
+        std::streambuf *old_buf = std::cout.rdbuf(&sink);
+
+        EngineTrace::Event event;
+        uint64_t recorded_us = 0;
+        auto start = std::chrono::steady_clock::now();
+        size_t replayed = 0;
+        while (in.peek() != std::char_traits<char>::eof())
+        {
+            // A record that cannot be decoded means the trace was cut off or corrupted
+            if (!EngineTrace::read(in, event))
+            {
+                truncated = true;
+                break;
+            }
+
+            recorded_us += event.delta_us;
+            if (realtime)
+                std::this_thread::sleep_until(start + std::chrono::microseconds(recorded_us));
+
+            auto op_start = std::chrono::steady_clock::now();
+            apply(event);
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - op_start)
+                              .count();
+
+            OpStats &op = stats[event.op];
+            op.count++;
+            op.total_ns += ns;
+            op.max_ns = std::max(op.max_ns, ns);
+            replayed++;
+        }
+
+        elapsed_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        recorded_seconds += recorded_us / 1e6;
+        events += replayed;
+        std::cout.rdbuf(old_buf);
+        return replayed;
+    }
+
+    /**
+     * Where the replay spent its time, most expensive operation first
+     */
+    void report(std::ostream &out) const
+    {
+        uint64_t total_ns = 0;
+        std::vector<EngineTrace::Op> ops;
+        for (int op = 1; op < EngineTrace::OP_COUNT; op++)
+        {
+            total_ns += stats[op].total_ns;
+            if (stats[op].count > 0)
+                ops.push_back(static_cast<EngineTrace::Op>(op));
+        }
+        std::sort(ops.begin(), ops.end(), [this](EngineTrace::Op a, EngineTrace::Op b)
+                  { return stats[a].total_ns > stats[b].total_ns; });
+
+        out << "\n=== Trace Replay Report ===" << std::endl;
+        out << "Events: " << events << (truncated ? " (trace truncated or corrupt)" : "") << std::endl;
+        out << "Recorded span: " << std::fixed << std::setprecision(3) << recorded_seconds
+            << " s, replayed in " << elapsed_seconds << " s" << std::endl;
+
+        out << "\nOperation\tCount\tTotal(ms)\tShare\tMean(us)\tMax(us)" << std::endl;
+        for (EngineTrace::Op op : ops)
+        {
+            const OpStats &op_stats = stats[op];
+            out << EngineTrace::opName(op) << "\t" << op_stats.count << "\t" << std::setprecision(3)
+                << op_stats.total_ns / 1e6 << "\t\t" << std::setprecision(1)
+                << (total_ns ? 100.0 * op_stats.total_ns / total_ns : 0.0) << "%\t"
+                << std::setprecision(2) << op_stats.total_ns / 1e3 / op_stats.count << "\t\t"
+                << op_stats.max_ns / 1e3 << std::endl;
+        }
+        out << "===========================\n"
+            << std::endl;
+    }
+
+    size_t getEventCount() const { return events; }
+    size_t getOpCount(EngineTrace::Op op) const { return stats[op].count; }
+    bool wasTruncated() const { return truncated; }
+
+private:
+    void apply(const EngineTrace::Event &event)
+    {
+        const auto &text = event.text;
+        const auto &numbers = event.numbers;
+        switch (event.op)
+        {
+        case EngineTrace::ADD_SONG:
+            engine.addSong(text[0], text[1], text[2], static_cast<int>(numbers[0]),
+                           static_cast<int>(numbers[1]), text[3]);
+            break;
+        case EngineTrace::PLAY_SONG:
+            engine.playSong(text[0]);
+            break;
+        case EngineTrace::SKIP_SONG:
+            engine.skipCurrentSong();
+            break;
+        case EngineTrace::AUTO_PLAY_NEXT:
+            engine.autoPlayNext();
+            break;
+        case EngineTrace::UNDO_PLAY:
+            engine.undoLastPlay();
+            break;
+        case EngineTrace::SORT_PLAYLIST:
+            engine.sortPlaylist(static_cast<PlaylistSorter::SortCriteria>(numbers[0]), numbers[1] != 0);
+            break;
+        case EngineTrace::RATE_SONG:
+            engine.rateSong(text[0], static_cast<int>(numbers[0]));
+            break;
+        case EngineTrace::SEARCH_ID:
+            engine.getLookup().lookup_by_id(text[0]);
+            break;
+        case EngineTrace::SEARCH_TITLE:
+            engine.getLookup().lookup_by_title(text[0]);
+            break;
+        case EngineTrace::SEARCH_RATING:
+            engine.getRatingTree().search_by_rating(static_cast<int>(numbers[0]));
+            break;
+        case EngineTrace::MOVE_SONG:
+            engine.getPlaylist().move_song(static_cast<int>(numbers[0]), static_cast<int>(numbers[1]));
+            break;
+        case EngineTrace::DELETE_SONG:
+            engine.getPlaylist().delete_song(static_cast<int>(numbers[0]));
+            break;
+        case EngineTrace::REVERSE_PLAYLIST:
+            engine.getPlaylist().reverse_playlist();
+            break;
+        case EngineTrace::CLEAR_SKIPPED:
+            engine.clearRecentlySkipped();
+            break;
+        case EngineTrace::SET_SKIP_WINDOW:
+            engine.getSkippedTracker().setCapacity(static_cast<size_t>(numbers[0]));
+            break;
+        case EngineTrace::TOGGLE_REPLAY:
+            engine.toggleAutoReplay();
+            break;
+        case EngineTrace::SETUP_REPLAY:
+            engine.getReplayManager().setupAutoReplay(engine.getPlaylist().getAllSongs());
+            break;
+        case EngineTrace::SONGS_BY_GENRE:
+            engine.displaySongsByGenre();
+            break;
+        case EngineTrace::SNAPSHOT:
+            engine.displaySnapshot();
+            break;
+        case EngineTrace::REMOVE_SONG:
+            engine.removeSong(text[0]);
+            break;
+        case EngineTrace::MATERIALIZE_VIEW:
+            engine.materializeSortedView(static_cast<PlaylistSorter::SortCriteria>(numbers[0]));
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+/**
+ * Streaming catalog importer for CSV and JSON-lines files
+ * The input is read in fixed-size chunks cut at line boundaries. Each chunk
+ * is split across worker threads that parse their lines into SongSpec views
+ * pointing into the chunk (only fields with escapes are copied), then the
+ * batches are ingested in file order through PlayWiseEngine::addSongs.
+ *
+ * CSV: id,title,artist,duration[,rating[,genre]], RFC 4180 quoting, one
+ * record per line. A first line naming an "id" column is a header and may
+ * put the columns in any order.
+ * JSON lines: one object per line with the same keys; unknown keys are ignored.
+ *
+ * Time Complexity: O(B / T) parsing per chunk of B bytes on T threads, plus ingest
+ * Space Complexity: O(chunk size)
+ */
+class CatalogImporter
+{
+public:
+    enum Format
+    {
+        CSV,
+        JSON_LINES
+    };
+
+    enum Column
+    {
+        ID,
+        TITLE,
+        ARTIST,
+        DURATION,
+        RATING,
+        GENRE,
+        COLUMN_COUNT
+    };
+
+    // Position of each column in a CSV row, -1 when absent
+    struct CsvLayout
+    {
+        int position[COLUMN_COUNT] = {0, 1, 2, 3, 4, 5};
+        size_t width = COLUMN_COUNT;
+    };
+
+private:
+    struct Slice
+    {
+        std::string_view text;
+        std::vector<SongSpec> songs;
+        std::vector<size_t> song_lines; // line within the slice of each song
+        std::deque<std::string> unescaped; // Backing store for fields that needed unescaping
+        std::vector<std::pair<size_t, std::string>> errors; // line within the slice, reason
+        size_t lines = 0;
+        size_t rows = 0;
+    };
+
+    static const size_t MAX_REPORTED_ERRORS = 100;
+
+    PlayWiseEngine &engine;
+    size_t thread_count;
+    size_t chunk_bytes;
+    CsvLayout layout;
+    size_t rows;
+    size_t imported;
+    size_t rejected;
+    double elapsed_seconds;
+    std::vector<std::string> errors; // First MAX_REPORTED_ERRORS rejections
+
+public:
+    explicit CatalogImporter(PlayWiseEngine &target, size_t threads = 0, size_t chunk_size = 4 << 20)
+        : engine(target), thread_count(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+          chunk_bytes(std::max<size_t>(chunk_size, 1)), rows(0), imported(0), rejected(0), elapsed_seconds(0.0) {}
+
+    static Format detectFormat(const std::string &path)
+    {
+        size_t dot = path.rfind('.');
+        std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        return extension == "jsonl" || extension == "ndjson" || extension == "json" ? JSON_LINES : CSV;
+    }
+
+    /**
+     * Import a file, picking the format from its extension
+     * Returns false if the file cannot be opened
+     */
+    bool importFile(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+        import(in, detectFormat(path));
+        return true;
+    }
+
+    /**
+     * Stream an input to the end, returning the number of songs imported
+     */
+    size_t import(std::istream &in, Format format)
+    {
+        auto start = std::chrono::steady_clock::now();
+        size_t imported_before = imported;
+        size_t line_base = 0; // lines before the current chunk
+        bool first_chunk = true;
+        std::string carry;
+
+        while (true)
+        {
+            std::string chunk = std::move(carry);
+            carry.clear();
+            size_t kept = chunk.size();
+            chunk.resize(kept + chunk_bytes);
+            in.read(&chunk[kept], chunk_bytes);
+            chunk.resize(kept + in.gcount());
+            bool at_end = !in;
+
+            if (!at_end)
+            {
+                // Hold back the partial last line for the next chunk
+                size_t last_newline = chunk.rfind('\n');
+                if (last_newline == std::string::npos)
+                {
+                    carry = std::move(chunk);
+                    continue;
+                }
+                carry.assign(chunk, last_newline + 1, std::string::npos);
+                chunk.resize(last_newline + 1);
+            }
+
+            std::string_view text(chunk);
+            if (first_chunk && format == CSV)
+            {
+                size_t header_end = std::min(text.find('\n'), text.size());
+                std::string error;
+                if (isCsvHeader(text.substr(0, header_end)))
+                {
+                    if (!parseCsvHeader(text.substr(0, header_end), layout, error))
+                        recordError(1, error);
+                    text.remove_prefix(std::min(header_end + 1, text.size()));
+                    line_base = 1;
+                }
+            }
+            first_chunk = false;
+
+            line_base += processChunk(text, format, line_base);
+            if (at_end)
+                break;
+        }
+
+        elapsed_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return imported - imported_before;
+    }
+
+    void report(std::ostream &out) const
+    {
+        std::ios::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << "\n=== Catalog Import Report ===" << std::endl;
+        out << "Rows: " << rows << ", imported: " << imported << ", rejected: " << rejected << std::endl;
+        out << "Elapsed: " << std::fixed << std::setprecision(3) << elapsed_seconds << " s ("
+            << std::setprecision(0) << (elapsed_seconds > 0 ? rows / elapsed_seconds : 0.0) << " rows/sec, "
+            << thread_count << " parser thread" << (thread_count == 1 ? "" : "s") << ")" << std::endl;
+        for (const std::string &error : errors)
+        {
+            out << "  " << error << std::endl;
+        }
+        if (rejected > errors.size())
+        {
+            out << "  ... " << rejected - errors.size() << " more" << std::endl;
+        }
+        out << "=============================\n"
+            << std::endl;
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    size_t getRowCount() const { return rows; }
+    size_t getImportedCount() const { return imported; }
+    size_t getRejectedCount() const { return rejected; }
+    const std::vector<std::string> &getErrors() const { return errors; }
+    double getElapsedSeconds() const { return elapsed_seconds; }
+
+    /**
+     * Parse one CSV record (without its newline)
+     * Only fields at a mapped column position are kept; extra header columns are skipped
+     * Returns false with a reason for malformed rows
+     */
+    static bool parseCsvRow(std::string_view line, const CsvLayout &columns, SongSpec &spec,
+                            std::deque<std::string> &unescaped, std::string &error)
     {
-        if (!auto_replay_enabled)
+        std::string_view fields[COLUMN_COUNT]; // by Column, not by position
+        size_t count = 0;
+        size_t i = 0;
+        while (true)
+        {
+            if (count > columns.width)
+            {
+                error = "too many fields";
+                return false;
+            }
+
+            std::string_view field;
+            if (i < line.size() && line[i] == '"')
+            {
+                size_t start = ++i;
+                bool escaped = false;
+                while (true)
+                {
+                    i = line.find('"', i);
+                    if (i == std::string_view::npos)
+                    {
+                        error = "unterminated quoted field";
+                        return false;
+                    }
+                    if (i + 1 < line.size() && line[i + 1] == '"')
+                    {
+                        escaped = true;
+                        i += 2;
+                        continue;
+                    }
+                    break;
+                }
+                field = line.substr(start, i - start);
+                i++;
+                if (escaped)
+                {
+                    std::string value;
+                    value.reserve(field.size());
+                    for (size_t j = 0; j < field.size(); j++)
+                    {
+                        value += field[j];
+                        if (field[j] == '"')
+                            j++;
+                    }
+                    unescaped.push_back(std::move(value));
+                    field = unescaped.back();
+                }
+                if (i < line.size() && line[i] != ',')
+                {
+                    error = "unexpected character after quoted field";
+                    return false;
+                }
+            }
+            else
+            {
+                size_t comma = std::min(line.find(',', i), line.size());
+                field = line.substr(i, comma - i);
+                i = comma;
+            }
+
+            for (int c = 0; c < COLUMN_COUNT; c++)
+            {
+                if (columns.position[c] == static_cast<int>(count))
+                    fields[c] = field;
+            }
+            count++;
+            if (i >= line.size())
+                break;
+            i++; // past the comma
+        }
+        if (count > columns.width)
+        {
+            error = "too many fields";
+            return false;
+        }
+
+        auto column = [&](Column name) -> const std::string_view *
+        {
+            int position = columns.position[name];
+            return position >= 0 && static_cast<size_t>(position) < count ? &fields[name] : nullptr;
+        };
+        for (Column required : {ID, TITLE, ARTIST, DURATION})
+        {
+            if (!column(required))
+            {
+                error = "missing " + std::string(columnName(required));
+                return false;
+            }
+        }
+
+        spec = SongSpec();
+        spec.id = *column(ID);
+        spec.title = *column(TITLE);
+        spec.artist = *column(ARTIST);
+        if (column(GENRE) && !column(GENRE)->empty())
+            spec.genre = *column(GENRE);
+        if (!parseInt(*column(DURATION), spec.duration) || spec.duration < 0)
+        {
+            error = "bad duration '" + std::string(*column(DURATION)) + "'";
+            return false;
+        }
+        if (column(RATING) && !column(RATING)->empty() &&
+            (!parseInt(*column(RATING), spec.rating) || spec.rating < 0 || spec.rating > 5))
+        {
+            error = "bad rating '" + std::string(*column(RATING)) + "'";
+            return false;
+        }
+        return validate(spec, error);
+    }
+
+    /**
+     * Parse one JSON object (without its newline)
+     */
+    static bool parseJsonRow(std::string_view line, SongSpec &spec, std::deque<std::string> &unescaped,
+                             std::string &error)
+    {
+        spec = SongSpec();
+        bool seen[COLUMN_COUNT] = {};
+        size_t i = 0;
+        auto skipSpace = [&]()
+        {
+            while (i < line.size() && (line[i] == ' ' || line[i] == '\t'))
+                i++;
+        };
+        auto expect = [&](char c)
+        {
+            skipSpace();
+            if (i < line.size() && line[i] == c)
+            {
+                i++;
+                return true;
+            }
+            error = std::string("expected '") + c + "'";
+            return false;
+        };
+
+        if (!expect('{'))
+            return false;
+        skipSpace();
+        if (i < line.size() && line[i] == '}')
+        {
+            i++;
+        }
+        else
+        {
+            while (true)
+            {
+                std::string_view key;
+                skipSpace();
+                if (!parseJsonString(line, i, key, unescaped, error) || !expect(':'))
+                    return false;
+                skipSpace();
+
+                int column = -1;
+                for (int c = 0; c < COLUMN_COUNT; c++)
+                {
+                    if (key == columnName(static_cast<Column>(c)))
+                        column = c;
+                }
+
+                if (i < line.size() && line[i] == '"')
+                {
+                    std::string_view value;
+                    if (!parseJsonString(line, i, value, unescaped, error))
+                        return false;
+                    if (column == DURATION || column == RATING)
+                    {
+                        error = std::string(columnName(static_cast<Column>(column))) + " must be a number";
+                        return false;
+                    }
+                    if (column == ID)
+                        spec.id = value;
+                    else if (column == TITLE)
+                        spec.title = value;
+                    else if (column == ARTIST)
+                        spec.artist = value;
+                    else if (column == GENRE)
+                        spec.genre = value;
+                }
+                else
+                {
+                    size_t end = i;
+                    while (end < line.size() && line[end] != ',' && line[end] != '}' && line[end] != ' ')
+                        end++;
+                    std::string_view token = line.substr(i, end - i);
+                    i = end;
+
+                    int number = 0;
+                    bool is_number = parseInt(token, number);
+                    if (column == DURATION || column == RATING)
+                    {
+                        if (!is_number)
+                        {
+                            error = "bad " + std::string(columnName(static_cast<Column>(column))) + " '" +
+                                    std::string(token) + "'";
+                            return false;
+                        }
+                        (column == DURATION ? spec.duration : spec.rating) = number;
+                    }
+                    else if (column >= 0)
+                    {
+                        error = std::string(columnName(static_cast<Column>(column))) + " must be a string";
+                        return false;
+                    }
+                    else if (!is_number && token != "null" && token != "true" && token != "false")
+                    {
+                        error = "unsupported value '" + std::string(token) + "'";
+                        return false;
+                    }
+                }
+                if (column >= 0)
+                    seen[column] = true;
+
+                skipSpace();
+                if (i < line.size() && line[i] == ',')
+                {
+                    i++;
+                    continue;
+                }
+                if (!expect('}'))
+                    return false;
+                break;
+            }
+        }
+        skipSpace();
+        if (i != line.size())
+        {
+            error = "trailing characters after object";
+            return false;
+        }
+
+        for (Column required : {ID, TITLE, ARTIST, DURATION})
+        {
+            if (!seen[required])
+            {
+                error = "missing " + std::string(columnName(required));
+                return false;
+            }
+        }
+        if (spec.duration < 0)
+        {
+            error = "bad duration '" + std::to_string(spec.duration) + "'";
+            return false;
+        }
+        if (spec.rating < 0 || spec.rating > 5)
+        {
+            error = "bad rating '" + std::to_string(spec.rating) + "'";
+            return false;
+        }
+        return validate(spec, error);
+    }
+
+private:
+    static const char *columnName(Column column)
+    {
+        static const char *names[] = {"id", "title", "artist", "duration", "rating", "genre"};
+        return names[column];
+    }
+
+    static bool validate(const SongSpec &spec, std::string &error)
+    {
+        if (spec.id.empty())
+        {
+            error = "empty id";
+            return false;
+        }
+        return true;
+    }
+
+    static bool parseInt(std::string_view text, int &value)
+    {
+        while (!text.empty() && text.front() == ' ')
+            text.remove_prefix(1);
+        while (!text.empty() && text.back() == ' ')
+            text.remove_suffix(1);
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return !text.empty() && result.ec == std::errc() && result.ptr == text.data() + text.size();
+    }
+
+    /**
+     * Parse a JSON string starting at line[i] == '"'
+     * Strings without escapes are returned as views into the line
+     */
+    static bool parseJsonString(std::string_view line, size_t &i, std::string_view &value,
+                                std::deque<std::string> &unescaped, std::string &error)
+    {
+        if (i >= line.size() || line[i] != '"')
+        {
+            error = "expected string";
+            return false;
+        }
+        size_t start = ++i;
+        while (i < line.size() && line[i] != '"' && line[i] != '\\')
+            i++;
+        if (i < line.size() && line[i] == '"')
+        {
+            value = line.substr(start, i - start);
+            i++;
+            return true;
+        }
+
+        std::string text(line.substr(start, i - start));
+        while (i < line.size() && line[i] != '"')
+        {
+            char c = line[i++];
+            if (c != '\\')
+            {
+                text += c;
+                continue;
+            }
+            if (i >= line.size())
+                break;
+            char escape = line[i++];
+            switch (escape)
+            {
+            case '"':
+            case '\\':
+            case '/':
+                text += escape;
+                break;
+            case 'b':
+                text += '\b';
+                break;
+            case 'f':
+                text += '\f';
+                break;
+            case 'n':
+                text += '\n';
+                break;
+            case 'r':
+                text += '\r';
+                break;
+            case 't':
+                text += '\t';
+                break;
+            case 'u':
+            {
+                uint32_t code;
+                if (!parseHex4(line, i, code))
+                {
+                    error = "bad \\u escape";
+                    return false;
+                }
+                // Combine a UTF-16 surrogate pair
+                if (code >= 0xD800 && code < 0xDC00 && i + 1 < line.size() && line[i] == '\\' && line[i + 1] == 'u')
+                {
+                    size_t low_at = i + 2;
+                    uint32_t low;
+                    if (parseHex4(line, low_at, low) && low >= 0xDC00 && low < 0xE000)
+                    {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        i = low_at;
+                    }
+                }
+                appendUtf8(text, code);
+                break;
+            }
+            default:
+                error = std::string("bad escape '\\") + escape + "'";
+                return false;
+            }
+        }
+        if (i >= line.size())
+        {
+            error = "unterminated string";
+            return false;
+        }
+        i++; // closing quote
+        unescaped.push_back(std::move(text));
+        value = unescaped.back();
+        return true;
+    }
+
+    static bool parseHex4(std::string_view line, size_t &i, uint32_t &code)
+    {
+        if (i + 4 > line.size())
+            return false;
+        auto result = std::from_chars(line.data() + i, line.data() + i + 4, code, 16);
+        if (result.ec != std::errc() || result.ptr != line.data() + i + 4)
+            return false;
+        i += 4;
+        return true;
+    }
+
+    static void appendUtf8(std::string &text, uint32_t code)
+    {
+        if (code < 0x80)
+        {
+            text += static_cast<char>(code);
+        }
+        else if (code < 0x800)
+        {
+            text += static_cast<char>(0xC0 | (code >> 6));
+            text += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000)
+        {
+            text += static_cast<char>(0xE0 | (code >> 12));
+            text += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            text += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else
+        {
+            text += static_cast<char>(0xF0 | (code >> 18));
+            text += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            text += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            text += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    static std::vector<std::string> csvHeaderNames(std::string_view line)
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+
+        std::vector<std::string> names;
+        size_t start = 0;
+        while (start <= line.size())
+        {
+            size_t comma = std::min(line.find(',', start), line.size());
+            std::string name(line.substr(start, comma - start));
+            name.erase(std::remove(name.begin(), name.end(), '"'), name.end());
+            name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            names.push_back(name);
+            start = comma + 1;
+        }
+        return names;
+    }
+
+    static bool isCsvHeader(std::string_view line)
+    {
+        std::vector<std::string> names = csvHeaderNames(line);
+        return std::find(names.begin(), names.end(), "id") != names.end();
+    }
+
+    static bool parseCsvHeader(std::string_view line, CsvLayout &columns, std::string &error)
+    {
+        std::vector<std::string> names = csvHeaderNames(line);
+        CsvLayout header;
+        std::fill(header.position, header.position + COLUMN_COUNT, -1);
+        header.width = names.size();
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            for (int c = 0; c < COLUMN_COUNT; c++)
+            {
+                if (names[i] == columnName(static_cast<Column>(c)))
+                    header.position[c] = static_cast<int>(i);
+            }
+        }
+        for (Column required : {ID, TITLE, ARTIST, DURATION})
+        {
+            if (header.position[required] < 0)
+            {
+                error = "header is missing '" + std::string(columnName(required)) + "'";
+                return false;
+            }
+        }
+        columns = header;
+        return true;
+    }
+
+    void parseSlice(Slice &slice, Format format) const
+    {
+        std::string_view text = slice.text;
+        std::string error;
+        while (!text.empty())
+        {
+            size_t newline = std::min(text.find('\n'), text.size());
+            std::string_view line = text.substr(0, newline);
+            text.remove_prefix(std::min(newline + 1, text.size()));
+            slice.lines++;
+
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if (line.find_first_not_of(" \t") == std::string_view::npos)
+                continue;
+
+            slice.rows++;
+            SongSpec spec;
+            bool parsed = format == CSV ? parseCsvRow(line, layout, spec, slice.unescaped, error)
+                                        : parseJsonRow(line, spec, slice.unescaped, error);
+            if (parsed)
+            {
+                slice.songs.push_back(spec);
+                slice.song_lines.push_back(slice.lines);
+            }
+            else
+                slice.errors.emplace_back(slice.lines, error);
+        }
+    }
+
+    /**
+     * Parse a chunk of whole lines on all threads and ingest it in order
+     * Returns the number of lines in the chunk
+     */
+    size_t processChunk(std::string_view text, Format format, size_t line_base)
+    {
+        // Split at line boundaries into roughly equal slices
+        std::vector<Slice> slices(std::min(thread_count, std::max<size_t>(1, text.size() / 4096)));
+        size_t begin = 0;
+        for (size_t s = 0; s < slices.size(); s++)
+        {
+            size_t end = s + 1 == slices.size() ? text.size() : text.size() * (s + 1) / slices.size();
+            if (end < text.size())
+                end = std::min(text.find('\n', std::max(end, begin)), text.size() - 1) + 1;
+            end = std::max(end, begin);
+            slices[s].text = text.substr(begin, end - begin);
+            begin = end;
+        }
+
+        std::vector<std::thread> workers;
+        for (size_t s = 1; s < slices.size(); s++)
+            workers.emplace_back([this, &slices, s, format]()
+                                 { parseSlice(slices[s], format); });
+        parseSlice(slices[0], format);
+        for (std::thread &worker : workers)
+            worker.join();
+
+        size_t lines = 0;
+        for (Slice &slice : slices)
+        {
+            rejectDuplicateIds(slice);
+            for (const auto &error : slice.errors)
+                recordError(line_base + lines + error.first, error.second);
+            rows += slice.rows;
+            imported += engine.addSongs(slice.songs);
+            lines += slice.lines;
+        }
+        return lines;
+    }
+
+    /**
+     * Turn rows whose ID is already imported, or repeated in the slice, into errors
+     * Runs in file order after the previous slices were added
+     * Time Complexity: O(r) average for r rows
+     */
+    void rejectDuplicateIds(Slice &slice) const
+    {
+        std::unordered_set<std::string_view> slice_ids;
+        size_t kept = 0;
+        for (size_t i = 0; i < slice.songs.size(); i++)
+        {
+            std::string_view id = slice.songs[i].id;
+            if (engine.getLookup().contains_id(id) || !slice_ids.insert(id).second)
+            {
+                slice.errors.emplace_back(slice.song_lines[i], "duplicate id '" + std::string(id) + "'");
+                continue;
+            }
+            slice.songs[kept++] = slice.songs[i];
+        }
+        if (kept == slice.songs.size())
             return;
+        slice.songs.resize(kept);
+        std::stable_sort(slice.errors.begin(), slice.errors.end(), [](const auto &a, const auto &b)
+                         { return a.first < b.first; });
+    }
+
+    void recordError(size_t line, const std::string &reason)
+    {
+        rejected++;
+        if (errors.size() < MAX_REPORTED_ERRORS)
+            errors.push_back("line " + std::to_string(line) + ": " + reason);
+    }
+};
+
+/**
+ * Framing and socket helpers shared by EngineServer and LoadGenerator
+ * Every frame is [payload length: u32 little-endian][payload]. A request
+ * payload is one command line in the CommandScriptRunner syntax; a response
+ * payload is [status: u8, 0 = ok, 1 = error][text]. Endpoints are a Unix
+ * socket path or "tcp:<port>" on the loopback interface.
+ */
+class ServerProtocol
+{
+public:
+    enum Status : uint8_t
+    {
+        OK = 0,
+        ERROR = 1
+    };
 
-        // Clear existing queue
-        while (!replay_queue.empty())
-        {
-            replay_queue.pop();
-        }
+    static constexpr uint32_t MAX_FRAME = 1 << 20; // a longer frame closes the connection
+    static constexpr size_t HEADER_BYTES = 4;
 
-        // Get top 3 calming songs
-        auto top_calming = getTopCalmingSongs(all_songs, 3);
+    static void appendHeader(std::string &out, uint32_t length)
+    {
+        char header[HEADER_BYTES] = {static_cast<char>(length & 0xff), static_cast<char>((length >> 8) & 0xff),
+                                     static_cast<char>((length >> 16) & 0xff), static_cast<char>(length >> 24)};
+        out.append(header, HEADER_BYTES);
+    }
 
-        if (!top_calming.empty())
-        {
-            std::cout << "\n🎵 Auto-replay activated! Top calming songs:" << std::endl;
-            for (size_t i = 0; i < top_calming.size(); i++)
-            {
-                replay_queue.push(top_calming[i]);
-                std::cout << (i + 1) << ". " << top_calming[i]->toString() << std::endl;
-            }
-            replay_cycles++;
-            std::cout << "Replay cycle #" << replay_cycles << " starting...\n"
-                      << std::endl;
-        }
+    static void appendRequest(std::string &out, std::string_view line)
+    {
+        appendHeader(out, static_cast<uint32_t>(line.size()));
+        out.append(line.data(), line.size());
+    }
+
+    static void appendResponse(std::string &out, Status status, std::string_view text)
+    {
+        appendHeader(out, static_cast<uint32_t>(text.size() + 1));
+        out.push_back(static_cast<char>(status));
+        out.append(text.data(), text.size());
     }
 
     /**
-     * Get next song from auto-replay queue
-     * Time Complexity: O(1)
-     * Space Complexity: O(1)
+     * Take the next complete frame at offset
+     * Returns 1 and advances offset past the frame, 0 if more bytes are
+     * needed, or -1 if the frame is longer than MAX_FRAME
      */
-    Song *getNextReplaySong()
+    static int nextFrame(const std::string &buffer, size_t &offset, std::string_view &payload)
+    {
+        if (buffer.size() - offset < HEADER_BYTES)
+            return 0;
+        const unsigned char *header = reinterpret_cast<const unsigned char *>(buffer.data() + offset);
+        uint32_t length = header[0] | (header[1] << 8) | (header[2] << 16) | (static_cast<uint32_t>(header[3]) << 24);
+        if (length > MAX_FRAME)
+            return -1;
+        if (buffer.size() - offset - HEADER_BYTES < length)
+            return 0;
+        payload = std::string_view(buffer.data() + offset + HEADER_BYTES, length);
+        offset += HEADER_BYTES + length;
+        return 1;
+    }
+
+    static bool parseEndpoint(const std::string &endpoint, sockaddr_storage &address, socklen_t &length)
     {
-        if (replay_queue.empty())
+        std::memset(&address, 0, sizeof(address));
+        if (endpoint.compare(0, 4, "tcp:") == 0)
         {
-            return nullptr;
+            int port = -1;
+            const char *end = endpoint.data() + endpoint.size();
+            auto result = std::from_chars(endpoint.data() + 4, end, port);
+            if (result.ec != std::errc() || result.ptr != end || port < 0 || port > 65535)
+                return false;
+            sockaddr_in *inet = reinterpret_cast<sockaddr_in *>(&address);
+            inet->sin_family = AF_INET;
+            inet->sin_port = htons(static_cast<uint16_t>(port));
+            inet->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            length = sizeof(sockaddr_in);
+            return true;
         }
 
-        Song *song = replay_queue.front();
-        replay_queue.pop();
+        sockaddr_un *local = reinterpret_cast<sockaddr_un *>(&address);
+        if (endpoint.empty() || endpoint.size() >= sizeof(local->sun_path))
+            return false;
+        local->sun_family = AF_UNIX;
+        std::memcpy(local->sun_path, endpoint.c_str(), endpoint.size() + 1);
+        length = sizeof(sockaddr_un);
+        return true;
+    }
 
-        // Re-add to queue for continuous loop
-        replay_queue.push(song);
+    static bool setNonBlocking(int fd)
+    {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
 
-        return song;
+    // Blocking connect; the descriptor is non-blocking once returned, -1 on failure
+    static int connectTo(const std::string &endpoint)
+    {
+        sockaddr_storage address;
+        socklen_t length = 0;
+        if (!parseEndpoint(endpoint, address, length))
+            return -1;
+        int fd = ::socket(address.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return -1;
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&address), length) != 0 || !setNonBlocking(fd))
+        {
+            ::close(fd);
+            return -1;
+        }
+        if (address.ss_family == AF_INET)
+        {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        return fd;
     }
 
     /**
-     * Get play count statistics
-     * Time Complexity: O(n)
-     * Space Complexity: O(n)
+     * Write out[offset..] until the socket would block
+     * Returns false on a hard error; fully written buffers are cleared
      */
-    std::unordered_map<std::string, int> getPlayCountStats() const
+    static bool flush(int fd, std::string &out, size_t &offset)
     {
-        return play_counts;
+        while (offset < out.size())
+        {
+            ssize_t written = ::send(fd, out.data() + offset, out.size() - offset, MSG_NOSIGNAL);
+            if (written > 0)
+                offset += static_cast<size_t>(written);
+            else if (written < 0 && errno == EINTR)
+                continue;
+            else
+                return written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+        out.clear();
+        offset = 0;
+        return true;
     }
 
-    bool hasReplaySongs() const { return !replay_queue.empty(); }
-    void enableAutoReplay(bool enable) { auto_replay_enabled = enable; }
-    bool isAutoReplayEnabled() const { return auto_replay_enabled; }
-    int getReplayCycles() const { return replay_cycles; }
-
     /**
-     * Display auto-replay statistics
+     * Append up to READ_BUDGET readable bytes to in
+     * Returns false once the peer has closed or on a hard error; a busy
+     * connection yields after its budget so others are not starved
      */
-    void displayStats() const
+    static bool drain(int fd, std::string &in)
     {
-        std::cout << "\n=== Auto-Replay Statistics ===" << std::endl;
-        std::cout << "Auto-replay enabled: " << (auto_replay_enabled ? "Yes" : "No") << std::endl;
-        std::cout << "Replay cycles completed: " << replay_cycles << std::endl;
-        std::cout << "Songs in replay queue: " << replay_queue.size() << std::endl;
-
-        if (!play_counts.empty())
+        char chunk[64 * 1024];
+        for (size_t budget = READ_BUDGET; budget > 0; budget -= std::min(budget, sizeof(chunk)))
         {
-            std::cout << "\nTop played songs:" << std::endl;
-            std::vector<std::pair<int, std::string>> sorted_plays;
-            for (const auto &pair : play_counts)
-            {
-                sorted_plays.push_back({pair.second, pair.first});
-            }
-            std::sort(sorted_plays.rbegin(), sorted_plays.rend());
-
-            for (size_t i = 0; i < std::min(size_t(5), sorted_plays.size()); i++)
-            {
-                std::cout << (i + 1) << ". Song ID: " << sorted_plays[i].second
-                          << " (" << sorted_plays[i].first << " plays)" << std::endl;
-            }
+            ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (received > 0)
+                in.append(chunk, static_cast<size_t>(received));
+            else if (received < 0 && errno == EINTR)
+                budget += sizeof(chunk);
+            else
+                return received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
         }
-        std::cout << "==============================\n"
-                  << std::endl;
+        return true;
+    }
+
+    // Register, or change, the epoll interest set of fd only when it differs
+    static void watch(int epoll_fd, int fd, uint32_t &current, uint32_t wanted, uint64_t key)
+    {
+        if (current == wanted)
+            return;
+        epoll_event event{};
+        event.events = wanted;
+        event.data.u64 = key;
+        epoll_ctl(epoll_fd, current == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &event);
+        current = wanted;
     }
+
+private:
+    static constexpr size_t READ_BUDGET = 256 * 1024;
 };
 
 /**
- * Main PlayWise Engine - Integrates all components
+ * Single-threaded epoll front end for a PlayWiseEngine
+ * Multiplexes any number of client connections on a Unix socket or loopback
+ * TCP port with level-triggered epoll. Clients may pipeline: every complete
+ * frame in a read is executed in arrival order and the responses are queued
+ * in that order, so one wakeup serves a whole batch with one write. Commands
+ * go through CommandScriptRunner (which also keeps the per-command latency
+ * table); the server adds read-only queries that return data:
+ *   ping | get <id> | find "<title>" | count
+ *   stats (EngineMetrics latency table) | metrics (Prometheus text format)
+ *   memory (MemoryReport as JSON)
+ * A client whose unsent responses pass MAX_PENDING_OUTPUT is not read again
+ * until it drains them. Engine console output is discarded while serving.
+ * Time Complexity: O(B) per wakeup for B bytes received, plus the commands
+ * Space Complexity: O(C + P) for C connections and P buffered bytes
  */
-class PlayWiseEngine
+class EngineServer
 {
 private:
-    PlaylistEngine playlist;
-    PlaybackHistory history;
-    SongRatingTree ratingTree;
-    InstantLookup lookup;
-    RecentlySkippedTracker skipped_tracker; // New: Recently skipped tracker
-    AutoReplayManager replay_manager;       // New: Auto replay manager
-    std::vector<Song *> songDatabase;       // Owns the song objects
-    Song *current_song;                     // Track currently playing song
-    bool playlist_ended;                    // Track if playlist has ended
+    struct Connection
+    {
+        int fd = -1;
+        std::string input;
+        std::string output;
+        size_t output_offset = 0;
+        uint32_t events = 0; // interest registered with epoll
+    };
+
+    PlayWiseEngine &engine;
+    CommandScriptRunner runner;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    std::string socket_path; // Unix socket file removed on close
+    std::string bound_endpoint;
+    int listen_fd;
+    int epoll_fd;
+    int wake_fd; // eventfd that stop() signals
+    std::atomic<bool> stopping;
+    size_t accepted;
+    size_t peak_connections;
+    size_t requests;
+    size_t failed_requests;
+    size_t protocol_errors;
+    double elapsed_seconds;
+
+    static constexpr size_t MAX_PENDING_OUTPUT = 4 << 20;
+    static constexpr int MAX_EVENTS = 256;
 
 public:
-    PlayWiseEngine() : current_song(nullptr), playlist_ended(false) {}
+    explicit EngineServer(PlayWiseEngine &target)
+        : engine(target), runner(target), listen_fd(-1), epoll_fd(-1), wake_fd(-1), stopping(false),
+          accepted(0), peak_connections(0), requests(0), failed_requests(0), protocol_errors(0), elapsed_seconds(0.0) {}
 
-    ~PlayWiseEngine()
-    {
-        // Clean up songs
-        for (Song *song : songDatabase)
-        {
-            delete song;
-        }
-    }
+    ~EngineServer() { close(); }
+
+    EngineServer(const EngineServer &) = delete;
+    EngineServer &operator=(const EngineServer &) = delete;
 
     /**
-     * Add new song to the system
-     * Time Complexity: O(log n) due to BST insertion
-     * Space Complexity: O(1)
+     * Listen on a Unix socket path or "tcp:<port>" ("tcp:0" picks a free port)
+     * A stale socket file at the path is replaced
      */
-    Song *addSong(const std::string &id, const std::string &title,
-                  const std::string &artist, int duration, int rating = 0,
-                  const std::string &genre = "Unknown")
+    bool listen(const std::string &endpoint)
     {
-        Song *song = new Song(id, title, artist, duration, rating, genre);
-        songDatabase.push_back(song);
-
-        playlist.add_song(song);
-        lookup.add_song(song);
-        if (rating > 0)
+        sockaddr_storage address;
+        socklen_t length = 0;
+        if (!ServerProtocol::parseEndpoint(endpoint, address, length))
         {
-            ratingTree.insert_song(song, rating);
+            std::cout << "❌ Invalid endpoint: " << endpoint << std::endl;
+            return false;
         }
 
-        return song;
-    }
-
-    void playSong(const std::string &song_id)
-    {
-        Song *song = lookup.lookup_by_id(song_id);
-        if (song)
+        close();
+        if (address.ss_family == AF_UNIX)
+            ::unlink(endpoint.c_str());
+        listen_fd = ::socket(address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        if (listen_fd >= 0 && address.ss_family == AF_INET)
+            setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<sockaddr *>(&address), length) != 0 ||
+            ::listen(listen_fd, SOMAXCONN) != 0)
         {
-            // Check if song was recently skipped
-            if (skipped_tracker.wasRecentlySkipped(song_id))
-            {
-                std::cout << "⚠️  Warning: This song was recently skipped. Playing anyway..." << std::endl;
-            }
-
-            current_song = song;
-            history.play_song(song);
-            replay_manager.recordPlay(song); // Record play count
-            playlist_ended = false;
+            int error = errno;
+            close();
+            std::cout << "❌ Cannot listen on " << endpoint << ": " << std::strerror(error) << std::endl;
+            return false;
+        }
 
-            std::cout << "🎵 Now playing: " << song->toString() << std::endl;
+        bound_endpoint = endpoint;
+        if (address.ss_family == AF_UNIX)
+        {
+            socket_path = endpoint;
         }
         else
         {
-            std::cout << "❌ Song not found!" << std::endl;
+            sockaddr_in bound{};
+            socklen_t bound_length = sizeof(bound);
+            getsockname(listen_fd, reinterpret_cast<sockaddr *>(&bound), &bound_length);
+            bound_endpoint = "tcp:" + std::to_string(ntohs(bound.sin_port));
         }
+
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        uint32_t listen_events = 0, wake_events = 0;
+        ServerProtocol::watch(epoll_fd, listen_fd, listen_events, EPOLLIN, static_cast<uint64_t>(listen_fd));
+        ServerProtocol::watch(epoll_fd, wake_fd, wake_events, EPOLLIN, static_cast<uint64_t>(wake_fd));
+        return true;
     }
 
     /**
-     * Skip current song and add to recently skipped tracker
-     * Time Complexity: O(1)
-     * Space Complexity: O(1)
+     * Close every connection and the listening socket
+     * The Unix socket file is removed
      */
-    void skipCurrentSong()
+    void close()
     {
-        if (current_song)
-        {
-            skipped_tracker.addSkippedSong(current_song->id);
-            std::cout << "⏭️  Skipped: " << current_song->toString() << std::endl;
-            std::cout << "Added to recently skipped list (" << skipped_tracker.size() << "/10)" << std::endl;
-            current_song = nullptr;
-        }
-        else
+        for (auto &pair : connections)
+            ::close(pair.first);
+        connections.clear();
+        for (int *fd : {&listen_fd, &epoll_fd, &wake_fd})
         {
-            std::cout << "❌ No song is currently playing!" << std::endl;
+            if (*fd >= 0)
+                ::close(*fd);
+            *fd = -1;
         }
+        if (!socket_path.empty())
+            ::unlink(socket_path.c_str());
+        socket_path.clear();
     }
 
     /**
-     * Auto-play next song with smart selection
-     * Avoids recently skipped songs unless no alternatives
-     * Time Complexity: O(n) where n is playlist size
-     * Space Complexity: O(1)
+     * Serve until stop() is called; returns the number of requests handled
      */
-    Song *autoPlayNext()
+    size_t run()
     {
-        auto all_songs = playlist.getAllSongs();
+        if (epoll_fd < 0)
+            return 0;
 
-        // First, try to find a song that wasn't recently skipped
-        for (Song *song : all_songs)
+        NullStreamBuffer sink;
+        std::streambuf *old_buf = std::cout.rdbuf(&sink);
+
+        auto start = std::chrono::steady_clock::now();
+        epoll_event events[MAX_EVENTS];
+        while (!stopping.load(std::memory_order_acquire))
         {
-            if (song && !skipped_tracker.wasRecentlySkipped(song->id))
+            int ready = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+            if (ready < 0 && errno != EINTR)
+                break;
+            for (int i = 0; i < ready; i++)
             {
-                playSong(song->id);
-                return song;
+                int fd = static_cast<int>(events[i].data.u64);
+                if (fd == listen_fd)
+                    acceptAll();
+                else if (fd != wake_fd)
+                    service(fd, events[i].events);
             }
         }
+        elapsed_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-        // If all songs were skipped, check for auto-replay
-        if (all_songs.empty() || checkAndHandlePlaylistEnd())
-        {
-            return nullptr;
-        }
-
-        // Last resort: play a recently skipped song
-        if (!all_songs.empty())
-        {
-            std::cout << "🔄 All songs were recently skipped. Playing least recently skipped..." << std::endl;
-            playSong(all_songs[0]->id);
-            return all_songs[0];
-        }
+        std::cout.rdbuf(old_buf);
+        return requests;
+    }
 
-        return nullptr;
+    /**
+     * Make run() return; safe from other threads and signal handlers
+     * The server stays stopped
+     */
+    void stop()
+    {
+        stopping.store(true, std::memory_order_release);
+        uint64_t one = 1;
+        if (wake_fd >= 0 && ::write(wake_fd, &one, sizeof(one)) < 0)
+            return; // counter saturated - a wakeup is already pending
     }
 
     /**
-     * Check if playlist ended and handle auto-replay for calming genres
-     * Time Complexity: O(n log n) for auto-replay setup
-     * Space Complexity: O(k) where k is replay queue size
+     * Execute one request line
+     * Returns false with the error text in body if it failed
      */
-    bool checkAndHandlePlaylistEnd()
+    bool execute(const std::string &line, std::string &body)
     {
-        if (playlist.getAllSongs().empty())
+        body.clear();
+        auto args = CommandScriptRunner::tokenize(line);
+        if (args.empty())
         {
-            playlist_ended = true;
-            std::cout << "📋 Playlist ended!" << std::endl;
+            body = "empty request";
+            return false;
+        }
 
-            if (replay_manager.isAutoReplayEnabled())
+        const std::string &command = args[0];
+        if (command == "ping")
+        {
+            body = "pong";
+        }
+        else if (command == "get")
+        {
+            Song *song = args.size() == 2 ? engine.getLookup().lookup_by_id(args[1]) : nullptr;
+            if (!song)
             {
-                replay_manager.setupAutoReplay(songDatabase);
-
-                Song *replay_song = replay_manager.getNextReplaySong();
-                if (replay_song)
-                {
-                    std::cout << "🔁 Auto-replaying calming song..." << std::endl;
-                    playSong(replay_song->id);
-                    return false; // Continue playing
-                }
+                body = args.size() == 2 ? "no song " + args[1] : "usage: get <id>";
+                return false;
             }
-
-            std::cout << "🎵 No more songs to play. Add more songs or enable auto-replay!" << std::endl;
-            return true; // Playlist truly ended
+            body = song->id + "\t" + song->toString();
         }
-        return false;
-    }
-
-    void undoLastPlay()
-    {
-        Song *song = history.undo_last_play();
-        if (song)
+        else if (command == "find")
         {
-            playlist.add_song(song);
-            std::cout << "Re-added to playlist: " << song->toString() << std::endl;
+            if (args.size() != 2)
+            {
+                body = "usage: find \"<title>\"";
+                return false;
+            }
+            for (Song *song : engine.getLookup().lookup_by_title(args[1]))
+                body += song->id + "\t" + song->toString() + "\n";
         }
-    }
-
-    void sortPlaylist(PlaylistSorter::SortCriteria criteria, bool useQuickSort = false)
-    {
-        auto songs = playlist.getAllSongs();
-
-        auto start = std::chrono::high_resolution_clock::now();
-        if (useQuickSort)
+        else if (command == "count")
+        {
+            body = std::to_string(engine.getSongDatabase().size());
+        }
+        else if (command == "stats" || command == "metrics" || command == "memory")
         {
-            PlaylistSorter::quickSort(songs, criteria);
+            std::ostringstream text;
+            if (command == "stats")
+                EngineMetrics::report(text);
+            else if (command == "metrics")
+                EngineMetrics::exposition(text);
+            else
+                engine.memoryReport().writeJson(text);
+            body = text.str();
         }
         else
         {
-            PlaylistSorter::mergeSort(songs, criteria);
+            body = runner.executeTokens(args);
+            return body.empty();
         }
-        auto end = std::chrono::high_resolution_clock::now();
-
-        playlist.rebuildFromVector(songs);
-
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-        std::cout << "Sorting completed in " << duration.count() << " microseconds" << std::endl;
+        return true;
     }
 
     /**
-     * System Snapshot for Dashboard
-     * Time Complexity: O(n log n) due to sorting for top longest songs
-     * Space Complexity: O(n)
+     * Requests, connections and the per-command latency table
      */
-    struct SystemSnapshot
+    void report(std::ostream &out) const
     {
-        std::vector<Song *> top_longest_songs;
-        std::vector<Song *> recently_played;
-        std::unordered_map<int, int> rating_counts;
-        int total_songs;
-        int playlist_size;
-    };
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << "\n=== Server Report ===" << std::endl;
+        out << "Endpoint: " << bound_endpoint << std::endl;
+        out << "Connections: " << accepted << " accepted, " << peak_connections << " peak" << std::endl;
+        out << "Requests: " << requests << " (" << failed_requests << " failed) in " << std::fixed
+            << std::setprecision(3) << elapsed_seconds << " s" << std::endl;
+        out << "Protocol errors: " << protocol_errors << std::endl;
+        out << "=====================" << std::endl;
+        out.flags(flags);
+        out.precision(precision);
+        runner.report(out);
+    }
 
-    SystemSnapshot export_snapshot()
-    {
-        SystemSnapshot snapshot;
+    const std::string &getEndpoint() const { return bound_endpoint; }
+    size_t getRequestCount() const { return requests; }
+    size_t getFailedRequestCount() const { return failed_requests; }
+    size_t getProtocolErrorCount() const { return protocol_errors; }
+    size_t getAcceptedCount() const { return accepted; }
+    size_t getPeakConnections() const { return peak_connections; }
+    size_t getConnectionCount() const { return connections.size(); }
 
-        // Top 5 longest songs
-        auto allSongs = songDatabase;
-        PlaylistSorter::quickSort(allSongs, PlaylistSorter::DURATION_DESC);
-        for (int i = 0; i < std::min(5, (int)allSongs.size()); i++)
+private:
+    void acceptAll()
+    {
+        while (true)
         {
-            snapshot.top_longest_songs.push_back(allSongs[i]);
-        }
-
-        // Recently played songs
-        snapshot.recently_played = history.getRecentlyPlayed(5);
-
-        // Song count by rating
-        snapshot.rating_counts = ratingTree.getSongCountByRating();
-
-        // General stats
-        snapshot.total_songs = songDatabase.size();
-        snapshot.playlist_size = playlist.getSize();
+            int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                return; // EAGAIN, or out of descriptors until a client leaves
+            }
+            if (socket_path.empty())
+            {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
 
-        return snapshot;
+            auto connection = std::make_unique<Connection>();
+            connection->fd = fd;
+            ServerProtocol::watch(epoll_fd, fd, connection->events, EPOLLIN, static_cast<uint64_t>(fd));
+            connections[fd] = std::move(connection);
+            accepted++;
+            peak_connections = std::max(peak_connections, connections.size());
+        }
     }
 
-    void displaySnapshot()
+    void service(int fd, uint32_t ready)
     {
-        auto snapshot = export_snapshot();
+        auto it = connections.find(fd);
+        if (it == connections.end())
+            return;
+        Connection &connection = *it->second;
 
-        std::cout << "\n=== PlayWise System Snapshot ===" << std::endl;
-        std::cout << "Total Songs: " << snapshot.total_songs << std::endl;
-        std::cout << "Playlist Size: " << snapshot.playlist_size << std::endl;
+        bool open = (ready & EPOLLERR) == 0;
+        if (open && (ready & (EPOLLIN | EPOLLHUP)))
+            open = ServerProtocol::drain(fd, connection.input);
 
-        std::cout << "\nTop 5 Longest Songs:" << std::endl;
-        for (size_t i = 0; i < snapshot.top_longest_songs.size(); i++)
+        // Frames held back by a full output buffer run as soon as it drains;
+        // responses to a peer that half-closed are still worth sending
+        int framing = 0;
+        bool written = true;
+        do
         {
-            std::cout << (i + 1) << ". " << snapshot.top_longest_songs[i]->toString() << std::endl;
+            framing = processFrames(connection);
+            written = ServerProtocol::flush(fd, connection.output, connection.output_offset);
+        } while (framing > 0 && written && connection.output.empty());
+        if (!open || !written || framing < 0)
+        {
+            closeConnection(fd);
+            return;
         }
 
-        std::cout << "\nRecently Played:" << std::endl;
-        for (size_t i = 0; i < snapshot.recently_played.size(); i++)
+        size_t pending = connection.output.size() - connection.output_offset;
+        uint32_t wanted = (pending < MAX_PENDING_OUTPUT ? uint32_t(EPOLLIN) : 0u) | (pending > 0 ? uint32_t(EPOLLOUT) : 0u);
+        ServerProtocol::watch(epoll_fd, fd, connection.events, wanted, static_cast<uint64_t>(fd));
+    }
+
+    /**
+     * Execute the complete frames received so far
+     * Returns 0 when all were run, 1 when stopped by a full output buffer
+     * and -1 on a protocol error
+     */
+    int processFrames(Connection &connection)
+    {
+        size_t offset = 0;
+        std::string_view payload;
+        std::string body;
+        int status = 0;
+        bool full = false;
+        while (!(full = connection.output.size() - connection.output_offset >= MAX_PENDING_OUTPUT) &&
+               (status = ServerProtocol::nextFrame(connection.input, offset, payload)) > 0)
         {
-            std::cout << (i + 1) << ". " << snapshot.recently_played[i]->toString() << std::endl;
+            requests++;
+            bool ok = execute(std::string(payload), body);
+            if (!ok)
+                failed_requests++;
+            ServerProtocol::appendResponse(connection.output, ok ? ServerProtocol::OK : ServerProtocol::ERROR, body);
         }
-
-        std::cout << "\nSong Count by Rating:" << std::endl;
-        for (int rating = 1; rating <= 5; rating++)
+        connection.input.erase(0, offset);
+        if (status < 0)
         {
-            int count = (snapshot.rating_counts.find(rating) != snapshot.rating_counts.end())
-                            ? snapshot.rating_counts[rating]
-                            : 0;
-            std::cout << rating << " stars: " << count << " songs" << std::endl;
+            protocol_errors++;
+            return -1;
         }
-        std::cout << "================================\n"
-                  << std::endl;
+        return full ? 1 : 0;
     }
 
-    // Accessor methods for testing
-    PlaylistEngine &getPlaylist() { return playlist; }
-    PlaybackHistory &getHistory() { return history; }
-    SongRatingTree &getRatingTree() { return ratingTree; }
-    InstantLookup &getLookup() { return lookup; }
-    RecentlySkippedTracker &getSkippedTracker() { return skipped_tracker; }
-    AutoReplayManager &getReplayManager() { return replay_manager; }
+    void closeConnection(int fd)
+    {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        connections.erase(fd);
+    }
+};
+
+/**
+ * Closed-loop load generator for EngineServer
+ * Opens C connections from one epoll loop and keeps up to D requests in
+ * flight on each (pipelining), cycling through a list of request lines until
+ * N responses have arrived. A request's latency runs from when it is queued
+ * to when its response is parsed, so it includes time spent behind earlier
+ * requests in the same pipeline.
+ * Time Complexity: O(N log N) for the percentiles
+ * Space Complexity: O(N) latency samples
+ */
+class LoadGenerator
+{
+private:
+    struct Client
+    {
+        int fd = -1;
+        std::string input;
+        std::string output;
+        size_t output_offset = 0;
+        uint32_t events = 0;
+        std::deque<std::chrono::steady_clock::time_point> in_flight;
+    };
+
+    std::string endpoint;
+    size_t connection_count;
+    size_t pipeline_depth;
+    std::vector<uint64_t> latencies; // nanoseconds, sorted after run()
+    size_t completed;
+    size_t failed;
+    size_t connect_failures;
+    double elapsed_seconds;
+
+    static constexpr int MAX_EVENTS = 256;
+    static constexpr int STALL_TIMEOUT_MS = 10000; // give up when the server stops answering
+
+public:
+    LoadGenerator(const std::string &target, size_t connections, size_t depth)
+        : endpoint(target), connection_count(std::max<size_t>(connections, 1)), pipeline_depth(std::max<size_t>(depth, 1)),
+          completed(0), failed(0), connect_failures(0), elapsed_seconds(0.0) {}
 
     /**
-     * Display recently skipped songs
+     * Send total requests, cycling through lines
+     * Returns true when every request was answered
      */
-    void displayRecentlySkipped() const
+    bool run(const std::vector<std::string> &lines, size_t total)
     {
-        std::cout << "\n=== Recently Skipped Songs ===" << std::endl;
-        if (skipped_tracker.empty())
+        latencies.clear();
+        latencies.reserve(total);
+        completed = failed = connect_failures = 0;
+        if (lines.empty())
+            return total == 0;
+
+        int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0)
+            return false;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<Client> clients(connection_count);
+        size_t next_request = 0;
+        size_t open = 0;
+        for (size_t c = 0; c < clients.size(); c++)
         {
-            std::cout << "No recently skipped songs." << std::endl;
+            clients[c].fd = ServerProtocol::connectTo(endpoint);
+            if (clients[c].fd < 0)
+            {
+                connect_failures++;
+                continue;
+            }
+            if (pump(epoll_fd, clients[c], c, lines, next_request, total))
+                open++;
+            else
+                closeClient(epoll_fd, clients[c]);
         }
-        else
+
+        epoll_event events[MAX_EVENTS];
+        while (open > 0 && completed < total)
         {
-            auto skipped_ids = skipped_tracker.getRecentlySkipped();
-            std::cout << "Last " << skipped_ids.size() << " skipped songs:" << std::endl;
-            for (size_t i = 0; i < skipped_ids.size(); i++)
+            int ready = epoll_wait(epoll_fd, events, MAX_EVENTS, STALL_TIMEOUT_MS);
+            if (ready == 0)
+                break;
+            if (ready < 0 && errno != EINTR)
+                break;
+            for (int i = 0; i < ready; i++)
             {
-                // Find song in database since lookup is const
-                for (const Song *song : songDatabase)
+                size_t c = static_cast<size_t>(events[i].data.u64);
+                Client &client = clients[c];
+                bool alive = (events[i].events & EPOLLERR) == 0;
+                if (alive && (events[i].events & (EPOLLIN | EPOLLHUP)))
+                    alive = ServerProtocol::drain(client.fd, client.input) && collect(client);
+                if (!alive || !pump(epoll_fd, client, c, lines, next_request, total))
                 {
-                    if (song && song->id == skipped_ids[i])
-                    {
-                        std::cout << (i + 1) << ". " << song->toString() << std::endl;
-                        break;
-                    }
+                    closeClient(epoll_fd, client);
+                    open--;
                 }
             }
         }
-        std::cout << "=============================\n"
-                  << std::endl;
+
+        for (Client &client : clients)
+        {
+            if (client.fd >= 0)
+                ::close(client.fd);
+        }
+        ::close(epoll_fd);
+        elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::sort(latencies.begin(), latencies.end());
+        return completed == total;
     }
 
     /**
-     * Clear recently skipped songs
+     * Nearest-rank latency percentile in nanoseconds
      */
-    void clearRecentlySkipped()
+    uint64_t latencyPercentile(double p) const { return CommandScriptRunner::percentile(latencies, p); }
+
+    void report(std::ostream &out) const
     {
-        skipped_tracker.clear();
-        std::cout << "✅ Recently skipped songs cleared!" << std::endl;
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+
+        out << "\n=== Load Generator Report ===" << std::endl;
+        out << "Endpoint: " << endpoint << " (" << connection_count << " connections, pipeline depth "
+            << pipeline_depth << ")" << std::endl;
+        out << "Responses: " << completed << " in " << std::fixed << std::setprecision(3) << elapsed_seconds << " s";
+        if (elapsed_seconds > 0)
+            out << " (" << std::setprecision(0) << completed / elapsed_seconds << " req/sec)";
+        out << std::endl;
+        out << "Errors: " << failed << " error responses, " << connect_failures << " failed connects" << std::endl;
+        out << "Latency (us): p50 " << std::setprecision(1) << latencyPercentile(0.50) / 1000.0
+            << "  p90 " << latencyPercentile(0.90) / 1000.0
+            << "  p99 " << latencyPercentile(0.99) / 1000.0
+            << "  p99.9 " << latencyPercentile(0.999) / 1000.0
+            << "  max " << (latencies.empty() ? 0 : latencies.back()) / 1000.0 << std::endl;
+        out << "=============================\n"
+            << std::endl;
+
+        out.flags(flags);
+        out.precision(precision);
     }
 
-    /**
-     * Toggle auto-replay feature
-     */
-    void toggleAutoReplay()
+    size_t getCompleted() const { return completed; }
+    size_t getFailed() const { return failed; }
+    size_t getConnectFailures() const { return connect_failures; }
+    double getElapsedSeconds() const { return elapsed_seconds; }
+
+    // Adds for songs L0..L(count-1), used to seed a server before a run
+    static std::vector<std::string> seedCommands(size_t count)
     {
-        bool current_state = replay_manager.isAutoReplayEnabled();
-        replay_manager.enableAutoReplay(!current_state);
-        std::cout << "🔄 Auto-replay " << (!current_state ? "enabled" : "disabled") << std::endl;
+        static const char *genres[] = {"Jazz", "Rock", "Pop", "Classical", "Lo-Fi"};
+        std::vector<std::string> lines;
+        lines.reserve(count);
+        for (size_t i = 0; i < count; i++)
+            lines.push_back("add L" + std::to_string(i) + " \"Load Song " + std::to_string(i) + "\" \"Artist " +
+                            std::to_string(i % 97) + "\" " + std::to_string(120 + i % 240) + " " +
+                            std::to_string(1 + i % 5) + " " + genres[i % 5]);
+        return lines;
     }
 
-    /**
-     * Display songs by genre
-     */
-    void displaySongsByGenre() const
+    // Read-heavy mix over the seeded songs: 60% get, 20% find, 10% play, 10% rate
+    static std::vector<std::string> mixedWorkload(size_t count)
     {
-        std::unordered_map<std::string, std::vector<Song *>> genre_map;
+        std::vector<std::string> lines;
+        lines.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            std::string id = "L" + std::to_string((i * 7919) % count);
+            size_t kind = i % 10;
+            if (kind < 6)
+                lines.push_back("get " + id);
+            else if (kind < 8)
+                lines.push_back("find \"Load Song " + id.substr(1) + "\"");
+            else if (kind < 9)
+                lines.push_back("play " + id);
+            else
+                lines.push_back("rate " + id + " " + std::to_string(1 + i % 5));
+        }
+        return lines;
+    }
 
-        for (Song *song : songDatabase)
+private:
+    // Parse every complete response; false on a malformed stream
+    bool collect(Client &client)
+    {
+        auto now = std::chrono::steady_clock::now();
+        size_t offset = 0;
+        std::string_view payload;
+        int status = 0;
+        while ((status = ServerProtocol::nextFrame(client.input, offset, payload)) > 0)
         {
-            genre_map[song->genre].push_back(song);
+            if (client.in_flight.empty())
+                return false;
+            latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(now - client.in_flight.front()).count());
+            client.in_flight.pop_front();
+            completed++;
+            if (payload.empty() || static_cast<uint8_t>(payload[0]) != ServerProtocol::OK)
+                failed++;
         }
+        client.input.erase(0, offset);
+        return status == 0;
+    }
 
-        std::cout << "\n=== Songs by Genre ===" << std::endl;
-        for (const auto &pair : genre_map)
+    // Top the pipeline up, write, and update interest; false once the client is finished or broken
+    bool pump(int epoll_fd, Client &client, size_t key, const std::vector<std::string> &lines,
+              size_t &next_request, size_t total)
+    {
+        auto now = std::chrono::steady_clock::now();
+        while (client.in_flight.size() < pipeline_depth && next_request < total)
         {
-            std::cout << "\n📁 " << pair.first << " (" << pair.second.size() << " songs):" << std::endl;
-            for (size_t i = 0; i < pair.second.size(); i++)
-            {
-                std::cout << "  " << (i + 1) << ". " << pair.second[i]->toString() << std::endl;
-            }
+            ServerProtocol::appendRequest(client.output, lines[next_request++ % lines.size()]);
+            client.in_flight.push_back(now);
         }
-        std::cout << "======================\n"
-                  << std::endl;
+        if (!ServerProtocol::flush(client.fd, client.output, client.output_offset))
+            return false;
+        if (client.in_flight.empty())
+            return false;
+
+        uint32_t wanted = EPOLLIN | (client.output.empty() ? 0u : uint32_t(EPOLLOUT));
+        ServerProtocol::watch(epoll_fd, client.fd, client.events, wanted, key);
+        return true;
+    }
+
+    void closeClient(int epoll_fd, Client &client)
+    {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client.fd, nullptr);
+        ::close(client.fd);
+        client.fd = -1;
     }
 };
 
@@ -1330,16 +8931,59 @@ class InteractiveMenu
 {
 private:
     PlayWiseEngine engine;
+    std::unique_ptr<TraceRecorder> recorder; // set while a trace is being recorded
+    std::string state_path;                  // restored on start and saved on exit when set
 
 public:
+    void setStateFile(const std::string &path) { state_path = path; }
+
+    /**
+     * Start logging engine operations to a binary trace file
+     * Songs already in the catalog are written first so the trace replays standalone
+     */
+    bool startRecording(const std::string &path)
+    {
+        std::unique_ptr<TraceRecorder> trace(new TraceRecorder(path));
+        if (!trace->isOpen())
+        {
+            std::cout << "❌ Cannot open trace file: " << path << std::endl;
+            return false;
+        }
+        for (Song *song : engine.getSongDatabase())
+        {
+            trace->record(EngineTrace::ADD_SONG, {song->id, song->title, song->artist, song->genre},
+                          {song->duration, song->rating});
+        }
+        recorder = std::move(trace);
+        std::cout << "⏺️  Recording engine operations to " << path << std::endl;
+        return true;
+    }
+
+    void stopRecording()
+    {
+        if (!recorder)
+            return;
+        recorder->flush();
+        std::cout << "⏹️  Trace recording stopped (" << recorder->size() << " operations)" << std::endl;
+        recorder.reset();
+    }
+
     void run()
     {
         std::cout << "=== PlayWise Music Engine ===" << std::endl;
-        std::cout << "Welcome! Let's start by adding some sample songs...\n"
-                  << std::endl;
+        if (!state_path.empty() && std::ifstream(state_path).good() && engine.loadState(state_path))
+        {
+            std::cout << "💾 Restored " << engine.getSongDatabase().size() << " songs from " << state_path << "\n"
+                      << std::endl;
+        }
+        else
+        {
+            std::cout << "Welcome! Let's start by adding some sample songs...\n"
+                      << std::endl;
 
-        // Add some default songs to get started
-        loadSampleSongs();
+            // Add some default songs to get started
+            loadSampleSongs();
+        }
 
         int choice;
         do
@@ -1402,12 +9046,29 @@ public:
                 autoReplaySettingsMenu();
                 break;
             case 14:
+                trace(EngineTrace::SONGS_BY_GENRE);
                 engine.displaySongsByGenre();
                 break;
             case 15:
+                trace(EngineTrace::SNAPSHOT);
                 engine.displaySnapshot();
+                engine.displayMemoryFootprint();
+                break;
+            case 16:
+                traceRecordingMenu();
+                break;
+            case 17:
+                importCatalogMenu();
+                break;
+            case 18:
+                EngineMetrics::report(std::cout);
                 break;
             case 0:
+                stopRecording();
+                if (!state_path.empty() && engine.saveState(state_path))
+                {
+                    std::cout << "💾 State saved to " << state_path << std::endl;
+                }
                 std::cout << "Thank you for using PlayWise Music Engine!" << std::endl;
                 break;
             default:
@@ -1443,23 +9104,79 @@ private:
         std::cout << "13. Auto-Replay Settings" << std::endl;
         std::cout << "14. Songs by Genre" << std::endl;
         std::cout << "15. System Dashboard" << std::endl;
+        std::cout << "16. " << (recorder ? "Stop" : "Start") << " Trace Recording" << std::endl;
+        std::cout << "17. Import Catalog File" << std::endl;
+        std::cout << "18. Operation Latency Stats" << std::endl;
         std::cout << "0.  Exit" << std::endl;
         std::cout << "================================" << std::endl;
     }
 
+    void trace(EngineTrace::Op op, std::vector<std::string> text = {}, std::vector<int64_t> numbers = {})
+    {
+        if (recorder)
+            recorder->record(op, std::move(text), std::move(numbers));
+    }
+
+    Song *addSong(const std::string &id, const std::string &title, const std::string &artist,
+                  int duration, int rating, const std::string &genre)
+    {
+        trace(EngineTrace::ADD_SONG, {id, title, artist, genre}, {duration, rating});
+        return engine.addSong(id, title, artist, duration, rating, genre);
+    }
+
+    void traceRecordingMenu()
+    {
+        std::cout << "\n--- Trace Recording ---" << std::endl;
+        if (recorder)
+        {
+            stopRecording();
+            return;
+        }
+
+        std::string path;
+        std::cout << "Enter trace file (default playwise.trace): ";
+        std::getline(std::cin, path);
+        startRecording(path.empty() ? "playwise.trace" : path);
+    }
+
+    void importCatalogMenu()
+    {
+        std::string path;
+        std::cout << "\n--- Import Catalog File ---" << std::endl;
+        std::cout << "Enter CSV or JSON-lines file: ";
+        std::getline(std::cin, path);
+
+        size_t first_new = engine.getSongDatabase().size();
+        CatalogImporter importer(engine);
+        if (!importer.importFile(path))
+        {
+            std::cout << "❌ Cannot open catalog file: " << path << std::endl;
+            return;
+        }
+        importer.report(std::cout);
+
+        // Imported songs are traced as individual adds so the trace stays replayable
+        const auto &songs = engine.getSongDatabase();
+        for (size_t i = first_new; recorder && i < songs.size(); i++)
+        {
+            trace(EngineTrace::ADD_SONG, {songs[i]->id, songs[i]->title, songs[i]->artist, songs[i]->genre},
+                  {songs[i]->duration, songs[i]->rating});
+        }
+    }
+
     void loadSampleSongs()
     {
-        engine.addSong("001", "Bohemian Rhapsody", "Queen", 355, 5, "Rock");
-        engine.addSong("002", "Imagine", "John Lennon", 183, 5, "Pop");
-        engine.addSong("003", "Billie Jean", "Michael Jackson", 294, 4, "Pop");
-        engine.addSong("004", "Sweet Child O' Mine", "Guns N' Roses", 356, 4, "Rock");
-        engine.addSong("005", "Hotel California", "Eagles", 391, 5, "Rock");
+        addSong("001", "Bohemian Rhapsody", "Queen", 355, 5, "Rock");
+        addSong("002", "Imagine", "John Lennon", 183, 5, "Pop");
+        addSong("003", "Billie Jean", "Michael Jackson", 294, 4, "Pop");
+        addSong("004", "Sweet Child O' Mine", "Guns N' Roses", 356, 4, "Rock");
+        addSong("005", "Hotel California", "Eagles", 391, 5, "Rock");
 
         // Add some calming genre songs for auto-replay testing
-        engine.addSong("006", "Miles Runs the Voodoo Down", "Miles Davis", 420, 4, "Jazz");
-        engine.addSong("007", "Clair de Lune", "Claude Debussy", 300, 5, "Classical");
-        engine.addSong("008", "Lofi Hip Hop Beat", "ChillHop Cafe", 180, 3, "Lo-Fi");
-        engine.addSong("009", "Ambient Soundscape", "Brian Eno", 480, 4, "Ambient");
+        addSong("006", "Miles Runs the Voodoo Down", "Miles Davis", 420, 4, "Jazz");
+        addSong("007", "Clair de Lune", "Claude Debussy", 300, 5, "Classical");
+        addSong("008", "Lofi Hip Hop Beat", "ChillHop Cafe", 180, 3, "Lo-Fi");
+        addSong("009", "Ambient Soundscape", "Brian Eno", 480, 4, "Ambient");
 
         std::cout << "Sample songs loaded successfully (including calming genres for auto-replay)!\n"
                   << std::endl;
@@ -1508,24 +9225,29 @@ private:
             std::cout << "Invalid rating! Set to 0 (no rating)." << std::endl;
         }
 
-        Song *newSong = engine.addSong(id, title, artist, duration, rating, genre);
+        Song *newSong = addSong(id, title, artist, duration, rating, genre);
+        if (!newSong)
+            return;
         std::cout << "Song added successfully: " << newSong->toString() << std::endl;
 
-        if (newSong->isCalmingGenre())
+        std::string mood = engine.getReplayManager().getMoodName(newSong);
+        if (!mood.empty())
         {
-            std::cout << "🎵 This is a calming genre - perfect for auto-replay!" << std::endl;
+            std::cout << "🎵 This is a " << mood << " genre - it joins the " << mood << " auto-replay rotation!" << std::endl;
         }
     }
 
     void skipCurrentSongMenu()
     {
         std::cout << "\n--- Skip Current Song ---" << std::endl;
+        trace(EngineTrace::SKIP_SONG);
         engine.skipCurrentSong();
     }
 
     void autoPlayNextMenu()
     {
         std::cout << "\n--- Auto-Play Next Song ---" << std::endl;
+        trace(EngineTrace::AUTO_PLAY_NEXT);
         Song *next_song = engine.autoPlayNext();
         if (!next_song)
         {
@@ -1538,6 +9260,8 @@ private:
         std::cout << "\n--- Recently Skipped Songs Management ---" << std::endl;
         std::cout << "1. View Recently Skipped Songs" << std::endl;
         std::cout << "2. Clear Recently Skipped List" << std::endl;
+        std::cout << "3. Set Skip Window Size (Currently: "
+                  << engine.getSkippedTracker().capacity() << ")" << std::endl;
 
         int choice;
         std::cout << "Choose option: ";
@@ -1556,8 +9280,26 @@ private:
             engine.displayRecentlySkipped();
             break;
         case 2:
+            trace(EngineTrace::CLEAR_SKIPPED);
             engine.clearRecentlySkipped();
             break;
+        case 3:
+        {
+            int capacity;
+            std::cout << "Enter window size: ";
+            if (!(std::cin >> capacity) || capacity < 0)
+            {
+                std::cin.clear();
+                std::cin.ignore(10000, '\n');
+                std::cout << "Invalid input!" << std::endl;
+                return;
+            }
+            std::cin.ignore(10000, '\n');
+            trace(EngineTrace::SET_SKIP_WINDOW, {}, {capacity});
+            engine.getSkippedTracker().setCapacity(capacity);
+            std::cout << "✅ Skip window set to " << capacity << " songs" << std::endl;
+            break;
+        }
         default:
             std::cout << "Invalid choice!" << std::endl;
         }
@@ -1585,6 +9327,7 @@ private:
         switch (choice)
         {
         case 1:
+            trace(EngineTrace::TOGGLE_REPLAY);
             engine.toggleAutoReplay();
             break;
         case 2:
@@ -1592,6 +9335,7 @@ private:
             break;
         case 3:
         {
+            trace(EngineTrace::SETUP_REPLAY);
             auto songs = engine.getPlaylist().getAllSongs();
             std::vector<Song *> all_songs;
             for (auto *song : songs)
@@ -1631,6 +9375,7 @@ private:
         std::cout << "\nEnter Song ID to play: ";
         std::getline(std::cin, songId);
 
+        trace(EngineTrace::PLAY_SONG, {songId});
         engine.playSong(songId);
     }
 
@@ -1643,6 +9388,7 @@ private:
         }
         else
         {
+            trace(EngineTrace::UNDO_PLAY);
             engine.undoLastPlay();
         }
     }
@@ -1655,6 +9401,9 @@ private:
         std::cout << "3. Duration (Shortest first)" << std::endl;
         std::cout << "4. Duration (Longest first)" << std::endl;
         std::cout << "5. Recently Added" << std::endl;
+        std::cout << "6. Rating (Highest first)" << std::endl;
+        std::cout << "7. Most Played" << std::endl;
+        std::cout << "8. Artist (A-Z)" << std::endl;
 
         int sortChoice;
         std::cout << "Choose sorting criteria: ";
@@ -1685,6 +9434,15 @@ private:
         case 5:
             criteria = PlaylistSorter::RECENTLY_ADDED;
             break;
+        case 6:
+            criteria = PlaylistSorter::RATING_DESC;
+            break;
+        case 7:
+            criteria = PlaylistSorter::MOST_PLAYED;
+            break;
+        case 8:
+            criteria = PlaylistSorter::ARTIST_ASC;
+            break;
         default:
             std::cout << "Invalid choice!" << std::endl;
             return;
@@ -1696,6 +9454,16 @@ private:
         std::cin.ignore(10000, '\n');
 
         bool useQuickSort = (algorithmChoice == 'y' || algorithmChoice == 'Y');
+        if (!engine.getCatalog()->getSortedViews().hasView(criteria))
+        {
+            char viewChoice;
+            std::cout << "Keep this order as a sorted view for instant re-sorts? (y/n): ";
+            std::cin >> viewChoice;
+            std::cin.ignore(10000, '\n');
+            if ((viewChoice == 'y' || viewChoice == 'Y') && engine.materializeSortedView(criteria))
+                trace(EngineTrace::MATERIALIZE_VIEW, {}, {criteria});
+        }
+        trace(EngineTrace::SORT_PLAYLIST, {}, {criteria, useQuickSort});
         engine.sortPlaylist(criteria, useQuickSort);
 
         std::cout << "\nPlaylist sorted!" << std::endl;
@@ -1728,6 +9496,7 @@ private:
             std::cout << "Enter Song ID: ";
             std::getline(std::cin, id);
 
+            trace(EngineTrace::SEARCH_ID, {id});
             Song *song = engine.getLookup().lookup_by_id(id);
             if (song)
             {
@@ -1745,6 +9514,7 @@ private:
             std::cout << "Enter Song Title: ";
             std::getline(std::cin, title);
 
+            trace(EngineTrace::SEARCH_TITLE, {title});
             auto songs = engine.getLookup().lookup_by_title(title);
             if (songs.empty())
             {
@@ -1773,6 +9543,7 @@ private:
             }
             std::cin.ignore(10000, '\n');
 
+            trace(EngineTrace::SEARCH_RATING, {}, {rating});
             auto songs = engine.getRatingTree().search_by_rating(rating);
             if (songs.empty())
             {
@@ -1830,7 +9601,8 @@ private:
             return;
         }
 
-        engine.getRatingTree().insert_song(song, rating);
+        trace(EngineTrace::RATE_SONG, {songId}, {rating});
+        engine.rateSong(songId, rating);
         std::cout << "Rating updated for: " << song->toString() << std::endl;
     }
 
@@ -1840,6 +9612,7 @@ private:
         std::cout << "1. Move Song" << std::endl;
         std::cout << "2. Delete Song" << std::endl;
         std::cout << "3. Reverse Playlist" << std::endl;
+        std::cout << "4. Remove Song from Catalog" << std::endl;
 
         int choice;
         std::cout << "Choose operation: ";
@@ -1879,6 +9652,7 @@ private:
             }
             std::cin.ignore(10000, '\n');
 
+            trace(EngineTrace::MOVE_SONG, {}, {fromIndex, toIndex});
             if (engine.getPlaylist().move_song(fromIndex, toIndex))
             {
                 std::cout << "Song moved successfully!" << std::endl;
@@ -1907,6 +9681,7 @@ private:
             }
             std::cin.ignore(10000, '\n');
 
+            trace(EngineTrace::DELETE_SONG, {}, {index});
             if (engine.getPlaylist().delete_song(index))
             {
                 std::cout << "Song deleted successfully!" << std::endl;
@@ -1920,11 +9695,29 @@ private:
         }
         case 3:
         {
+            trace(EngineTrace::REVERSE_PLAYLIST);
             engine.getPlaylist().reverse_playlist();
             std::cout << "Playlist reversed!" << std::endl;
             engine.getPlaylist().display();
             break;
         }
+        case 4:
+        {
+            std::string song_id;
+            std::cout << "Enter Song ID to remove everywhere: ";
+            std::getline(std::cin, song_id);
+
+            trace(EngineTrace::REMOVE_SONG, {song_id});
+            if (engine.removeSong(song_id))
+            {
+                std::cout << "🗑️  Song " << song_id << " removed from the catalog, playlist, history and skips" << std::endl;
+            }
+            else
+            {
+                std::cout << "Failed to remove song! Check the ID." << std::endl;
+            }
+            break;
+        }
         default:
             std::cout << "Invalid choice!" << std::endl;
         }
@@ -2002,10 +9795,240 @@ void runDemo()
 
     // Display system snapshot
     engine.displaySnapshot();
+
+    // Listener sessions sharing the demo catalog
+    std::cout << "\n--- Multi-Session Demo ---" << std::endl;
+    std::vector<std::unique_ptr<PlayWiseEngine>> sessions;
+    for (int i = 0; i < 1000; i++)
+    {
+        sessions.emplace_back(new PlayWiseEngine(engine.getCatalog()));
+        for (Song *song : engine.getSongDatabase())
+        {
+            sessions.back()->queueSong(song->id);
+        }
+    }
+    std::cout << sessions.size() << " sessions share one catalog" << std::endl;
+    sessions.front()->displayMemoryFootprint();
 }
 
-int main()
+#ifndef PLAYWISE_NO_MAIN
+int main(int argc, char *argv[])
 {
+    // Profiling builds (make trace): --spans <file> anywhere on the command line
+    // writes the recorded spans as Chrome trace JSON when the program exits
+    struct SpanExport
+    {
+        std::string path;
+        ~SpanExport()
+        {
+            if (!path.empty())
+                SpanTracer::exportChromeTrace(path);
+        }
+    } span_export;
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (std::string(argv[i]) == "--spans")
+        {
+            span_export.path = argv[i + 1];
+            std::copy(argv + i + 2, argv + argc + 1, argv + i); // keeps the null terminator
+            argc -= 2;
+            if (!SpanTracer::ENABLED)
+                std::cerr << "⚠️  Built without PLAYWISE_TRACING; rebuild with 'make trace' to record spans" << std::endl;
+            break;
+        }
+    }
+
+    // Headless mode: playwise_engine --script <file|->
+    if (argc >= 2 && std::string(argv[1]) == "--script")
+    {
+        if (argc < 3)
+        {
+            std::cerr << "Usage: " << argv[0] << " --script <file|->" << std::endl;
+            return 1;
+        }
+
+        PlayWiseEngine engine;
+        CommandScriptRunner runner(engine);
+        std::string path = argv[2];
+        if (path == "-")
+        {
+            runner.run(std::cin);
+        }
+        else
+        {
+            std::ifstream script(path);
+            if (!script)
+            {
+                std::cerr << "❌ Cannot open script: " << path << std::endl;
+                return 1;
+            }
+            runner.run(script);
+        }
+        runner.report(std::cout);
+        EngineMetrics::report(std::cout);
+        return runner.getErrorCount() == 0 ? 0 : 2;
+    }
+
+    // Trace replay: playwise_engine --replay <trace> [--realtime]
+    if (argc >= 2 && std::string(argv[1]) == "--replay")
+    {
+        if (argc < 3)
+        {
+            std::cerr << "Usage: " << argv[0] << " --replay <trace> [--realtime]" << std::endl;
+            return 1;
+        }
+
+        std::ifstream trace(argv[2], std::ios::binary);
+        if (!trace)
+        {
+            std::cerr << "❌ Cannot open trace: " << argv[2] << std::endl;
+            return 1;
+        }
+
+        PlayWiseEngine engine;
+        TraceReplayer replayer(engine);
+        bool realtime = argc >= 4 && std::string(argv[3]) == "--realtime";
+        if (replayer.replay(trace, realtime) == 0 && replayer.wasTruncated())
+        {
+            std::cerr << "❌ Not a PlayWise trace: " << argv[2] << std::endl;
+            return 1;
+        }
+        replayer.report(std::cout);
+        return replayer.wasTruncated() ? 2 : 0;
+    }
+
+    // Bulk catalog import: playwise_engine --import <catalog.csv|catalog.jsonl> [state-file]
+    if (argc >= 2 && std::string(argv[1]) == "--import")
+    {
+        if (argc < 3)
+        {
+            std::cerr << "Usage: " << argv[0] << " --import <catalog> [state-file]" << std::endl;
+            return 1;
+        }
+
+        PlayWiseEngine engine;
+        CatalogImporter importer(engine);
+        if (!importer.importFile(argv[2]))
+        {
+            std::cerr << "❌ Cannot open catalog file: " << argv[2] << std::endl;
+            return 1;
+        }
+        importer.report(std::cout);
+        if (argc >= 4 && !engine.saveState(argv[3]))
+            return 1;
+        return importer.getRejectedCount() == 0 ? 0 : 2;
+    }
+
+    // Socket server: playwise_engine --serve <socket-path|tcp:port> [state-file]
+    if (argc >= 2 && std::string(argv[1]) == "--serve")
+    {
+        if (argc < 3)
+        {
+            std::cerr << "Usage: " << argv[0] << " --serve <socket-path|tcp:port> [state-file]" << std::endl;
+            return 1;
+        }
+
+        PlayWiseEngine engine;
+        if (argc >= 4 && std::ifstream(argv[3]).good() && !engine.loadState(argv[3]))
+            return 1;
+        EngineServer server(engine);
+        if (!server.listen(argv[2]))
+            return 1;
+
+        static EngineServer *serving = nullptr;
+        serving = &server;
+        std::signal(SIGINT, [](int)
+                    { serving->stop(); });
+        std::signal(SIGTERM, [](int)
+                    { serving->stop(); });
+        std::cout << "🎧 Serving on " << server.getEndpoint() << " (Ctrl+C to stop)" << std::endl;
+        server.run();
+        server.report(std::cout);
+        if (argc >= 4 && !engine.saveState(argv[3]))
+            return 1;
+        return 0;
+    }
+
+    // Load generator: playwise_engine --load <socket-path|tcp:port> [connections] [requests] [pipeline-depth]
+    if (argc >= 2 && std::string(argv[1]) == "--load")
+    {
+        if (argc < 3)
+        {
+            std::cerr << "Usage: " << argv[0] << " --load <socket-path|tcp:port> [connections] [requests] [pipeline-depth]" << std::endl;
+            return 1;
+        }
+
+        size_t connections = argc >= 4 ? std::strtoul(argv[3], nullptr, 10) : 100;
+        size_t requests = argc >= 5 ? std::strtoul(argv[4], nullptr, 10) : 100000;
+        size_t depth = argc >= 6 ? std::strtoul(argv[5], nullptr, 10) : 8;
+        const size_t songs = 1000;
+
+        // Seed the songs the workload plays unless an earlier run already did
+        LoadGenerator probe(argv[2], 1, 1);
+        bool reachable = probe.run({"get L" + std::to_string(songs - 1)}, 1);
+        if (reachable && probe.getFailed() > 0)
+        {
+            LoadGenerator seeder(argv[2], 1, 64);
+            reachable = seeder.run(LoadGenerator::seedCommands(songs), songs);
+        }
+        if (!reachable)
+        {
+            std::cerr << "❌ Cannot reach server at " << argv[2] << std::endl;
+            return 1;
+        }
+        LoadGenerator load(argv[2], connections, depth);
+        bool finished = load.run(LoadGenerator::mixedWorkload(songs), requests);
+        load.report(std::cout);
+        return finished && load.getFailed() == 0 ? 0 : 2;
+    }
+
+    // Memory accounting as JSON: playwise_engine --memory <state-file>
+    if (argc >= 2 && std::string(argv[1]) == "--memory")
+    {
+        if (argc < 3)
+        {
+            std::cerr << "Usage: " << argv[0] << " --memory <state-file>" << std::endl;
+            return 1;
+        }
+
+        PlayWiseEngine engine;
+        if (!engine.loadState(argv[2]))
+            return 1;
+        engine.memoryReport().writeJson(std::cout);
+        return 0;
+    }
+
+    // Interactive session persisted across runs: playwise_engine --state <file>
+    if (argc >= 2 && std::string(argv[1]) == "--state")
+    {
+        if (argc < 3)
+        {
+            std::cerr << "Usage: " << argv[0] << " --state <file>" << std::endl;
+            return 1;
+        }
+
+        InteractiveMenu menu;
+        menu.setStateFile(argv[2]);
+        menu.run();
+        return 0;
+    }
+
+    // Interactive session recorded to a trace: playwise_engine --record <trace>
+    if (argc >= 2 && std::string(argv[1]) == "--record")
+    {
+        if (argc < 3)
+        {
+            std::cerr << "Usage: " << argv[0] << " --record <trace>" << std::endl;
+            return 1;
+        }
+
+        InteractiveMenu menu;
+        if (!menu.startRecording(argv[2]))
+            return 1;
+        menu.run();
+        return 0;
+    }
+
     std::cout << "=== Welcome to PlayWise Music Engine ===" << std::endl;
     std::cout << "Choose mode:" << std::endl;
     std::cout << "1. Interactive Mode (Recommended)" << std::endl;
@@ -2044,4 +10067,5 @@ int main()
     }
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
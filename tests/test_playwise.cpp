@@ -5,8 +5,11 @@
 #include <string>
 #include <memory>
 #include<bits/stdc++.h>
+#include <poll.h>
 // Include the main PlayWise engine
 // Note: In a real project, this would be split into header files
+#define PLAYWISE_NO_MAIN
+#include "../src/playwise_engine.cpp"
 
 
 /**
@@ -51,6 +54,34 @@ int TestFramework::total_tests = 0;
 int TestFramework::passed_tests = 0;
 std::string TestFramework::current_suite = "";
 
+/**
+ * Captures std::cout while active so engine console messages stay out of
+ * the test report; the destructor always restores the original stream
+ */
+class ConsoleCapture {
+private:
+    std::ostringstream captured;
+    std::streambuf* saved;
+
+public:
+    ConsoleCapture() : saved(nullptr) { start(); }
+    ~ConsoleCapture() { stop(); }
+    ConsoleCapture(const ConsoleCapture&) = delete;
+    ConsoleCapture& operator=(const ConsoleCapture&) = delete;
+
+    void start() {
+        if (!saved) saved = std::cout.rdbuf(captured.rdbuf());
+    }
+
+    void stop() {
+        if (saved) std::cout.rdbuf(saved);
+        saved = nullptr;
+    }
+
+    std::string text() const { return captured.str(); }
+    void clear() { captured.str(""); }
+};
+
 /**
  * Mock Song class for testing (simplified version)
  */
@@ -337,6 +368,1716 @@ void test_sorting_algorithms() {
     }
 }
 
+void test_radix_sort() {
+    TestFramework::begin_suite("Radix Sort (Integer Keys)");
+    
+    std::vector<std::unique_ptr<Song>> owned;
+    std::vector<Song*> songs;
+    for (int i = 0; i < 1000; i++) {
+        owned.push_back(std::make_unique<Song>(
+            "ID" + std::to_string(i), "Title" + std::to_string(i), "Artist",
+            rand() % 600, 1 + rand() % 5));
+        owned.back()->added_time += std::chrono::seconds(rand() % 100);
+        songs.push_back(owned.back().get());
+    }
+    
+    TestFramework::test("Duration uses radix path", PlaylistSorter::hasIntegerKey(PlaylistSorter::DURATION_ASC));
+    TestFramework::test("Title uses comparison path", !PlaylistSorter::hasIntegerKey(PlaylistSorter::TITLE_ASC));
+    
+    const PlaylistSorter::SortCriteria criteria[] = {
+        PlaylistSorter::DURATION_ASC, PlaylistSorter::DURATION_DESC,
+        PlaylistSorter::RECENTLY_ADDED, PlaylistSorter::RATING_DESC
+    };
+    const char* names[] = {"duration asc", "duration desc", "recently added", "rating desc"};
+    auto key_less = [](PlaylistSorter::SortCriteria c) {
+        return [c](Song* a, Song* b) {
+            switch (c) {
+                case PlaylistSorter::DURATION_ASC: return a->duration < b->duration;
+                case PlaylistSorter::DURATION_DESC: return a->duration > b->duration;
+                case PlaylistSorter::RECENTLY_ADDED: return a->added_time > b->added_time;
+                default: return a->rating > b->rating;
+            }
+        };
+    };
+    
+    for (int c = 0; c < 4; c++) {
+        std::vector<Song*> expected = songs;
+        std::vector<Song*> actual = songs;
+        std::stable_sort(expected.begin(), expected.end(), key_less(criteria[c]));
+        PlaylistSorter::radixSort(actual, criteria[c]);
+        TestFramework::test(std::string("Radix matches std::stable_sort - ") + names[c], expected == actual);
+    }
+    
+    // Negative durations must still order correctly after sign-bit flip
+    Song negative("N1", "Neg", "Artist", -5);
+    Song positive("P1", "Pos", "Artist", 5);
+    std::vector<Song*> mixed = {&positive, &negative};
+    PlaylistSorter::radixSort(mixed, PlaylistSorter::DURATION_ASC);
+    TestFramework::test("Radix handles negative keys", mixed[0] == &negative);
+}
+
+/**
+ * Build titles for a given input pattern so comparison sorts can be stressed
+ */
+std::vector<std::string> make_sort_pattern(const std::string& pattern, int n) {
+    std::vector<int> keys(n);
+    for (int i = 0; i < n; i++) {
+        if (pattern == "random") keys[i] = rand() % n;
+        else if (pattern == "sorted") keys[i] = i;
+        else if (pattern == "reversed") keys[i] = n - i;
+        else if (pattern == "organ pipe") keys[i] = i < n / 2 ? i : n - i;
+        else if (pattern == "all equal") keys[i] = 7;
+        else if (pattern == "few unique") keys[i] = rand() % 4;
+        else keys[i] = i; // nearly sorted, perturbed below
+    }
+    if (pattern == "nearly sorted") {
+        for (int i = 0; i < n / 100; i++) {
+            std::swap(keys[rand() % n], keys[rand() % n]);
+        }
+    }
+    
+    std::vector<std::string> titles;
+    for (int key : keys) {
+        std::string digits = std::to_string(key);
+        titles.push_back(std::string(8 - digits.size(), '0') + digits);
+    }
+    return titles;
+}
+
+void test_adaptive_sorting() {
+    TestFramework::begin_suite("Adaptive Sort and Introsort");
+    
+    const std::vector<std::string> patterns = {
+        "random", "sorted", "reversed", "nearly sorted", "organ pipe", "all equal", "few unique"
+    };
+    auto title_less = [](Song* a, Song* b) { return a->title < b->title; };
+    
+    for (const auto& pattern : patterns) {
+        std::vector<std::unique_ptr<Song>> owned;
+        std::vector<Song*> songs;
+        for (const auto& title : make_sort_pattern(pattern, 5000)) {
+            owned.push_back(std::make_unique<Song>("ID" + std::to_string(owned.size()), title, "Artist", 180));
+            songs.push_back(owned.back().get());
+        }
+        
+        std::vector<Song*> expected = songs;
+        std::stable_sort(expected.begin(), expected.end(), title_less);
+        
+        std::vector<Song*> adaptive = songs;
+        PlaylistSorter::adaptiveSort(adaptive, PlaylistSorter::TITLE_ASC);
+        TestFramework::test("Adaptive sort is stable - " + pattern, adaptive == expected);
+        
+        std::vector<Song*> quick = songs;
+        PlaylistSorter::quickSort(quick, PlaylistSorter::TITLE_ASC);
+        TestFramework::test("Introsort orders correctly - " + pattern,
+                            std::is_sorted(quick.begin(), quick.end(), title_less));
+    }
+    
+    // Sorted input used to drive the old last-element pivot to O(n) depth
+    std::vector<std::unique_ptr<Song>> owned;
+    std::vector<Song*> sorted_songs;
+    for (const auto& title : make_sort_pattern("organ pipe", 200000)) {
+        owned.push_back(std::make_unique<Song>("ID", title, "Artist", 180));
+        sorted_songs.push_back(owned.back().get());
+    }
+    double quick_time = PerformanceTest::measureTime([&]() {
+        PlaylistSorter::quickSort(sorted_songs, PlaylistSorter::TITLE_ASC);
+    }, "Introsort 200000 organ-pipe songs");
+    TestFramework::test("Introsort handles adversarial input", quick_time < 1000.0);
+}
+
+void test_top_k_selection() {
+    TestFramework::begin_suite("Top-K Selection");
+    
+    std::vector<std::unique_ptr<Song>> owned;
+    std::vector<Song*> songs;
+    for (int i = 0; i < 2000; i++) {
+        owned.push_back(std::make_unique<Song>("ID" + std::to_string(i), "Title", "Artist", (i * 7919) % 2000));
+        songs.push_back(owned.back().get());
+    }
+    
+    auto top = PlaylistSorter::topK(songs, 5, PlaylistSorter::DURATION_DESC);
+    TestFramework::test("Top-k returns k songs", top.size() == 5);
+    TestFramework::test("Top-k best first", top[0]->duration == 1999 && top[4]->duration == 1995);
+    TestFramework::test("Top-k with k > n", PlaylistSorter::topK(songs, 5000, PlaylistSorter::DURATION_ASC).size() == 2000);
+    TestFramework::test("Top-k with k = 0", PlaylistSorter::topK(songs, 0, PlaylistSorter::DURATION_ASC).empty());
+    
+    std::vector<Song*> maintained;
+    for (Song* song : songs) {
+        PlaylistSorter::insertTopK(maintained, song, 5, PlaylistSorter::DURATION_DESC);
+    }
+    TestFramework::test("Incremental top-k matches heap top-k", maintained == top);
+    
+    PlayWiseEngine engine;
+    for (int i = 0; i < 50; i++) {
+        engine.addSong("E" + std::to_string(i), "Title", "Artist", (i * 37) % 50 + 100);
+    }
+    auto snapshot = engine.export_snapshot();
+    auto expected = PlaylistSorter::topK(engine.getSongDatabase(), 5, PlaylistSorter::DURATION_DESC);
+    TestFramework::test("Snapshot top longest maintained on addSong", snapshot.top_longest_songs == expected);
+}
+
+void test_sorted_views() {
+    TestFramework::begin_suite("Materialized Sorted Views");
+    
+    PlayWiseEngine engine;
+    for (int i = 0; i < 200; i++) {
+        engine.addSong("V" + std::to_string(i), "Title" + std::to_string((i * 31) % 200), "Artist",
+                       100 + (i * 17) % 300, 1 + i % 5);
+    }
+    
+    engine.materializeSortedView(PlaylistSorter::TITLE_ASC);
+    engine.materializeSortedView(PlaylistSorter::DURATION_DESC);
+    engine.materializeSortedView(PlaylistSorter::RATING_DESC);
+    engine.materializeSortedView(PlaylistSorter::MOST_PLAYED);
+    TestFramework::test("Descending criteria share ascending view", engine.getSortedViews().viewCount() == 4);
+    TestFramework::test("Reverse criteria served by existing view", engine.getSortedViews().hasView(PlaylistSorter::TITLE_DESC));
+    
+    // Mutations after the views exist
+    for (int i = 200; i < 260; i++) {
+        engine.addSong("V" + std::to_string(i), "Late" + std::to_string(i), "Artist", 50 + i, 3);
+    }
+    ConsoleCapture console;
+    for (int i = 0; i < 40; i++) {
+        engine.playSong("V" + std::to_string(i % 7));
+        engine.rateSong("V" + std::to_string(i * 3), 1 + (i * 7) % 5);
+    }
+    engine.undoLastPlay(); // queues a duplicate entry
+    
+    const PlaylistSorter::SortCriteria criteria[] = {
+        PlaylistSorter::TITLE_ASC, PlaylistSorter::TITLE_DESC, PlaylistSorter::DURATION_DESC,
+        PlaylistSorter::RATING_DESC, PlaylistSorter::MOST_PLAYED
+    };
+    bool all_sorted = true;
+    bool all_kept = true;
+    for (auto c : criteria) {
+        auto before = engine.getPlaylist().getAllSongs();
+        engine.sortPlaylist(c);
+        auto after = engine.getPlaylist().getAllSongs();
+        all_sorted = all_sorted && std::is_sorted(after.begin(), after.end(),
+            [c](Song* a, Song* b) { return PlaylistSorter::compare(a, b, c); });
+        std::sort(before.begin(), before.end());
+        std::sort(after.begin(), after.end());
+        all_kept = all_kept && before == after;
+    }
+    console.stop();
+    
+    TestFramework::test("Views stay ordered after add, play and re-rate", all_sorted);
+    TestFramework::test("View relink keeps exactly the playlist entries", all_kept);
+    TestFramework::test("Re-rating moves song between buckets",
+                        engine.getRatingTree().getSongCountByRating()[1] +
+                        engine.getRatingTree().getSongCountByRating()[2] +
+                        engine.getRatingTree().getSongCountByRating()[3] +
+                        engine.getRatingTree().getSongCountByRating()[4] +
+                        engine.getRatingTree().getSongCountByRating()[5] == 260);
+
+    // Views created through the script command; equal keys keep add order in reverse walks
+    PlayWiseEngine scripted;
+    console.start();
+    for (int i = 0; i < 12; i++) {
+        scripted.addSong("T" + std::to_string(i), "Tie" + std::to_string(i), "Artist", 100 + (i % 3) * 10);
+    }
+    console.stop();
+    auto expected = scripted.getPlaylist().getAllSongs();
+    PlaylistSorter::sort(expected, PlaylistSorter::DURATION_DESC);
+    CommandScriptRunner runner(scripted);
+    std::istringstream script("view duration_desc\nsort duration_desc\nview sideways\n");
+    runner.run(script);
+    TestFramework::test("Script view command materializes a view",
+                        scripted.getSortedViews().hasView(PlaylistSorter::DURATION_ASC) &&
+                        runner.getErrorCount() == 1 && runner.commandCount("view") == 1);
+    TestFramework::test("Reverse view walk matches stable sort on ties",
+                        scripted.getPlaylist().getAllSongs() == expected);
+}
+
+void test_collation_keys() {
+    TestFramework::begin_suite("Collation Keys");
+    
+    auto key = [](const std::string& text) { return CollationKey::build(text); };
+    TestFramework::test("Case folded", key("Imagine").compare(key("imagine")) == 0);
+    TestFramework::test("Leading article stripped", key("The Beatles").compare(key("Beatles")) == 0);
+    TestFramework::test("Article kept when it is the whole key", key("The").folded == "the");
+    TestFramework::test("Article stripping optional", CollationKey::build("The Beatles", false).folded == "the beatles");
+    TestFramework::test("Accents folded", key("Beyonc\xC3\xA9").folded == "beyonce");
+    TestFramework::test("Prefix packs first 8 bytes", key("abcdefghij").prefix == 0x6162636465666768ULL);
+    TestFramework::test("Short key orders before its extension", key("abc").compare(key("abcd")) < 0);
+    TestFramework::test("Ties beyond prefix use full key", key("abcdefghij").compare(key("abcdefghik")) < 0);
+    
+    Song lower("C1", "abba gold", "x", 100);
+    Song upper("C2", "Abba Gold", "x", 100);
+    Song zebra("C3", "Zebra", "The Artist", 100);
+    Song beatles("C4", "Yesterday", "The Beatles", 100);
+    Song bach("C5", "Air", "Bach", 100);
+    std::vector<Song*> songs = {&zebra, &lower, &upper};
+    PlaylistSorter::sort(songs, PlaylistSorter::TITLE_ASC);
+    TestFramework::test("Title sort ignores case", songs[2] == &zebra);
+    TestFramework::test("Case-only difference still ordered deterministically",
+                        PlaylistSorter::compare(&upper, &lower, PlaylistSorter::TITLE_ASC));
+    
+    std::vector<Song*> artists = {&beatles, &zebra, &bach};
+    PlaylistSorter::sort(artists, PlaylistSorter::ARTIST_ASC);
+    TestFramework::test("Artist sort strips article", artists[0] == &zebra && artists[1] == &bach && artists[2] == &beatles);
+}
+
+void test_recently_skipped_lru() {
+    TestFramework::begin_suite("Recently Skipped Tracker (LRU)");
+    
+    RecentlySkippedTracker tracker(3);
+    tracker.addSkippedSong("A");
+    tracker.addSkippedSong("B");
+    tracker.addSkippedSong("C");
+    TestFramework::test("Tracker fills to capacity", tracker.size() == 3 && tracker.capacity() == 3);
+    
+    tracker.addSkippedSong("A"); // refresh, now most recent
+    TestFramework::test("Refresh moves song to front", tracker.getRecentlySkipped()[0] == "A");
+    TestFramework::test("Refresh does not grow window", tracker.size() == 3);
+    
+    tracker.addSkippedSong("D"); // evicts B, the least recently skipped
+    TestFramework::test("Oldest skip evicted", !tracker.wasRecentlySkipped("B") && tracker.wasRecentlySkipped("D"));
+    
+    TestFramework::test("Remove single song", tracker.removeSkippedSong("C") && !tracker.wasRecentlySkipped("C"));
+    
+    tracker.setCapacity(1);
+    TestFramework::test("Shrinking keeps most recent", tracker.size() == 1 && tracker.wasRecentlySkipped("D"));
+    
+    tracker.clear();
+    TestFramework::test("Clear empties tracker", tracker.empty() && !tracker.wasRecentlySkipped("D"));
+    
+    const int WINDOW = 20000;
+    RecentlySkippedTracker large(WINDOW);
+    std::vector<std::string> ids;
+    for (int i = 0; i < 2 * WINDOW; i++) {
+        ids.push_back("S" + std::to_string(i));
+    }
+    double large_time = PerformanceTest::measureTime([&]() {
+        for (const auto& id : ids) {
+            large.addSkippedSong(id);
+        }
+        int hits = 0;
+        for (const auto& id : ids) {
+            hits += large.wasRecentlySkipped(id);
+        }
+        TestFramework::test("Large window keeps last k", hits == WINDOW);
+    }, "Skip tracker 40000 adds + checks (window 20000)");
+    TestFramework::test("Large window operations are constant time", large_time < 200.0);
+}
+
+void test_skip_scores() {
+    TestFramework::begin_suite("Time-Decayed Skip Scores");
+    
+    auto near = [](float a, float b) { return std::fabs(a - b) < 1e-3f; };
+    
+    SkipScoreTable table(60.0); // one minute half-life
+    table.recordSkip(3, 0.0);
+    TestFramework::test("Fresh skip scores 1", near(table.score(3, 0.0), 1.0f));
+    TestFramework::test("Score halves after one half-life", near(table.score(3, 60.0), 0.5f));
+    TestFramework::test("Unknown handle scores 0", table.score(99, 0.0) == 0.0f);
+    
+    table.recordSkip(3, 60.0);
+    TestFramework::test("Skips accumulate with decay", near(table.score(3, 60.0), 1.5f));
+    
+    // Far beyond the rebase point the scale factor must stay finite
+    table.recordSkip(5, 60.0 * 200);
+    TestFramework::test("Rebase keeps new scores exact", near(table.score(5, 60.0 * 200), 1.0f));
+    TestFramework::test("Rebase decays old scores", table.score(3, 60.0 * 200) < 1e-6f);
+    
+    table.reset(5);
+    TestFramework::test("Reset clears one handle", table.score(5, 60.0 * 200) == 0.0f);
+    
+    SkipScoreTable large;
+    large.recordSkip(999999, 0.0);
+    TestFramework::test("One float per handle", large.memoryBytes() <= 1000000 * sizeof(float) * 2);
+    
+    PlayWiseEngine engine;
+    ConsoleCapture console;
+    engine.addSong("K1", "First", "Artist", 100);
+    engine.addSong("K2", "Second", "Artist", 100);
+    engine.playSong("K1");
+    engine.skipCurrentSong();
+    Song* next = engine.autoPlayNext();
+    engine.skipCurrentSong();
+    engine.playSong("K2");
+    engine.skipCurrentSong();
+    engine.playSong("K2");
+    engine.skipCurrentSong();
+    Song* least = engine.autoPlayNext();
+    console.stop();
+    
+    TestFramework::test("Auto-play avoids skipped song", next && next->id == "K2");
+    TestFramework::test("All skipped falls back to least skipped", least && least->id == "K1");
+    TestFramework::test("Engine exposes decayed score", engine.getSkipScore("K2") > 1.9f);
+}
+
+/**
+ * Zipf-like play stream: song i is drawn with weight 1 / (i + 1)
+ */
+std::vector<int> make_zipf_stream(int songs, int plays) {
+    std::vector<double> cumulative(songs);
+    double sum = 0;
+    for (int i = 0; i < songs; i++) {
+        sum += 1.0 / (i + 1);
+        cumulative[i] = sum;
+    }
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> dist(0.0, sum);
+    std::vector<int> stream(plays);
+    for (int& song : stream) {
+        song = std::lower_bound(cumulative.begin(), cumulative.end(), dist(rng)) - cumulative.begin();
+    }
+    return stream;
+}
+
+void test_probabilistic_sketches() {
+    TestFramework::begin_suite("Probabilistic Sketches");
+    
+    const int SONGS = 5000, PLAYS = 100000;
+    auto stream = make_zipf_stream(SONGS, PLAYS);
+    std::unordered_map<std::string, int> exact;
+    CountMinSketch sketch(0.001, 0.01);
+    SpaceSavingCounter hitters(50);
+    for (int song : stream) {
+        std::string id = "S" + std::to_string(song);
+        exact[id]++;
+        sketch.add(id);
+        hitters.add(id);
+    }
+    
+    bool never_under = true;
+    int within_bound = 0;
+    for (const auto& pair : exact) {
+        uint32_t estimate = sketch.estimate(pair.first);
+        never_under = never_under && estimate >= (uint32_t)pair.second;
+        within_bound += estimate - pair.second <= 0.001 * PLAYS;
+    }
+    TestFramework::test("Count-min never undercounts", never_under);
+    TestFramework::test("Count-min error within epsilon * N", within_bound >= 0.99 * exact.size());
+    
+    auto top = hitters.top(10);
+    TestFramework::test("Space-Saving finds the heaviest hitter", !top.empty() && top[0].key == "S0");
+    TestFramework::test("Space-Saving bounds are consistent",
+                        top[0].count >= (uint64_t)exact["S0"] && top[0].count - top[0].error <= (uint64_t)exact["S0"]);
+    
+    CountingBloomFilter bloom(1000, 0.01);
+    for (int i = 0; i < 1000; i++) bloom.add("B" + std::to_string(i));
+    bool no_false_negatives = true;
+    for (int i = 0; i < 1000; i++) no_false_negatives = no_false_negatives && bloom.mayContain("B" + std::to_string(i));
+    int false_positives = 0;
+    for (int i = 1000; i < 11000; i++) false_positives += bloom.mayContain("B" + std::to_string(i));
+    TestFramework::test("Bloom filter has no false negatives", no_false_negatives);
+    TestFramework::test("Bloom false positive rate near target", false_positives < 10000 * 0.03);
+    bloom.remove("B1");
+    bool others_kept = true;
+    for (int i = 2; i < 1000; i++) others_kept = others_kept && bloom.mayContain("B" + std::to_string(i));
+    TestFramework::test("Counting Bloom removal keeps other items", others_kept);
+    
+    RecentlySkippedTracker tracker(100);
+    tracker.enableApproximate(0.01);
+    for (int i = 0; i < 100; i++) tracker.addSkippedSong("T" + std::to_string(i));
+    bool recent_kept = true;
+    for (int i = 0; i < 100; i++) recent_kept = recent_kept && tracker.wasRecentlySkipped("T" + std::to_string(i));
+    for (int i = 100; i < 400; i++) tracker.addSkippedSong("T" + std::to_string(i));
+    TestFramework::test("Approximate window remembers recent skips", recent_kept && tracker.wasRecentlySkipped("T399"));
+    TestFramework::test("Approximate window forgets old generations", !tracker.wasRecentlySkipped("T0"));
+
+    RecentlySkippedTracker lossy(2000);
+    lossy.enableApproximate(0.3);
+    for (int i = 0; i < 2000; i++) lossy.addSkippedSong("S" + std::to_string(i));
+    bool removal_refused = true;
+    for (int i = 0; i < 30; i++) removal_refused = removal_refused && !lossy.removeSkippedSong("N" + std::to_string(i));
+    bool skips_kept = true;
+    for (int i = 0; i < 2000; i++) skips_kept = skips_kept && lossy.wasRecentlySkipped("S" + std::to_string(i));
+    TestFramework::test("Approximate removal never erases other skips", removal_refused && skips_kept);
+
+    AutoReplayManager manager;
+    Song calm("R1", "Calm", "Artist", 100, 0, "Jazz");
+    manager.recordPlay(&calm);
+    manager.enableApproximateCounting();
+    manager.recordPlay(&calm);
+    TestFramework::test("Approximate counting keeps earlier exact counts", manager.getPlayCount("R1") >= 2);
+    TestFramework::test("Heavy hitters feed play count stats", manager.getPlayCountStats()["R1"] >= 2);
+}
+
+void test_incremental_calming_top_k() {
+    TestFramework::begin_suite("Incremental Top Calming Songs");
+    
+    std::vector<std::unique_ptr<Song>> owned;
+    std::vector<Song*> songs;
+    const char* genres[] = {"Jazz", "Rock", "Classical", "Pop", "Lo-Fi", "Ambient"};
+    for (int i = 0; i < 60; i++) {
+        owned.push_back(std::make_unique<Song>("M" + std::to_string(i), "Title", "Artist", 100, 0, genres[i % 6]));
+        owned.back()->added_time += std::chrono::seconds(i);
+        songs.push_back(owned.back().get());
+    }
+    
+    AutoReplayManager manager;
+    std::mt19937 rng(7);
+    bool always_matches = true;
+    for (int play = 0; play < 2000; play++) {
+        manager.recordPlay(songs[rng() % songs.size()]);
+        if (play % 97 == 0) {
+            always_matches = always_matches && manager.getTopCalming() == manager.getTopCalmingSongs(songs, 3);
+        }
+    }
+    TestFramework::test("Maintained top-k matches full scan", always_matches &&
+                        manager.getTopCalming() == manager.getTopCalmingSongs(songs, 3));
+    
+    auto top = manager.getTopCalming();
+    bool all_calming = !top.empty();
+    for (Song* song : top) all_calming = all_calming && song->isCalmingGenre();
+    TestFramework::test("Top-k only holds calming songs", all_calming && top.size() == 3);
+    
+    AutoReplayManager fresh;
+    Song jazz("J1", "Jazz", "Artist", 100, 0, "Jazz");
+    Song rock("K1", "Rock", "Artist", 100, 0, "Rock");
+    fresh.recordPlay(&jazz);
+    std::vector<Song*> catalog = {&jazz, &rock};
+    ConsoleCapture console;
+    fresh.setupAutoReplay();
+    fresh.getTopCalmingSongs(catalog, 3);
+    console.stop();
+    TestFramework::test("Replay setup uses maintained top-k", fresh.getNextReplaySong() == &jazz);
+    TestFramework::test("No zero play-count entries created", fresh.getPlayCountStats().size() == 1);
+}
+
+void test_concurrent_play_counting() {
+    TestFramework::begin_suite("Concurrent Play Counting");
+    
+    std::vector<std::unique_ptr<Song>> owned;
+    const char* genres[] = {"Jazz", "Rock", "Classical", "Pop"};
+    for (int i = 0; i < 50; i++) {
+        owned.push_back(std::make_unique<Song>("C" + std::to_string(i), "Title", "Artist", 100, 0, genres[i % 4]));
+        owned.back()->handle = i;
+    }
+    
+    AutoReplayManager manager;
+    manager.enableConcurrentCounting(1024);
+    const int threads = 8;
+    const int plays_per_thread = 100000;
+    std::atomic<bool> done(false);
+    
+    // A reader keeps merging while writers are still counting
+    std::thread reader([&]() {
+        while (!done.load()) manager.flushPendingPlays();
+    });
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; t++) {
+        writers.emplace_back([&, t]() {
+            for (int i = 0; i < plays_per_thread; i++) {
+                manager.recordPlay(owned[(i + t) % owned.size()].get());
+            }
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    done = true;
+    reader.join();
+    
+    auto stats = manager.getPlayCountStats();
+    long long total = 0;
+    bool song_counts_match = true;
+    for (const auto& song : owned) {
+        total += stats[song->id];
+        song_counts_match = song_counts_match && song->play_count == stats[song->id];
+    }
+    TestFramework::test("No plays lost across threads", total == (long long)threads * plays_per_thread);
+    TestFramework::test("Song play counts match merged totals", song_counts_match);
+    TestFramework::test("Each song counted exactly", stats["C0"] == threads * plays_per_thread / 50);
+    
+    std::vector<Song*> songs;
+    for (const auto& song : owned) songs.push_back(song.get());
+    TestFramework::test("Calming top-k stays consistent after merge",
+                        manager.getTopCalming() == manager.getTopCalmingSongs(songs, 3));
+    
+    ConsoleCapture console;
+    PlayWiseEngine engine;
+    engine.addSong("P1", "One", "Artist", 100);
+    engine.addSong("P2", "Two", "Artist", 100);
+    engine.materializeSortedView(PlaylistSorter::MOST_PLAYED);
+    engine.getReplayManager().enableConcurrentCounting();
+    engine.playSong("P2");
+    engine.playSong("P2");
+    engine.playSong("P1");
+    engine.sortPlaylist(PlaylistSorter::MOST_PLAYED);
+    console.stop();
+    auto ordered = engine.getPlaylist().getAllSongs();
+    TestFramework::test("Merged counts keep MOST_PLAYED view ordered",
+                        ordered.size() == 2 && ordered[0]->id == "P2" && ordered[0]->play_count == 2);
+}
+
+void test_mood_replay() {
+    TestFramework::begin_suite("Per-Mood Replay");
+    
+    Song a("A", "A", "Artist", 100), b("B", "B", "Artist", 100), c("C", "C", "Artist", 100);
+    ReplayRing ring(3);
+    ring.assign({&a, &b, &c});
+    bool cycles = ring.next() == &a && ring.next() == &b && ring.next() == &c && ring.next() == &a;
+    TestFramework::test("Replay ring cycles in place", cycles && ring.size() == 3);
+    ring.assign({&a, &b, &c, &a});
+    TestFramework::test("Replay ring keeps its fixed capacity", ring.size() == 3);
+    
+    MoodWindow window(4);
+    window.addMood();
+    window.addMood();
+    window.push(0);
+    window.push(0);
+    window.push(1);
+    TestFramework::test("Dominant mood follows rolling counts", window.getDominant() == 0);
+    window.push(1);
+    window.push(1); // evicts the first mood-0 play
+    TestFramework::test("Evicted plays leave the window", window.getDominant() == 1 && window.getCount(0) == 1);
+    window.popNewest();
+    window.popNewest();
+    TestFramework::test("Undo retracts the newest plays", window.getCount(1) == 1 && window.size() == 2);
+    
+    ConsoleCapture console;
+    PlayWiseEngine engine;
+    engine.addSong("J1", "Blue", "Artist", 200, 0, "Jazz");
+    engine.addSong("R1", "Loud", "Artist", 200, 0, "Rock");
+    engine.addSong("R2", "Louder", "Artist", 200, 0, "Pop");
+    engine.playSong("J1");
+    engine.playSong("R1");
+    engine.playSong("R2");
+    engine.playSong("R1");
+    auto& manager = engine.getReplayManager();
+    std::string dominant = manager.getDominantMood();
+    manager.setupAutoReplay();
+    Song* first = manager.getNextReplaySong();
+    Song* second = manager.getNextReplaySong();
+    Song* third = manager.getNextReplaySong();
+    console.stop();
+    TestFramework::test("Listening mood inferred from history", dominant == "energetic");
+    TestFramework::test("Replay uses the dominant mood's rotation",
+                        manager.getReplayMood() == "energetic" && first && first->id == "R1" &&
+                        second && second->id == "R2" && third == first);
+    console.start();
+    while (engine.getPlaylist().getSize() > 0) engine.getPlaylist().delete_song(0);
+    console.clear();
+    engine.checkAndHandlePlaylistEnd();
+    std::string replay_output = console.text();
+    console.stop();
+    TestFramework::test("Playlist end announces the replayed mood",
+                        replay_output.find("Auto-replaying energetic song") != std::string::npos);
+
+    AutoReplayManager custom;
+    int workout = custom.defineMood("workout", {"Rock"});
+    Song rock("K1", "Rock", "Artist", 100, 0, "ROCK");
+    Song jazz("J2", "Jazz", "Artist", 100, 0, "Jazz");
+    TestFramework::test("Custom moods claim their genres",
+                        custom.moodOf(&rock) == workout && custom.getMoodName(&rock) == "workout");
+    custom.recordPlay(&rock);
+    custom.recordPlay(&jazz);
+    TestFramework::test("Each mood keeps its own top songs",
+                        custom.getTopSongsForMood("workout").size() == 1 &&
+                        custom.getTopSongsForMood("energetic").empty() &&
+                        custom.getTopCalming().size() == 1);
+    console.start();
+    custom.setupAutoReplay();
+    console.stop();
+    TestFramework::test("No listening history falls back to calming",
+                        custom.getReplayMood() == "calming" && custom.getNextReplaySong() == &jazz);
+}
+
+void test_concurrent_engine() {
+    TestFramework::begin_suite("Concurrent Engine");
+    
+    ConsoleCapture console;
+    
+    ConcurrentPlayWiseEngine engine;
+    const int songs = 3000;
+    std::atomic<int> published(0);
+    std::atomic<bool> done(false);
+    std::atomic<int> missing(0), wrong(0), torn_snapshots(0), started(0);
+    std::atomic<long long> reads(0);
+    
+    std::thread writer([&]() {
+        std::mt19937 rng(1);
+        for (int i = 0; i < songs; i++) {
+            engine.addSong("S" + std::to_string(i), "Title" + std::to_string(i % 50), "Artist", 100 + i % 300, 1 + i % 5);
+            published.store(i + 1);
+            while (i == 0 && started.load() < 4) std::this_thread::yield(); // Adds alone finish before readers start
+            if (i % 10 == 9) engine.playSong("S" + std::to_string(rng() % (i + 1)));
+            if (i % 500 == 499) engine.sortPlaylist(PlaylistSorter::DURATION_ASC);
+        }
+        done = true;
+    });
+    
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&, t]() {
+            std::mt19937 rng(100 + t);
+            long long local = 0;
+            while (!done.load()) {
+                int n = published.load();
+                if (n == 0) continue;
+                int i = rng() % n;
+                std::string title = "Title" + std::to_string(i % 50);
+                Song* song = engine.lookupById("S" + std::to_string(i));
+                if (!song) missing++;
+                else if (song->title != title) wrong++;
+                if (engine.lookupByTitle(title).empty()) missing++;
+                if (++local == 1) started++;
+                if (local % 64 == 0) {
+                    auto snapshot = engine.exportSnapshot();
+                    if (snapshot.total_songs < n || snapshot.playlist_size > snapshot.total_songs) torn_snapshots++;
+                    Song copy("", "", "", 0);
+                    if (!engine.readSong("S" + std::to_string(i), copy) || copy.play_count < 0) wrong++;
+                }
+            }
+            reads += local;
+        });
+    }
+    writer.join();
+    for (auto& reader : readers) reader.join();
+    console.stop();
+    
+    TestFramework::test("Published songs are always found", missing == 0);
+    TestFramework::test("Lock-free lookups return the right song", wrong == 0);
+    TestFramework::test("Snapshots never observe a partial mutation", torn_snapshots == 0);
+    TestFramework::test("All songs visible after writes finish",
+                        engine.lookupById("S" + std::to_string(songs - 1)) != nullptr &&
+                        engine.exportSnapshot().total_songs == songs);
+    TestFramework::test("Readers made progress during writes", reads > 0);
+    
+    std::vector<std::string> ids(300);
+    std::vector<SongSpec> specs(300);
+    for (int i = 0; i < 300; i++) {
+        ids[i] = "B" + std::to_string(i);
+        specs[i].id = ids[i];
+        specs[i].title = i % 3 ? "Batch" : "Other";
+        specs[i].artist = "Artist";
+        specs[i].duration = 100 + i;
+    }
+    const std::string path = "test_concurrent_state.pwst";
+    ConcurrentPlayWiseEngine batch, restored;
+    console.start();
+    size_t batched = batch.addSongs(specs);
+    bool saved = batch.write([&](PlayWiseEngine& e) { return e.saveState(path); });
+    bool loaded = restored.loadState(path);
+    console.stop();
+    std::remove(path.c_str());
+    auto titled = batch.lookupByTitle("Batch");
+    TestFramework::test("Batch adds are published to lock-free lookups",
+                        batched == 300 && batch.lookupById("B0") && batch.lookupById("B299") &&
+                        titled.size() == 200 && titled.front()->id == "B1" && titled.back()->id == "B299");
+    TestFramework::test("Loaded state is published to lock-free lookups",
+                        saved && loaded && restored.lookupById("B150") &&
+                        restored.lookupByTitle("Other").size() == 100);
+}
+
+void test_multi_session() {
+    TestFramework::begin_suite("Multi-Session Catalog");
+    
+    ConsoleCapture console;
+    
+    PlayWiseEngine owner;
+    for (int i = 0; i < 200; i++) {
+        owner.addSong("S" + std::to_string(i), "Title " + std::to_string(i), "Artist", 100 + i, 1 + i % 5, i % 2 ? "Jazz" : "Rock");
+    }
+    
+    std::vector<std::unique_ptr<PlayWiseEngine>> sessions;
+    for (int i = 0; i < 1000; i++) {
+        sessions.emplace_back(new PlayWiseEngine(owner.getCatalog()));
+        sessions.back()->queueSong("S" + std::to_string(i % 200));
+    }
+    
+    PlayWiseEngine& listener = *sessions[7];
+    listener.queueSong("S1");
+    listener.queueSong("S3");
+    listener.playSong("S1");
+    listener.playSong("S1");
+    Song* added = listener.addSong("X1", "Extra", "Artist", 100);
+    bool rated = listener.rateSong("S1", 5);
+    auto snapshot = listener.export_snapshot();
+    console.stop();
+    
+    Song* shared_song = owner.getLookup().lookup_by_id("S1");
+    TestFramework::test("Sessions resolve the same song objects", listener.getLookup().lookup_by_id("S1") == shared_song);
+    TestFramework::test("Session playlists are independent",
+                        listener.getPlaylist().getSize() == 3 && sessions[8]->getPlaylist().getSize() == 1 &&
+                        owner.getPlaylist().getSize() == 200);
+    TestFramework::test("Session play counts stay private",
+                        listener.getReplayManager().getPlayCount("S1") == 2 && shared_song->play_count == 0 &&
+                        sessions[8]->getReplayManager().getPlayCount("S1") == 0);
+    TestFramework::test("Sessions cannot modify the shared catalog",
+                        added == nullptr && !rated && owner.getSongDatabase().size() == 200 && !listener.ownsCatalog());
+    TestFramework::test("Session snapshot reads the catalog",
+                        snapshot.total_songs == 200 && snapshot.top_longest_songs.size() == 5 &&
+                        snapshot.recently_played.size() == 2);
+    
+    size_t session_total = 0;
+    for (const auto& session : sessions) session_total += session->sessionFootprint().total();
+    size_t per_session = session_total / sessions.size();
+    size_t catalog_bytes = owner.getCatalog()->memoryBytes();
+    TestFramework::test("Per-session footprint is reported", per_session > sizeof(PlayWiseEngine));
+    TestFramework::test("Sessions are much lighter than the catalog", per_session * 10 < catalog_bytes);
+    TestFramework::test("Catalog is reference-counted across sessions", owner.getCatalog().use_count() > 1000);
+}
+
+void test_command_script() {
+    TestFramework::begin_suite("Command Script Mode");
+    
+    auto tokens = CommandScriptRunner::tokenize("add 7 \"Blue in Green\" \"\" 337");
+    TestFramework::test("Quoted tokens keep their spaces",
+                        tokens.size() == 5 && tokens[2] == "Blue in Green" && tokens[3].empty());
+    
+    std::vector<uint64_t> samples;
+    for (uint64_t i = 1; i <= 100; i++) samples.push_back(i);
+    TestFramework::test("Nearest-rank percentiles",
+                        CommandScriptRunner::percentile(samples, 0.5) == 50 &&
+                        CommandScriptRunner::percentile(samples, 0.99) == 99 &&
+                        CommandScriptRunner::percentile(samples, 1.0) == 100);
+    
+    std::istringstream script(
+        "# warm-up\n"
+        "add 1 \"Blue in Green\" \"Miles Davis\" 337 5 Jazz\n"
+        "add 2 \"Paranoid Android\" Radiohead 386\n"
+        "\n"
+        "play 1\n"
+        "play 1\n"
+        "skip\n"
+        "next\n"
+        "sort played\n"
+        "rate 2 4\n"
+        "search 1\n"
+        "search title \"Blue in Green\"\n"
+        "undo\n"
+        "snapshot\n"
+        "dance\n"
+        "rate 2 nine\n"
+        "play 9\n");
+    
+    PlayWiseEngine engine;
+    CommandScriptRunner runner(engine);
+    std::streambuf* before = std::cout.rdbuf();
+    size_t executed = runner.run(script);
+    bool restored = std::cout.rdbuf() == before;
+    
+    TestFramework::test("Valid commands all execute", executed == 12 && runner.commandCount("play") == 2);
+    TestFramework::test("Bad commands are counted, not fatal", runner.getErrorCount() == 3);
+    TestFramework::test("Commands reach the engine",
+                        engine.getLookup().lookup_by_id("1")->play_count >= 2 &&
+                        engine.getLookup().lookup_by_id("2")->rating == 4 && runner.getSearchHits() == 2);
+    TestFramework::test("Console output restored after the run", restored);
+    
+    std::ostringstream report;
+    runner.report(report);
+    TestFramework::test("Report lists throughput and percentiles",
+                        report.str().find("ops/sec") != std::string::npos &&
+                        report.str().find("p99") != std::string::npos &&
+                        report.str().find("line 15: unknown command 'dance'") != std::string::npos);
+    TestFramework::test("Playing an unknown song is an error",
+                        report.str().find("line 17: no song with id 9") != std::string::npos);
+    TestFramework::test("Report leaves stream formatting untouched",
+                        !(report.flags() & std::ios::fixed) && report.precision() == 6);
+}
+
+void test_trace_recording() {
+    TestFramework::begin_suite("Trace Recording and Replay");
+    
+    std::stringstream encoded;
+    EngineTrace::writeHeader(encoded);
+    EngineTrace::Event written{EngineTrace::ADD_SONG, 300000000ULL,
+                               {"42", "So What", "Miles Davis", ""}, {-1, 5}};
+    EngineTrace::write(encoded, written);
+    EngineTrace::Event decoded;
+    TestFramework::test("Header and record round-trip",
+                        EngineTrace::readHeader(encoded) && EngineTrace::read(encoded, decoded) &&
+                        decoded.op == EngineTrace::ADD_SONG && decoded.delta_us == 300000000ULL &&
+                        decoded.text == written.text && decoded.numbers == written.numbers);
+    TestFramework::test("Read stops cleanly at end of trace", !EngineTrace::read(encoded, decoded));
+    
+    std::stringstream trace;
+    TraceRecorder recorder(trace);
+    recorder.record(EngineTrace::ADD_SONG, {"1", "Blue in Green", "Miles Davis", "Jazz"}, {337, 5});
+    recorder.record(EngineTrace::ADD_SONG, {"2", "Paranoid Android", "Radiohead", "Rock"}, {386, 0});
+    recorder.record(EngineTrace::PLAY_SONG, {"1"});
+    recorder.record(EngineTrace::PLAY_SONG, {"2"});
+    recorder.record(EngineTrace::PLAY_SONG, {"1"});
+    recorder.record(EngineTrace::RATE_SONG, {"2"}, {4});
+    recorder.record(EngineTrace::SORT_PLAYLIST, {}, {PlaylistSorter::MOST_PLAYED, 1});
+    recorder.record(EngineTrace::SEARCH_TITLE, {"Blue in Green"});
+    recorder.record(EngineTrace::REVERSE_PLAYLIST);
+    recorder.record(EngineTrace::SNAPSHOT);
+    TestFramework::test("Play records stay compact", trace.str().size() < 150 && recorder.size() == 10);
+    
+    PlayWiseEngine engine;
+    TraceReplayer replayer(engine);
+    std::streambuf* before = std::cout.rdbuf();
+    size_t replayed = replayer.replay(trace);
+    TestFramework::test("Every recorded operation replays",
+                        replayed == 10 && !replayer.wasTruncated() &&
+                        replayer.getOpCount(EngineTrace::PLAY_SONG) == 3);
+    TestFramework::test("Replay reproduces engine state",
+                        engine.getReplayManager().getPlayCount("1") == 2 &&
+                        engine.getLookup().lookup_by_id("2")->rating == 4 &&
+                        engine.getPlaylist().getAllSongs().front()->id == "2");
+    TestFramework::test("Console output restored after replay", std::cout.rdbuf() == before);
+    
+    std::ostringstream report;
+    replayer.report(report);
+    TestFramework::test("Report breaks time down per operation",
+                        report.str().find("play\t3") != std::string::npos &&
+                        report.str().find("Mean(us)") != std::string::npos);
+    
+    std::string cut = trace.str().substr(0, trace.str().size() - 1);
+    std::istringstream partial(cut);
+    PlayWiseEngine scratch;
+    TraceReplayer partial_replayer(scratch);
+    partial_replayer.replay(partial);
+    std::istringstream garbage("not a trace");
+    TraceReplayer garbage_replayer(scratch);
+    TestFramework::test("Truncated and foreign files are detected",
+                        partial_replayer.wasTruncated() && garbage_replayer.replay(garbage) == 0 &&
+                        garbage_replayer.wasTruncated());
+}
+
+void test_incremental_snapshot() {
+    TestFramework::begin_suite("Incremental System Snapshot");
+    
+    auto quietly = [](const std::function<void()>& fn) {
+        ConsoleCapture console;
+        fn();
+    };
+    
+    PlayWiseEngine engine;
+    engine.addSong("1", "Blue in Green", "Miles Davis", 337, 5, "Jazz");
+    engine.addSong("2", "Paranoid Android", "Radiohead", 386, 4, "Rock");
+    engine.addSong("3", "Teardrop", "Massive Attack", 330, 0, "Trip-Hop");
+    
+    auto snapshot = engine.export_snapshot();
+    TestFramework::test("Export records the current version", snapshot.version == engine.snapshot_version());
+    TestFramework::test("Unchanged snapshot is not refreshed", !engine.refresh_snapshot(snapshot));
+    
+    quietly([&]() { engine.playSong("1"); engine.playSong("2"); });
+    bool refreshed = engine.refresh_snapshot(snapshot);
+    TestFramework::test("Plays refresh recently played, newest first",
+                        refreshed && snapshot.recently_played.size() == 2 &&
+                        snapshot.recently_played[0]->id == "2");
+    
+    quietly([&]() { engine.rateSong("2", 5); engine.rateSong("3", 2); });
+    engine.refresh_snapshot(snapshot);
+    TestFramework::test("Rating counts follow re-rating",
+                        snapshot.rating_counts[4] == 0 && snapshot.rating_counts[5] == 2 &&
+                        snapshot.rating_counts[2] == 1 &&
+                        snapshot.rating_counts == engine.getRatingTree().getSongCountByRating());
+    
+    uint64_t before_delete = snapshot.version;
+    quietly([&]() { engine.getPlaylist().delete_song(0); });
+    TestFramework::test("Playlist edits bump the version",
+                        engine.snapshot_version() != before_delete && engine.refresh_snapshot(snapshot) &&
+                        snapshot.playlist_size == 2);
+    
+    quietly([&]() { engine.undoLastPlay(); });
+    engine.refresh_snapshot(snapshot);
+    TestFramework::test("Undo drops the song from recently played",
+                        snapshot.recently_played.size() == 1 && snapshot.recently_played[0]->id == "1");
+    
+    PlayWiseEngine::SystemSnapshot fresh;
+    TestFramework::test("Default snapshot always refreshes", engine.refresh_snapshot(fresh) && fresh.total_songs == 3);
+    
+    SongCatalog catalog;
+    catalog.addSong("9", "Unindexed", "Artist", 100, 9);
+    catalog.rateSong("9", 3);
+    TestFramework::test("Re-rating an out-of-range rating keeps counts valid",
+                        catalog.getRatingCounts().count(9) == 0 && catalog.getRatingCounts().at(3) == 1);
+}
+
+void test_song_key_index() {
+    TestFramework::begin_suite("Open-Addressing Song Index");
+    
+    std::vector<std::unique_ptr<Song>> songs;
+    InstantLookup lookup;
+    for (int i = 0; i < 200; i++) {
+        songs.emplace_back(new Song("ID" + std::to_string(i), i % 3 == 0 ? "Echoes" : "Track " + std::to_string(i),
+                                    "Artist", 200));
+        lookup.add_song(songs.back().get());
+    }
+    auto echoes = lookup.lookup_by_title("Echoes");
+    bool ordered = echoes.size() == 67;
+    for (size_t i = 0; ordered && i < echoes.size(); i++) ordered = echoes[i]->id == "ID" + std::to_string(i * 3);
+    TestFramework::test("Duplicate titles keep insertion order across growth", ordered);
+    
+    lookup.remove_song("ID3");
+    lookup.remove_song("ID100");
+    bool all_found = true;
+    for (int i = 0; i < 200; i++) {
+        Song* found = lookup.lookup_by_id("ID" + std::to_string(i));
+        all_found = all_found && (i == 3 || i == 100 ? found == nullptr : found == songs[i].get());
+    }
+    echoes = lookup.lookup_by_title("Echoes");
+    TestFramework::test("Removal keeps every other song reachable",
+                        all_found && echoes.size() == 66 && echoes[0]->id == "ID0" && echoes[1]->id == "ID6" &&
+                        lookup.lookup_by_title("Track 100").empty());
+    
+    Song replacement("ID7", "Other", "Artist", 100);
+    lookup.add_song(&replacement);
+    TestFramework::test("Re-adding an ID points it at the newest song",
+                        lookup.lookup_by_id("ID7") == &replacement && lookup.lookup_by_title("Track 7").size() == 1);
+}
+
+void test_state_persistence() {
+    TestFramework::begin_suite("Engine State Save/Load");
+    
+    const std::string path = "test_state.pwst";
+    ConsoleCapture console;
+    
+    PlayWiseEngine original;
+    original.addSong("1", "Blue in Green", "Miles Davis", 337, 5, "Jazz");
+    original.addSong("2", "The Paranoid Android", "Radiohead", 386, 0, "Rock");
+    original.addSong("3", "Clair de Lune", "Claude Debussy", 300, 4, "Classical");
+    original.playSong("1");
+    original.playSong("3");
+    original.playSong("1");
+    original.skipCurrentSong();
+    original.playSong("2");
+    original.rateSong("2", 3);
+    original.getPlaylist().move_song(2, 0);
+    original.getSkippedTracker().setCapacity(4);
+    original.toggleAutoReplay();
+    bool saved = original.saveState(path);
+    
+    PlayWiseEngine restored;
+    bool loaded = restored.loadState(path);
+    console.stop();
+    
+    TestFramework::test("State saves and loads", saved && loaded);
+    Song* blue = restored.getLookup().lookup_by_id("1");
+    Song* android = restored.getLookup().lookup_by_id("2");
+    TestFramework::test("Songs keep ratings, play counts and sort keys",
+                        restored.getSongDatabase().size() == 3 && blue && blue->play_count == 2 &&
+                        blue->rating == 5 && android && android->rating == 3 &&
+                        android->title_key.folded == original.getLookup().lookup_by_id("2")->title_key.folded);
+    
+    auto before = original.getPlaylist().getAllSongs();
+    auto after = restored.getPlaylist().getAllSongs();
+    bool same_order = before.size() == after.size();
+    for (size_t i = 0; same_order && i < before.size(); i++) same_order = before[i]->id == after[i]->id;
+    TestFramework::test("Playlist order preserved", same_order && after.front()->id == "3");
+    
+    auto history = restored.getHistory().getRecentlyPlayed(10);
+    TestFramework::test("History preserved newest first",
+                        history.size() == 4 && history[0]->id == "2" && history[3]->id == "1");
+    TestFramework::test("Skip tracker and settings preserved",
+                        restored.getSkippedTracker().wasRecentlySkipped("1") &&
+                        restored.getSkippedTracker().capacity() == 4 &&
+                        !restored.getReplayManager().isAutoReplayEnabled());
+    TestFramework::test("Rating index and replay counts rebuilt",
+                        restored.getRatingTree().search_by_rating(3).size() == 1 &&
+                        restored.getReplayManager().getPlayCount("1") == 2);
+    
+    console.start();
+    bool reload_refused = !restored.loadState(path);
+    
+    std::string image;
+    {
+        std::ifstream in(path, std::ios::binary);
+        image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(image.data(), image.size() - 3);
+    }
+    PlayWiseEngine from_truncated;
+    bool truncated_refused = !from_truncated.loadState(path);
+    
+    image[sizeof(EngineStateFormat::Header) + sizeof(EngineStateFormat::SongRecord) * 3] = '\x7f'; // first ID lookup slot
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(image.data(), image.size());
+    }
+    PlayWiseEngine from_corrupt;
+    bool corrupt_refused = !from_corrupt.loadState(path);
+    
+    // Slots placed by a different string hash are re-indexed instead of trusted
+    original.saveState(path);
+    {
+        std::ifstream in(path, std::ios::binary);
+        image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    uint64_t foreign_hash = ~EngineStateFormat::hashFingerprint();
+    std::memcpy(&image[offsetof(EngineStateFormat::Header, hash_fingerprint)], &foreign_hash, sizeof(foreign_hash));
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(image.data(), image.size());
+    }
+    PlayWiseEngine rehashed;
+    bool rehashed_loaded = rehashed.loadState(path);
+    
+    PlayWiseEngine rated;
+    CommandScriptRunner runner(rated);
+    std::istringstream script("add X1 \"T\" \"A\" 100 9\nadd X2 \"T\" \"A\" 100 5\n");
+    size_t added = runner.run(script);
+    std::vector<SongSpec> specs(2);
+    specs[0].id = "X3";
+    specs[0].rating = -1;
+    specs[1].id = "X4";
+    specs[1].rating = 4;
+    size_t batched = rated.addSongs(specs);
+    bool rated_saved = rated.saveState(path);
+    PlayWiseEngine rated_restored;
+    bool rated_loaded = rated_restored.loadState(path);
+    console.stop();
+    std::remove(path.c_str());
+    
+    TestFramework::test("Loading needs an empty engine", reload_refused);
+    TestFramework::test("Truncated and corrupt files are rejected untouched",
+                        truncated_refused && corrupt_refused && from_corrupt.getSongDatabase().empty());
+    TestFramework::test("Foreign hash layout is rebuilt on load",
+                        rehashed_loaded && rehashed.getLookup().lookup_by_id("2") &&
+                        rehashed.getLookup().lookup_by_id("2")->id == "2" &&
+                        rehashed.getLookup().lookup_by_title("Clair de Lune").size() == 1);
+    TestFramework::test("Out-of-range ratings are refused at add, so saves always load",
+                        added == 1 && batched == 1 && !rated.getLookup().lookup_by_id("X1") &&
+                        !rated.getLookup().lookup_by_id("X3") && rated_saved && rated_loaded &&
+                        rated_restored.getSongDatabase().size() == 2);
+}
+
+void test_catalog_import() {
+    TestFramework::begin_suite("Streaming Catalog Import");
+    
+    std::string csv =
+        "genre,ID,artist,title,duration,rating\n"
+        "Jazz,c1,Miles Davis,\"So What, Again\",545,5\r\n"
+        "Rock,c2,Queen,\"The \"\"Show\"\" Must Go On\",263,\n"
+        "\n"
+        "Pop,c3,Nobody,Broken,abc,3\n"
+        "Pop,c4,Nobody,Too Good,200,7\n"
+        "Pop,c5,Nobody,Wide,200,1,extra\n"
+        "Pop,c6,Nobody,\"Open quote,200,1\n"
+        ",c7,Someone,Last,90,2";
+    
+    ConsoleCapture console;
+    PlayWiseEngine engine;
+    CatalogImporter importer(engine, 3, 64); // Tiny chunks and several threads exercise the seams
+    std::istringstream csv_in(csv);
+    size_t csv_imported = importer.import(csv_in, CatalogImporter::CSV);
+    console.stop();
+    
+    Song* so_what = engine.getLookup().lookup_by_id("c1");
+    Song* show = engine.getLookup().lookup_by_id("c2");
+    Song* last = engine.getLookup().lookup_by_id("c7");
+    TestFramework::test("Header remaps CSV columns",
+                        csv_imported == 3 && so_what && so_what->title == "So What, Again" &&
+                        so_what->artist == "Miles Davis" && so_what->genre == "Jazz" && so_what->rating == 5);
+    TestFramework::test("Doubled quotes unescape and empty fields default",
+                        show && show->title == "The \"Show\" Must Go On" && show->rating == 0 &&
+                        last && last->genre == "Unknown");
+    
+    const auto& errors = importer.getErrors();
+    TestFramework::test("Malformed rows rejected with line numbers",
+                        importer.getRejectedCount() == 4 && errors.size() == 4 &&
+                        errors[0] == "line 5: bad duration 'abc'" && errors[1] == "line 6: bad rating '7'" &&
+                        errors[2] == "line 7: too many fields" && errors[3].rfind("line 8:", 0) == 0);
+    
+    auto playlist = engine.getPlaylist().getAllSongs();
+    TestFramework::test("Imported songs keep file order in the playlist",
+                        playlist.size() == 3 && playlist[0]->id == "c1" && playlist[2]->id == "c7");
+    
+    // Columns past the six known ones are skipped, however many there are
+    std::string wide = "id,title,artist,duration,rating,genre,album";
+    std::string wide_row = "w1,Wide Song,Band,180,4,Jazz,Album";
+    for (int c = 8; c <= 20; c++) {
+        wide += ",extra" + std::to_string(c);
+        wide_row += ",x" + std::to_string(c);
+    }
+    std::string wide_csv = wide + "\n" + wide_row + "\nw2,Cut Short,Band,90,3,Rock\nw3,Short,Band,100\n";
+    console.start();
+    PlayWiseEngine wide_engine;
+    CatalogImporter wide_importer(wide_engine, 1, 1 << 16);
+    std::istringstream wide_in(wide_csv);
+    size_t wide_imported = wide_importer.import(wide_in, CatalogImporter::CSV);
+    console.stop();
+    Song* wide_song = wide_engine.getLookup().lookup_by_id("w1");
+    TestFramework::test("Extra header columns are ignored",
+                        wide_imported == 3 && wide_importer.getRejectedCount() == 0 && wide_song &&
+                        wide_song->title == "Wide Song" && wide_song->genre == "Jazz" && wide_song->rating == 4);
+    
+    std::string jsonl =
+        "{\"id\": \"j1\", \"title\": \"Caf\\u00e9 \\\"Blue\\\"\", \"artist\": \"A\", \"duration\": 120, \"rating\": 4, \"live\": true}\n"
+        "{\"id\":\"j2\",\"title\":\"Missing\",\"duration\":10}\n"
+        "{\"id\":\"j3\",\"title\":\"T\",\"artist\":\"A\",\"duration\":\"10\"}\n"
+        "{\"title\":\"Plain\",\"artist\":\"B\",\"duration\":99,\"genre\":\"Lo-Fi\",\"id\":\"j4\"}\n";
+    console.start();
+    PlayWiseEngine json_engine;
+    CatalogImporter json_importer(json_engine, 2, 32);
+    std::istringstream json_in(jsonl);
+    json_importer.import(json_in, CatalogImporter::JSON_LINES);
+    console.stop();
+    
+    Song* cafe = json_engine.getLookup().lookup_by_id("j1");
+    Song* plain = json_engine.getLookup().lookup_by_id("j4");
+    TestFramework::test("JSON lines parse escapes and ignore unknown keys",
+                        cafe && cafe->title == "Caf\xC3\xA9 \"Blue\"" && cafe->rating == 4 &&
+                        plain && plain->genre == "Lo-Fi" && plain->duration == 99);
+    TestFramework::test("Bad JSON rows rejected with line numbers",
+                        json_importer.getImportedCount() == 2 && json_importer.getErrors().size() == 2 &&
+                        json_importer.getErrors()[0] == "line 2: missing artist" &&
+                        json_importer.getErrors()[1] == "line 3: duration must be a number");
+    TestFramework::test("Format detected from extension",
+                        CatalogImporter::detectFormat("songs.JSONL") == CatalogImporter::JSON_LINES &&
+                        CatalogImporter::detectFormat("songs.csv") == CatalogImporter::CSV);
+}
+
+void test_bulk_add_songs() {
+    TestFramework::begin_suite("Bulk addSongs");
+    
+    const char* genres[] = {"Rock", "Jazz", "Pop"};
+    std::vector<std::string> ids, titles;
+    for (int i = 0; i < 300; i++) {
+        ids.push_back("B" + std::to_string(i));
+        titles.push_back("Song " + std::to_string(i % 50));
+    }
+    std::vector<SongSpec> specs(300);
+    for (int i = 0; i < 300; i++) {
+        specs[i].id = ids[i];
+        specs[i].title = titles[i];
+        specs[i].artist = "Artist";
+        specs[i].genre = genres[i % 3];
+        specs[i].duration = 100 + (i * 37) % 500;
+        specs[i].rating = i % 6;
+    }
+    
+    PlayWiseEngine single, bulk;
+    for (const SongSpec& spec : specs) {
+        single.addSong(std::string(spec.id), std::string(spec.title), std::string(spec.artist),
+                       spec.duration, spec.rating, std::string(spec.genre));
+    }
+    size_t added = bulk.addSongs(specs);
+    
+    auto single_order = single.getPlaylist().getAllSongs();
+    auto bulk_order = bulk.getPlaylist().getAllSongs();
+    bool same_order = added == 300 && bulk_order.size() == 300;
+    for (size_t i = 0; same_order && i < bulk_order.size(); i++) same_order = bulk_order[i]->id == single_order[i]->id;
+    TestFramework::test("Batch lands in the playlist in order", same_order);
+    
+    bool same_buckets = true;
+    for (int rating = 1; rating <= 5; rating++) {
+        auto a = single.getRatingTree().search_by_rating(rating);
+        auto b = bulk.getRatingTree().search_by_rating(rating);
+        same_buckets = same_buckets && a.size() == b.size() && b.size() == 50;
+        for (size_t i = 0; same_buckets && i < b.size(); i++) same_buckets = a[i]->id == b[i]->id;
+    }
+    TestFramework::test("Rating index matches per-song inserts", same_buckets &&
+                        bulk.getCatalog()->getRatingCounts() == single.getCatalog()->getRatingCounts());
+    
+    auto& lookup = bulk.getLookup();
+    TestFramework::test("Lookups cover the batch",
+                        lookup.lookup_by_id("B299") && lookup.lookup_by_id("B299")->duration == specs[299].duration &&
+                        lookup.lookup_by_title("Song 7").size() == 6);
+    
+    bool same_longest = true;
+    for (size_t i = 0; i < 5; i++)
+        same_longest = same_longest && bulk.getCatalog()->getTopLongest()[i]->id == single.getCatalog()->getTopLongest()[i]->id;
+    TestFramework::test("Top longest songs maintained", same_longest);
+    
+    bool add_order_kept = true;
+    for (size_t i = 1; i < bulk_order.size(); i++) add_order_kept = add_order_kept && bulk_order[i - 1]->added_time < bulk_order[i]->added_time;
+    TestFramework::test("One timestamp per batch keeps add order", add_order_kept);
+    
+    size_t footprint = bulk.getPlaylist().memoryBytes();
+    bulk.getPlaylist().delete_song(0);
+    bulk.getPlaylist().delete_song(10);
+    bulk.addSong("B300", "Late", "Artist", 200, 3, "Pop");
+    bulk.addSong("B301", "Later", "Artist", 200, 3, "Pop");
+    auto after = bulk.getPlaylist().getAllSongs();
+    TestFramework::test("Deleted playlist nodes are reused",
+                        bulk.getPlaylist().memoryBytes() == footprint && after.size() == 300 &&
+                        after.front()->id == "B1" && after.back()->id == "B301");
+}
+
+void test_genre_index() {
+    TestFramework::begin_suite("Genre Index");
+    
+    ConsoleCapture console;
+    PlayWiseEngine engine;
+    for (int i = 0; i < 25; i++) {
+        engine.addSong("G" + std::to_string(i), "Track " + std::to_string(i), "Artist", 200,
+                       i % 5 + 1, i % 5 == 0 ? "Jazz" : "Rock");
+    }
+    std::vector<SongSpec> batch(2);
+    batch[0].id = "G25"; batch[0].title = "Bulk"; batch[0].artist = "A"; batch[0].genre = "Jazz";
+    batch[1].id = "G26"; batch[1].title = "Bulk"; batch[1].artist = "A"; batch[1].genre = "Ambient";
+    engine.addSongs(batch);
+    engine.displaySongsByGenre();
+    console.stop();
+    
+    TestFramework::test("Genre counts maintained on add",
+                        engine.getGenreCount("Jazz") == 6 && engine.getGenreCount("Rock") == 20 &&
+                        engine.getGenreCount("Ambient") == 1 && engine.getGenreCount("Polka") == 0);
+    
+    auto first_page = engine.getSongsByGenre("Rock", 0, 8);
+    auto last_page = engine.getSongsByGenre("Rock", 16, 8);
+    TestFramework::test("Paged listing in add order",
+                        first_page.size() == 8 && first_page[0]->id == "G1" && first_page[4]->id == "G6" &&
+                        last_page.size() == 4 && last_page.back()->id == "G24" &&
+                        engine.getSongsByGenre("Rock", 40, 8).empty());
+    
+    TestFramework::test("Display reads the index",
+                        console.text().find("Jazz (6 songs)") != std::string::npos &&
+                        console.text().find("Ambient (1 songs)") != std::string::npos);
+    
+    bool retagged = engine.setSongGenre("G1", "Jazz");
+    TestFramework::test("Genre change moves the song",
+                        retagged && engine.getLookup().lookup_by_id("G1")->genre == "Jazz" &&
+                        engine.getGenreCount("Rock") == 19 && engine.getGenreCount("Jazz") == 7 &&
+                        engine.getSongsByGenre("Jazz").back()->id == "G1" &&
+                        !engine.setSongGenre("missing", "Jazz"));
+    
+    GenreIndex index;
+    Song a("a", "A", "X", 100, 0, "Pop"), b("b", "B", "X", 100, 0, "Pop"), c("c", "C", "X", 100, 0, "Pop");
+    a.handle = 0; b.handle = 1; c.handle = 2;
+    index.add_song(&a);
+    index.add_song(&b);
+    index.add_song(&c);
+    bool removed = index.remove_song(&a) && !index.remove_song(&a);
+    auto pop = index.page("Pop", 0, 10);
+    TestFramework::test("Removal swaps in the genre's last song",
+                        removed && pop.size() == 2 && pop[0] == &c && pop[1] == &b &&
+                        index.remove_song(&c) && index.page("Pop", 0, 10) == std::vector<Song*>{&b});
+    Song d("d", "D", "X", 100, 0, "Rock");
+    d.handle = 3;
+    index.add_song(&d);
+    size_t genres_before = index.genreCount();
+    index.remove_song(&b);
+    TestFramework::test("Empty genres are not listed", index.count("Pop") == 0 && index.genre_counts().size() == 1);
+    TestFramework::test("Genre count drops when a genre's last song goes",
+                        genres_before == 2 && index.genreCount() == 1);
+    index.add_song(&b);
+    TestFramework::test("Refilled genre counted again", index.genreCount() == 2);
+}
+
+void test_remove_song() {
+    TestFramework::begin_suite("Global Song Removal");
+    
+    ConsoleCapture console;
+    
+    PlayWiseEngine engine;
+    engine.addSong("1", "Blue in Green", "Miles Davis", 337, 5, "Jazz");
+    engine.addSong("2", "So What", "Miles Davis", 545, 4, "Jazz");
+    engine.addSong("3", "Naima", "John Coltrane", 261, 4, "Jazz");
+    engine.addSong("4", "Epic", "Band", 900, 2, "Rock");
+    for (int i = 5; i <= 12; i++) engine.addSong(std::to_string(i), "Filler", "Band", 100 + i, 3, "Rock");
+    engine.materializeSortedView(PlaylistSorter::DURATION_ASC);
+    
+    engine.playSong("2");
+    engine.playSong("1");
+    engine.playSong("2");
+    engine.skipCurrentSong();
+    engine.playSong("3");
+    engine.playSong("2");
+    engine.queueSong("2");
+    engine.getReplayManager().setupAutoReplay(); // "2" leads the calming rotation
+    int playlist_before = engine.getPlaylist().getSize();
+    int history_before = engine.getHistory().size();
+    
+    bool removed = engine.removeSong("2");
+    bool missing = !engine.removeSong("2");
+    console.start();
+    console.clear();
+    engine.skipCurrentSong();
+    std::string after_skip = console.text();
+    console.stop();
+    
+    auto playlist = engine.getPlaylist().getAllSongs();
+    auto history = engine.getHistory().getRecentlyPlayed(10);
+    TestFramework::test("Song leaves the catalog and lookups",
+                        removed && missing && !engine.getLookup().lookup_by_id("2") &&
+                        engine.getLookup().lookup_by_title("So What").empty() &&
+                        engine.getSongDatabase().size() == 11);
+    TestFramework::test("Every playlist occurrence removed",
+                        engine.getPlaylist().getSize() == playlist_before - 2 &&
+                        std::none_of(playlist.begin(), playlist.end(), [](Song* s) { return s->id == "2"; }));
+    TestFramework::test("History keeps the other plays in order",
+                        engine.getHistory().size() == history_before - 3 && history.size() == 2 &&
+                        history[0]->id == "3" && history[1]->id == "1");
+    TestFramework::test("Current song cleared", after_skip.find("No song is currently playing") != std::string::npos);
+    TestFramework::test("Skip tracker forgets the song", !engine.getSkippedTracker().wasRecentlySkipped("2"));
+    
+    auto four_star = engine.getRatingTree().search_by_rating(4);
+    TestFramework::test("Rating index and counts updated",
+                        four_star.size() == 1 && four_star[0]->id == "3" &&
+                        engine.getCatalog()->getRatingCounts().at(4) == 1);
+    TestFramework::test("Genre index updated", engine.getGenreCount("Jazz") == 2);
+    
+    auto calming = engine.getReplayManager().getTopCalming();
+    Song* next_replay = engine.getReplayManager().getNextReplaySong();
+    TestFramework::test("Replay rankings and rotation forget the song",
+                        engine.getReplayManager().getPlayCount("2") == 0 &&
+                        std::none_of(calming.begin(), calming.end(), [](Song* s) { return s->id == "2"; }) &&
+                        next_replay && next_replay->id != "2");
+    
+    console.start();
+    bool epic_removed = engine.removeSong("4");
+    engine.sortPlaylist(PlaylistSorter::DURATION_ASC);
+    console.stop();
+    auto longest = engine.getCatalog()->getTopLongest();
+    auto sorted = engine.getPlaylist().getAllSongs();
+    TestFramework::test("Top longest refilled after removing a member",
+                        epic_removed && longest.size() == 5 && longest[0]->id == "1" && longest[1]->id == "3");
+    TestFramework::test("Sorted view no longer holds the song",
+                        sorted.size() == 10 && sorted.front()->id == "5" && sorted.back()->id == "1");
+    
+    console.start();
+    engine.undoLastPlay();
+    console.stop();
+    TestFramework::test("Undo pops surviving plays only",
+                        engine.getHistory().size() == 1 && engine.getHistory().getRecentlyPlayed(1)[0]->id == "1" &&
+                        engine.getPlaylist().getAllSongs().back()->id == "3");
+    
+    // IDs are unique, so one removal always takes the song down completely
+    PlayWiseEngine dup;
+    console.start();
+    Song* first_a = dup.addSong("A", "Original", "Band", 100);
+    Song* second_a = dup.addSong("A", "Impostor", "Band", 200);
+    std::vector<SongSpec> specs(3);
+    specs[0].id = "A";
+    specs[1].id = "B";
+    specs[2].id = "B";
+    size_t batched = dup.addSongs(specs);
+    std::istringstream csv("id,title,artist,duration\nC,Fresh,Band,100\nA,Again,Band,100\nC,Twice,Band,100\n");
+    CatalogImporter importer(dup, 1, 1 << 16);
+    size_t imported = importer.import(csv, CatalogImporter::CSV);
+    CommandScriptRunner runner(dup);
+    std::istringstream script("add B \"Other\" Band 100\n");
+    size_t scripted = runner.run(script);
+    bool dup_removed = dup.removeSong("A");
+    bool dup_gone = !dup.removeSong("A");
+    console.stop();
+    TestFramework::test("Duplicate IDs are refused on every add path",
+                        first_a && !second_a && batched == 1 && imported == 1 && scripted == 0 &&
+                        importer.getErrors().size() == 2 && importer.getErrors()[0] == "line 3: duplicate id 'A'" &&
+                        importer.getErrors()[1] == "line 4: duplicate id 'C'");
+    TestFramework::test("Removing a refused duplicate leaves nothing behind",
+                        dup_removed && dup_gone && !dup.getLookup().lookup_by_id("A") &&
+                        dup.getLookup().lookup_by_title("Original").empty() && dup.getSongDatabase().size() == 2 &&
+                        dup.getPlaylist().getSize() == 2);
+
+    // A removed top-k member's place goes to the next most played song of its mood
+    PlayWiseEngine ranked;
+    console.start();
+    const char* jazz_ids[] = {"A", "B", "C", "D", "E"};
+    for (int i = 0; i < 5; i++)
+    {
+        ranked.addSong(jazz_ids[i], std::string("Jazz ") + jazz_ids[i], "Band", 100, 3, "Jazz");
+        for (int plays = 5 - i; plays > 0 && i < 4; plays--)
+            ranked.playSong(jazz_ids[i]);
+    }
+    bool ranked_removed = ranked.removeSong("A");
+    ranked.playSong("E");
+    console.stop();
+    auto promoted = ranked.getReplayManager().getTopCalming();
+    TestFramework::test("Next most played song promoted into the top-k",
+                        ranked_removed && promoted.size() == 3 && promoted[0]->id == "B" &&
+                        promoted[1]->id == "C" && promoted[2]->id == "D");
+
+    PlayWiseEngine owner;
+    console.start();
+    owner.addSong("s1", "Shared", "A", 100, 3, "Pop");
+    bool refused;
+    {
+        PlayWiseEngine session(owner.getCatalog());
+        session.queueSong("s1");
+        refused = !owner.removeSong("s1") && !session.removeSong("s1");
+    }
+    bool allowed_alone = owner.removeSong("s1");
+    console.stop();
+    TestFramework::test("Refused while sessions share the catalog", refused && allowed_alone);
+    
+    ConcurrentPlayWiseEngine concurrent;
+    console.start();
+    concurrent.addSong("c1", "Gone", "A", 100, 3, "Pop");
+    concurrent.addSong("c2", "Gone", "B", 100, 3, "Pop");
+    bool concurrent_removed = concurrent.removeSong("c1");
+    console.stop();
+    Song copy("", "", "", 0);
+    TestFramework::test("Concurrent removal unpublishes the song",
+                        concurrent_removed && !concurrent.lookupById("c1") && !concurrent.readSong("c1", copy) &&
+                        concurrent.lookupByTitle("Gone").size() == 1);
+}
+
+// Reads count response frames from a non-blocking socket; payloads keep their status byte
+static bool read_responses(int fd, size_t count, std::vector<std::string>& responses) {
+    std::string buffer;
+    while (responses.size() < count) {
+        pollfd waiting{fd, POLLIN, 0};
+        if (poll(&waiting, 1, 5000) <= 0) return false;
+        bool open = ServerProtocol::drain(fd, buffer);
+        size_t offset = 0;
+        std::string_view payload;
+        while (ServerProtocol::nextFrame(buffer, offset, payload) > 0) responses.emplace_back(payload);
+        buffer.erase(0, offset);
+        if (!open) break;
+    }
+    return responses.size() == count;
+}
+
+void test_engine_server() {
+    TestFramework::begin_suite("Socket Server");
+    
+    std::string path = "/tmp/playwise_test_" + std::to_string(getpid()) + ".sock";
+    PlayWiseEngine engine;
+    EngineServer server(engine);
+    bool listening = server.listen(path);
+    std::thread serving([&server]() { server.run(); });
+    
+    // Five pipelined requests in one write come back in order
+    int client = ServerProtocol::connectTo(path);
+    std::string batch;
+    ServerProtocol::appendRequest(batch, "add T1 \"Tune\" \"Band\" 200 4 Jazz");
+    ServerProtocol::appendRequest(batch, "get T1");
+    ServerProtocol::appendRequest(batch, "get NOPE");
+    ServerProtocol::appendRequest(batch, "play T1");
+    ServerProtocol::appendRequest(batch, "play NOPE");
+    size_t offset = 0;
+    bool sent = client >= 0 && ServerProtocol::flush(client, batch, offset);
+    std::vector<std::string> responses;
+    bool answered = sent && read_responses(client, 5, responses);
+    
+    // A frame over the size limit closes the connection
+    int oversized = ServerProtocol::connectTo(path);
+    std::string huge;
+    ServerProtocol::appendHeader(huge, ServerProtocol::MAX_FRAME + 1);
+    offset = 0;
+    ServerProtocol::flush(oversized, huge, offset);
+    std::vector<std::string> none;
+    bool dropped = !read_responses(oversized, 1, none) && none.empty();
+    
+    // Hundreds of pipelining clients on one event loop
+    LoadGenerator seeder(path, 1, 16);
+    bool seeded = seeder.run(LoadGenerator::seedCommands(100), 100);
+    LoadGenerator load(path, 300, 4);
+    bool loaded = load.run(LoadGenerator::mixedWorkload(100), 6000);
+    
+    server.stop();
+    serving.join();
+    ::close(client);
+    ::close(oversized);
+    
+    TestFramework::test("Server listens on a Unix socket", listening && server.getEndpoint() == path);
+    TestFramework::test("Pipelined responses arrive in request order",
+                        answered && responses[0] == std::string(1, '\0') &&
+                        responses[1].find("T1\tTune by Band") == 1 &&
+                        responses[2][0] == ServerProtocol::ERROR && responses[3][0] == ServerProtocol::OK &&
+                        responses[4][0] == ServerProtocol::ERROR);
+    TestFramework::test("Oversized frame closes the connection", dropped && server.getProtocolErrorCount() == 1);
+    TestFramework::test("Load generator gets every response",
+                        seeded && loaded && load.getCompleted() == 6000 && load.getFailed() == 0 &&
+                        load.getConnectFailures() == 0);
+    TestFramework::test("Latency percentiles are ordered",
+                        load.latencyPercentile(0.5) > 0 && load.latencyPercentile(0.5) <= load.latencyPercentile(0.99));
+    TestFramework::test("Server multiplexed every connection",
+                        server.getPeakConnections() >= 300 && server.getRequestCount() == 5 + 100 + 6000 &&
+                        engine.getSongDatabase().size() == 101);
+    bool socket_existed = ::access(path.c_str(), F_OK) == 0;
+    server.close();
+    TestFramework::test("Socket file removed when closed", socket_existed && ::access(path.c_str(), F_OK) != 0);
+    
+    EngineServer tcp(engine);
+    TestFramework::test("TCP loopback port is assigned", tcp.listen("tcp:0") && tcp.getEndpoint() != "tcp:0");
+    
+    ConsoleCapture console;
+    EngineServer invalid(engine);
+    bool rejected = !invalid.listen("tcp:99999");
+    console.stop();
+    TestFramework::test("Invalid endpoint rejected", rejected);
+}
+
+void test_engine_metrics() {
+    TestFramework::begin_suite("Operation Metrics");
+    
+    LatencyHistogram histogram;
+    for (uint64_t v = 1; v <= 100000; v++) histogram.record(v);
+    auto within = [](uint64_t got, double want) { return std::abs(got - want) <= want / LatencyHistogram::SUB_BUCKETS; };
+    TestFramework::test("Histogram percentiles within bucket precision",
+                        histogram.count() == 100000 && within(histogram.percentile(0.5), 50000) &&
+                        within(histogram.percentile(0.99), 99000) && within(histogram.percentile(0.999), 99900));
+    TestFramework::test("Histogram keeps exact max and sum",
+                        histogram.max() == 100000 && histogram.totalValue() == 5000050000ULL);
+    bool precise = true;
+    for (uint64_t v = 1; v < (uint64_t(1) << 36); v = v * 3 + 1) {
+        size_t bucket = LatencyHistogram::bucketOf(v);
+        precise &= bucket < LatencyHistogram::BUCKET_COUNT && within(LatencyHistogram::bucketValue(bucket), v);
+    }
+    TestFramework::test("Every magnitude maps to a nearby bucket", precise);
+    
+    auto before = EngineMetrics::collect();
+    ConsoleCapture console;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; t++) {
+        workers.emplace_back([]() {
+            PlayWiseEngine engine;
+            engine.addSong("1", "Blue in Green", "Miles Davis", 337, 5, "Jazz");
+            for (int i = 0; i < 250; i++) engine.playSong("1");
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    PlayWiseEngine engine;
+    engine.addSong("1", "Blue in Green", "Miles Davis", 337, 5, "Jazz");
+    engine.rateSong("1", 4);
+    engine.sortPlaylist(PlaylistSorter::TITLE_ASC);
+    console.stop();
+    auto after = EngineMetrics::collect();
+    
+    auto delta = [&](EngineMetrics::Op op) { return after.calls[op] - before.calls[op]; };
+    TestFramework::test("Plays on every thread are counted", delta(EngineMetrics::PLAY_SONG) == 1000);
+    TestFramework::test("Each public operation has its own counter",
+                        delta(EngineMetrics::ADD_SONG) == 5 && delta(EngineMetrics::RATE_SONG) == 1 &&
+                        delta(EngineMetrics::SORT_PLAYLIST) == 1 && delta(EngineMetrics::UNDO_PLAY) == 0);
+    uint64_t timed = after.latency[EngineMetrics::PLAY_SONG].count() - before.latency[EngineMetrics::PLAY_SONG].count();
+    TestFramework::test("Sampled latencies are recorded",
+                        timed >= 1000 / EngineMetrics::sampleInterval() - 4 && timed <= 1000 &&
+                        after.latency[EngineMetrics::PLAY_SONG].percentile(0.5) > 0);
+    
+    std::ostringstream stats, scrape;
+    EngineMetrics::report(stats);
+    EngineMetrics::exposition(scrape);
+    TestFramework::test("Stats table lists operations that ran",
+                        stats.str().find("playSong") != std::string::npos &&
+                        stats.str().find("p999(us)") != std::string::npos);
+    std::string count_line = "playwise_operations_total{op=\"playSong\"} " +
+                             std::to_string(after.calls[EngineMetrics::PLAY_SONG]);
+    TestFramework::test("Exposition is Prometheus text format",
+                        scrape.str().find("# TYPE playwise_operation_duration_seconds summary") != std::string::npos &&
+                        scrape.str().find(count_line) != std::string::npos &&
+                        scrape.str().find("{op=\"loadState\",quantile=\"0.99\"}") != std::string::npos);
+}
+
+void test_span_tracer() {
+    TestFramework::begin_suite("Tracing Spans");
+    
+    SpanTracer::clear();
+    {
+        SpanTracer::Span outer("outer");
+        SpanTracer::Span inner("inner");
+    }
+    std::thread([]() { SpanTracer::Span other("other thread"); }).join();
+    std::ostringstream json;
+    size_t exported = SpanTracer::exportChromeTrace(json);
+    std::string trace = json.str();
+    size_t inner_at = trace.find("{\"name\":\"inner\",\"ph\":\"X\"");
+    size_t outer_at = trace.find("{\"name\":\"outer\",\"ph\":\"X\"");
+    TestFramework::test("Nested spans exported as complete events",
+                        exported == 3 && inner_at != std::string::npos && outer_at != std::string::npos &&
+                        inner_at < outer_at); // inner closes first
+    TestFramework::test("Export is a Chrome trace-event document",
+                        trace.compare(0, 15, "{\"traceEvents\":") == 0 &&
+                        trace.find("\"ts\":0.000") != std::string::npos &&
+                        trace.find("],\"displayTimeUnit\":\"ns\"}") != std::string::npos);
+    auto tid_of = [&trace](size_t at) {
+        size_t tid_at = trace.find("\"tid\":", at);
+        return at == std::string::npos || tid_at == std::string::npos ? std::string()
+                                                                        : trace.substr(tid_at, trace.find(',', tid_at) - tid_at);
+    };
+    std::string other_tid = tid_of(trace.find("\"other thread\""));
+    TestFramework::test("Each thread has its own track",
+                        !other_tid.empty() && other_tid != tid_of(outer_at) && tid_of(inner_at) == tid_of(outer_at));
+    
+    size_t rings_before = SpanTracer::ringCount();
+    for (int t = 0; t < 8; t++) std::thread([]() { SpanTracer::record("short-lived", 0, 1); }).join();
+    TestFramework::test("Exited threads hand their ring to the next thread", SpanTracer::ringCount() == rings_before);
+    
+    SpanTracer::clear();
+    for (size_t i = 0; i < SpanTracer::RING_CAPACITY + 10; i++) SpanTracer::record("wrap", i, 1);
+    TestFramework::test("Ring keeps only the newest spans", SpanTracer::recordedCount() == SpanTracer::RING_CAPACITY);
+    
+    SpanTracer::clear();
+    ConsoleCapture console;
+    PlayWiseEngine engine;
+    engine.addSong("1", "Blue in Green", "Miles Davis", 337, 5, "Jazz");
+    engine.addSong("2", "So What", "Miles Davis", 545, 4, "Jazz");
+    engine.autoPlayNext();
+    engine.sortPlaylist(PlaylistSorter::TITLE_ASC);
+    console.stop();
+    std::ostringstream engine_json;
+    SpanTracer::exportChromeTrace(engine_json);
+    std::string engine_trace = engine_json.str();
+    if (SpanTracer::ENABLED) {
+        TestFramework::test("addSong and autoPlayNext record spans",
+                            engine_trace.find("\"addSong\"") != std::string::npos &&
+                            engine_trace.find("\"autoPlayNext\"") != std::string::npos &&
+                            engine_trace.find("\"getAllSongs\"") != std::string::npos &&
+                            engine_trace.find("\"wasRecentlySkipped\"") != std::string::npos);
+        TestFramework::test("sortPlaylist spans sort and rebuild",
+                            engine_trace.find("\"sortPlaylist\"") != std::string::npos &&
+                            engine_trace.find("\"adaptiveSort\"") != std::string::npos &&
+                            engine_trace.find("\"rebuildFromVector\"") != std::string::npos);
+    } else {
+        TestFramework::test("Engine spans compile away without PLAYWISE_TRACING", SpanTracer::recordedCount() == 0);
+    }
+}
+
+void test_memory_report() {
+    TestFramework::begin_suite("Memory Accounting");
+    
+    auto build = [](PlayWiseEngine& engine, int songs) {
+        std::vector<SongSpec> specs(songs);
+        std::vector<std::string> ids(songs), titles(songs);
+        for (int i = 0; i < songs; i++) {
+            ids[i] = "M" + std::to_string(i);
+            titles[i] = "Memory Title " + std::to_string(i);
+            specs[i].id = ids[i];
+            specs[i].title = titles[i];
+            specs[i].artist = "Artist";
+            specs[i].genre = i % 2 ? "Jazz" : "Rock";
+            specs[i].duration = 100 + i;
+            specs[i].rating = 1 + i % 5;
+        }
+        engine.addSongs(specs);
+    };
+    
+    ConsoleCapture console;
+    PlayWiseEngine engine;
+    build(engine, 1000);
+    for (int i = 0; i < 30; i++) engine.playSong("M" + std::to_string(i % 10));
+    engine.skipCurrentSong();
+    engine.materializeSortedView(PlaylistSorter::DURATION_ASC);
+    console.clear();
+    engine.displaySnapshot();
+    std::string dashboard = console.text();
+    console.stop();
+    
+    MemoryReport report = engine.memoryReport();
+    auto row = [&report](const char* name) {
+        for (const auto& component : report.components)
+            if (std::string(component.name) == name) return component;
+        return MemoryReport::Component{"", name, 0, 0, ""};
+    };
+    TestFramework::test("Every structure has a row",
+                        report.components.size() == 12 && row("songs").bytes > 1000 * sizeof(Song) &&
+                        row("lookup").bytes > 0 && row("rating_tree").bytes > 0 && row("playlist").bytes > 0 &&
+                        row("history").bytes > 0);
+    TestFramework::test("Object counts match the structures",
+                        row("songs").objects == 1000 && row("lookup").objects == 2000 &&
+                        row("rating_tree").objects == 5 && row("sorted_views").objects == 1000 &&
+                        row("genre_index").objects == 2 && row("playlist").objects == 1000 &&
+                        row("history").objects == 30 && row("skip_tracker").objects == 1 &&
+                        row("replay").objects == 10);
+    TestFramework::test("Catalog rows add up to the catalog footprint",
+                        report.totalBytes("catalog") == engine.getCatalog()->memoryBytes() &&
+                        report.totalBytes() == report.totalBytes("catalog") + report.totalBytes("session"));
+    
+    std::ostringstream json;
+    report.writeJson(json);
+    std::string text = json.str();
+    TestFramework::test("JSON form is one machine-readable line",
+                        text.compare(0, 14, "{\"songs\":1000,") == 0 && text.back() == '\n' &&
+                        std::count(text.begin(), text.end(), '\n') == 1 &&
+                        text.find("{\"scope\":\"session\",\"name\":\"playlist\",") != std::string::npos &&
+                        text.find("\"unit\":\"nodes\"") != std::string::npos);
+    TestFramework::test("Dashboard shows memory by component",
+                        dashboard.find("Memory by Component:") != std::string::npos &&
+                        dashboard.find("rating_tree") != std::string::npos);
+    
+    console.start();
+    PlayWiseEngine larger;
+    build(larger, 4000);
+    console.stop();
+    MemoryReport large_report = larger.memoryReport();
+    double small_per_1k = report.perThousandSongs(row("songs").bytes);
+    double large_per_1k = large_report.perThousandSongs(large_report.components[0].bytes);
+    TestFramework::test("Song bytes per 1k songs stay flat as the catalog grows",
+                        large_report.catalog_songs == 4000 && std::abs(large_per_1k - small_per_1k) < small_per_1k * 0.1);
+}
+
 void test_hash_map_operations() {
     TestFramework::begin_suite("HashMap Lookup Operations");
     
@@ -656,6 +2397,32 @@ void run_comprehensive_tests() {
     test_playlist_operations();
     test_stack_operations();
     test_sorting_algorithms();
+    test_radix_sort();
+    test_adaptive_sorting();
+    test_top_k_selection();
+    test_sorted_views();
+    test_collation_keys();
+    test_recently_skipped_lru();
+    test_skip_scores();
+    test_probabilistic_sketches();
+    test_incremental_calming_top_k();
+    test_concurrent_play_counting();
+    test_mood_replay();
+    test_concurrent_engine();
+    test_multi_session();
+    test_command_script();
+    test_trace_recording();
+    test_incremental_snapshot();
+    test_song_key_index();
+    test_state_persistence();
+    test_catalog_import();
+    test_bulk_add_songs();
+    test_genre_index();
+    test_remove_song();
+    test_engine_server();
+    test_engine_metrics();
+    test_span_tracer();
+    test_memory_report();
     test_hash_map_operations();
     test_binary_search_tree();
     test_performance_characteristics();
@@ -666,6 +2433,465 @@ void run_comprehensive_tests() {
     TestFramework::summary();
 }
 
+/**
+ * Sorting benchmarks on adversarial input patterns
+ */
+void run_sort_benchmarks() {
+    std::cout << "\n=== Sort Benchmarks (100000 songs, title key) ===\n" << std::endl;
+    std::cout << "Pattern\t\tMerge(ms)\tAdaptive(ms)\tIntrosort(ms)\tstd::sort(ms)" << std::endl;
+    std::cout << "-------\t\t---------\t------------\t-------------\t-------------" << std::endl;
+    
+    const std::vector<std::string> patterns = {
+        "random", "sorted", "reversed", "nearly sorted", "organ pipe", "all equal", "few unique"
+    };
+    
+    for (const auto& pattern : patterns) {
+        std::vector<std::unique_ptr<Song>> owned;
+        std::vector<Song*> songs;
+        for (const auto& title : make_sort_pattern(pattern, 100000)) {
+            owned.push_back(std::make_unique<Song>("ID", title, "Artist", 180));
+            songs.push_back(owned.back().get());
+        }
+        
+        auto time_sort = [&](auto&& sorter) {
+            std::vector<Song*> copy = songs;
+            auto start = std::chrono::high_resolution_clock::now();
+            sorter(copy);
+            auto end = std::chrono::high_resolution_clock::now();
+            return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+        };
+        
+        double merge_time = time_sort([](std::vector<Song*>& v) { PlaylistSorter::mergeSort(v, PlaylistSorter::TITLE_ASC); });
+        double adaptive_time = time_sort([](std::vector<Song*>& v) { PlaylistSorter::adaptiveSort(v, PlaylistSorter::TITLE_ASC); });
+        double quick_time = time_sort([](std::vector<Song*>& v) { PlaylistSorter::quickSort(v, PlaylistSorter::TITLE_ASC); });
+        double std_time = time_sort([](std::vector<Song*>& v) {
+            std::sort(v.begin(), v.end(), [](Song* a, Song* b) { return a->title < b->title; });
+        });
+        
+        std::cout << std::left << std::setw(16) << pattern << std::fixed << std::setprecision(2)
+                  << merge_time << "\t\t" << adaptive_time << "\t\t" << quick_time << "\t\t" << std_time << std::endl;
+    }
+}
+
+/**
+ * Memory and accuracy of the approximate structures against the exact ones
+ */
+void run_sketch_benchmarks() {
+    std::cout << "\n=== Sketch Benchmarks (Zipf plays, 1M events) ===\n" << std::endl;
+    std::cout << "Songs\tExact(KB)\tSketch(KB)\tMeanErr\tMaxErr\tTop10Recall" << std::endl;
+    std::cout << "-----\t---------\t----------\t-------\t------\t-----------" << std::endl;
+    
+    for (int songs : {10000, 100000, 500000}) {
+        auto stream = make_zipf_stream(songs, 1000000);
+        AutoReplayManager exact_manager;
+        AutoReplayManager approx_manager;
+        approx_manager.enableApproximateCounting(0.0005, 0.01, 100);
+        
+        std::vector<std::unique_ptr<Song>> owned;
+        for (int i = 0; i < songs; i++) {
+            owned.push_back(std::make_unique<Song>("SONG-" + std::to_string(i), "T", "A", 100));
+        }
+        for (int song : stream) {
+            exact_manager.recordPlay(owned[song].get());
+            approx_manager.recordPlay(owned[song].get());
+        }
+        
+        auto exact_counts = exact_manager.getPlayCountStats();
+        double total_error = 0;
+        int max_error = 0;
+        for (const auto& pair : exact_counts) {
+            int error = approx_manager.getPlayCount(pair.first) - pair.second;
+            total_error += error;
+            max_error = std::max(max_error, error);
+        }
+        
+        std::vector<std::pair<int, std::string>> ranked;
+        for (const auto& pair : exact_counts) ranked.push_back({pair.second, pair.first});
+        std::partial_sort(ranked.begin(), ranked.begin() + 10, ranked.end(), std::greater<>());
+        auto approx_top = approx_manager.getPlayCountStats();
+        int recall = 0;
+        for (int i = 0; i < 10; i++) recall += approx_top.count(ranked[i].second);
+        
+        std::cout << songs << "\t" << std::fixed << std::setprecision(1)
+                  << exact_manager.playCountMemoryBytes() / 1024.0 << "\t\t"
+                  << approx_manager.playCountMemoryBytes() / 1024.0 << "\t\t"
+                  << std::setprecision(2) << total_error / exact_counts.size() << "\t"
+                  << max_error << "\t" << recall << "/10" << std::endl;
+    }
+    
+    std::cout << "\nSkip window\tExact(KB)\tBloom(KB)\tFalsePositive%" << std::endl;
+    for (int window : {1000, 10000, 100000}) {
+        RecentlySkippedTracker exact(window);
+        RecentlySkippedTracker approx(window);
+        approx.enableApproximate(0.01);
+        for (int i = 0; i < window; i++) {
+            std::string id = "SKIPPED-SONG-" + std::to_string(i);
+            exact.addSkippedSong(id);
+            approx.addSkippedSong(id);
+        }
+        int false_positives = 0;
+        for (int i = window; i < window + 100000; i++) {
+            false_positives += approx.wasRecentlySkipped("SKIPPED-SONG-" + std::to_string(i));
+        }
+        std::cout << window << "\t\t" << std::fixed << std::setprecision(1)
+                  << exact.memoryBytes() / 1024.0 << "\t\t" << approx.memoryBytes() / 1024.0
+                  << "\t\t" << std::setprecision(2) << false_positives / 1000.0 << std::endl;
+    }
+}
+
+void run_concurrency_benchmarks() {
+    std::cout << "\n=== Concurrency Benchmarks ===\n" << std::endl;
+    std::cout << "Play counting (1M plays per thread, 1000 songs)" << std::endl;
+    std::cout << "Threads\tMutex(Mops/s)\tSharded(Mops/s)\tSpeedup" << std::endl;
+    std::cout << "-------\t-------------\t---------------\t-------" << std::endl;
+    
+    std::vector<std::unique_ptr<Song>> owned;
+    for (int i = 0; i < 1000; i++) {
+        owned.push_back(std::make_unique<Song>("SONG-" + std::to_string(i), "T", "A", 100, 0, "Jazz"));
+        owned.back()->handle = i;
+    }
+    const int plays_per_thread = 1000000;
+    
+    auto run = [&](int threads, auto record) {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                std::mt19937 rng(t);
+                for (int i = 0; i < plays_per_thread; i++) record(owned[rng() % owned.size()].get());
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        auto end = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        return threads * (double)plays_per_thread / seconds / 1e6;
+    };
+    
+    for (int threads : {1, 2, 4, 8}) {
+        AutoReplayManager locked_manager;
+        std::mutex lock;
+        double locked = run(threads, [&](Song* song) {
+            std::lock_guard<std::mutex> guard(lock);
+            locked_manager.recordPlay(song);
+        });
+        
+        AutoReplayManager sharded_manager;
+        sharded_manager.enableConcurrentCounting(owned.size());
+        double sharded = run(threads, [&](Song* song) { sharded_manager.recordPlay(song); });
+        sharded_manager.flushPendingPlays();
+        
+        std::cout << threads << "\t" << std::fixed << std::setprecision(2) << locked << "\t\t"
+                  << sharded << "\t\t" << sharded / locked << "x" << std::endl;
+    }
+
+    std::cout << "\nEngine reads under a live writer (10k songs, 200k lookups per reader)" << std::endl;
+    std::cout << "Readers\tRCU(Mops/s)\tSharedLock(Mops/s)" << std::endl;
+    std::cout << "-------\t-----------\t------------------" << std::endl;
+    for (int threads : {1, 2, 4, 8, 16, 32}) {
+        ConsoleCapture console;
+        ConcurrentPlayWiseEngine engine;
+        for (int i = 0; i < 10000; i++) engine.addSong("S" + std::to_string(i), "T", "A", 100);
+        
+        auto measure = [&](auto lookup) {
+            std::atomic<bool> stop(false);
+            std::thread writer([&]() {
+                for (int i = 10000; !stop.load(); i++) {
+                    engine.addSong("S" + std::to_string(i), "T", "A", 100);
+                    engine.playSong("S" + std::to_string(i % 10000));
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+            });
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<std::thread> readers;
+            for (int t = 0; t < threads; t++) {
+                readers.emplace_back([&, t]() {
+                    std::mt19937 rng(t);
+                    std::vector<std::string> ids;
+                    for (int i = 0; i < 1024; i++) ids.push_back("S" + std::to_string(rng() % 10000));
+                    size_t found = 0;
+                    for (int i = 0; i < 200000; i++) found += lookup(ids[i & 1023]) != nullptr;
+                    if (found == 0) std::cerr << "lookup failed" << std::endl;
+                });
+            }
+            for (auto& reader : readers) reader.join();
+            auto end = std::chrono::high_resolution_clock::now();
+            stop = true;
+            writer.join();
+            return threads * 200000.0 / std::chrono::duration<double>(end - start).count() / 1e6;
+        };
+        
+        double rcu = measure([&](const std::string& id) { return engine.lookupById(id); });
+        double locked = measure([&](const std::string& id) {
+            return engine.read([&](PlayWiseEngine& e) { return e.getLookup().lookup_by_id(id); });
+        });
+        console.stop();
+        std::cout << threads << "\t" << std::fixed << std::setprecision(2) << rcu << "\t\t" << locked << std::endl;
+    }
+}
+
+void run_script_benchmarks() {
+    std::cout << "\n=== Command Script Throughput ===\n" << std::endl;
+    
+    std::ostringstream script;
+    std::mt19937 rng(11);
+    const int songs = 5000;
+    const char* sorts[] = {"title", "duration", "played", "rating"};
+    for (int i = 0; i < songs; i++) {
+        script << "add S" << i << " \"Title " << i << "\" \"Artist " << i % 97 << "\" " << 60 + rng() % 400
+               << " " << 1 + rng() % 5 << " " << (i % 2 ? "Jazz" : "Rock") << "\n";
+    }
+    for (int i = 0; i < 100000; i++) {
+        unsigned r = rng() % 100;
+        int id = rng() % songs;
+        if (r < 40) script << "play S" << id << "\n";
+        else if (r < 70) script << "search S" << id << "\n";
+        else if (r < 80) script << "skip\n";
+        else if (r < 88) script << "next\n";
+        else if (r < 93) script << "rate S" << id << " " << 1 + rng() % 5 << "\n";
+        else if (r < 97) script << "snapshot\n";
+        else if (r < 99) script << "undo\n";
+        else script << "sort " << sorts[rng() % 4] << "\n";
+    }
+    
+    PlayWiseEngine engine;
+    CommandScriptRunner runner(engine);
+    std::istringstream in(script.str());
+    runner.run(in);
+    runner.report(std::cout);
+}
+
+void run_snapshot_benchmarks() {
+    std::cout << "\n=== Dashboard Snapshot Reads ===\n" << std::endl;
+    std::cout << "Songs\tPlays\tExport(us)\tRefresh unchanged(ns)\tRebuild by walk(us)" << std::endl;
+    
+    for (int size : {10000, 100000}) {
+        ConsoleCapture console;
+        PlayWiseEngine engine;
+        for (int i = 0; i < size; i++) {
+            engine.addSong("S" + std::to_string(i), "Title " + std::to_string(i), "Artist", 60 + i % 400, 1 + i % 5);
+        }
+        for (int i = 0; i < size; i++) {
+            engine.playSong("S" + std::to_string((i * 7919) % size));
+        }
+        console.stop();
+        
+        const int reads = 2000;
+        size_t checksum = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < reads; i++) checksum += engine.export_snapshot().recently_played.size();
+        double export_us = std::chrono::duration<double, std::micro>(
+            std::chrono::high_resolution_clock::now() - start).count() / reads;
+        
+        auto snapshot = engine.export_snapshot();
+        start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < reads * 100; i++) checksum += engine.refresh_snapshot(snapshot);
+        double refresh_ns = std::chrono::duration<double, std::nano>(
+            std::chrono::high_resolution_clock::now() - start).count() / (reads * 100);
+        
+        // What each export used to cost: copying a history-sized stack plus a rating tree walk
+        start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < 20; i++) {
+            std::vector<Song*> copy(engine.getSongDatabase().begin(), engine.getSongDatabase().end());
+            checksum += copy.size() + engine.getRatingTree().getSongCountByRating().size();
+        }
+        double walk_us = std::chrono::duration<double, std::micro>(
+            std::chrono::high_resolution_clock::now() - start).count() / 20;
+        
+        std::cout << size << "\t" << size << "\t" << export_us << "\t\t" << refresh_ns << "\t\t\t"
+                  << walk_us << (checksum ? "" : " ") << std::endl;
+    }
+}
+
+void run_state_benchmarks() {
+    std::cout << "\n=== State Save/Load vs Re-ingest (1M songs) ===\n" << std::endl;
+    
+    const int songs = 1000000;
+    const std::string path = "benchmark_state.pwst";
+    const char* genres[] = {"Rock", "Jazz", "Pop", "Classical", "Ambient"};
+    
+    double ingest_ms, save_ms;
+    {
+        PlayWiseEngine engine;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < songs; i++) {
+            engine.addSong("S" + std::to_string(i), "Title " + std::to_string(i),
+                           "Artist " + std::to_string(i % 5000), 60 + i % 400, i % 6, genres[i % 5]);
+        }
+        ingest_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+        
+        start = std::chrono::high_resolution_clock::now();
+        engine.saveState(path);
+        save_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+    }
+    
+    PlayWiseEngine restored;
+    auto start = std::chrono::high_resolution_clock::now();
+    bool loaded = restored.loadState(path);
+    double load_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    std::cout << "Re-ingest via addSong: " << ingest_ms << " ms" << std::endl;
+    std::cout << "saveState: " << save_ms << " ms (" << file.tellg() / (1024 * 1024) << " MB)" << std::endl;
+    std::cout << "loadState: " << load_ms << " ms" << (loaded ? "" : " (FAILED)") << std::endl;
+    std::cout << "Speed-up over re-ingest: " << ingest_ms / load_ms << "x" << std::endl;
+    std::remove(path.c_str());
+}
+
+void run_import_benchmarks() {
+    std::cout << "\n=== Catalog Import Throughput (200k rows) ===\n" << std::endl;
+    
+    const int rows = 200000;
+    const char* genres[] = {"Rock", "Jazz", "Pop", "Classical", "Ambient"};
+    std::string csv = "id,title,artist,duration,rating,genre\n";
+    std::string jsonl;
+    for (int i = 0; i < rows; i++) {
+        std::string id = "S" + std::to_string(i);
+        std::string title = "Title " + std::to_string(i);
+        std::string artist = "Artist " + std::to_string(i % 5000);
+        csv += id + ",\"" + title + "\"," + artist + "," + std::to_string(60 + i % 400) + "," +
+               std::to_string(i % 6) + "," + genres[i % 5] + "\n";
+        jsonl += "{\"id\":\"" + id + "\",\"title\":\"" + title + "\",\"artist\":\"" + artist +
+                 "\",\"duration\":" + std::to_string(60 + i % 400) + ",\"rating\":" + std::to_string(i % 6) +
+                 ",\"genre\":\"" + genres[i % 5] + "\"}\n";
+    }
+    
+    auto run = [](const std::string& label, const std::string& text, CatalogImporter::Format format,
+                  size_t threads) {
+        PlayWiseEngine engine;
+        CatalogImporter importer(engine, threads);
+        std::istringstream in(text);
+        importer.import(in, format);
+        std::cout << label << " (" << threads << " thread" << (threads == 1 ? "" : "s") << "): "
+                  << importer.getImportedCount() << " songs in " << importer.getElapsedSeconds() * 1000 << " ms, "
+                  << static_cast<long>(importer.getRowCount() / importer.getElapsedSeconds()) << " rows/sec ("
+                  << text.size() / (1024 * 1024) << " MB)" << std::endl;
+    };
+    size_t cores = std::max(4u, std::thread::hardware_concurrency());
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+    run("CSV", csv, CatalogImporter::CSV, 1);
+    run("CSV", csv, CatalogImporter::CSV, cores);
+    run("JSON lines", jsonl, CatalogImporter::JSON_LINES, 1);
+    run("JSON lines", jsonl, CatalogImporter::JSON_LINES, cores);
+}
+
+void run_bulk_add_benchmarks() {
+    std::cout << "\n=== Bulk addSongs vs addSong Loop (1M songs) ===\n" << std::endl;
+    
+    const int songs = 1000000;
+    const char* genres[] = {"Rock", "Jazz", "Pop", "Classical", "Ambient"};
+    std::vector<std::string> ids(songs), titles(songs), artists(songs);
+    std::vector<SongSpec> specs(songs);
+    for (int i = 0; i < songs; i++) {
+        ids[i] = "S" + std::to_string(i);
+        titles[i] = "Title " + std::to_string(i);
+        artists[i] = "Artist " + std::to_string(i % 5000);
+        specs[i].id = ids[i];
+        specs[i].title = titles[i];
+        specs[i].artist = artists[i];
+        specs[i].genre = genres[i % 5];
+        specs[i].duration = 60 + i % 400;
+        specs[i].rating = i % 6;
+    }
+    
+    double loop_ms, bulk_ms;
+    {
+        PlayWiseEngine engine;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const SongSpec& spec : specs) {
+            engine.addSong(std::string(spec.id), std::string(spec.title), std::string(spec.artist),
+                           spec.duration, spec.rating, std::string(spec.genre));
+        }
+        loop_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+    }
+    {
+        PlayWiseEngine engine;
+        auto start = std::chrono::high_resolution_clock::now();
+        engine.addSongs(specs);
+        bulk_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count();
+    }
+    
+    std::cout << "addSong loop: " << loop_ms << " ms" << std::endl;
+    std::cout << "addSongs:     " << bulk_ms << " ms" << std::endl;
+    std::cout << "Speed-up: " << loop_ms / bulk_ms << "x" << std::endl;
+}
+
+void run_server_benchmarks() {
+    std::cout << "\n=== Socket Server: 1000 Connections, Pipelined vs Not ===\n" << std::endl;
+    
+    std::string path = "/tmp/playwise_bench_" + std::to_string(getpid()) + ".sock";
+    PlayWiseEngine engine;
+    EngineServer server(engine);
+    if (!server.listen(path)) return;
+    std::thread serving([&server]() { server.run(); });
+    
+    LoadGenerator seeder(path, 1, 64);
+    seeder.run(LoadGenerator::seedCommands(1000), 1000);
+    auto workload = LoadGenerator::mixedWorkload(1000);
+    std::ostringstream results; // std::cout is silenced while the server runs
+    for (size_t depth : {1, 16}) {
+        LoadGenerator load(path, 1000, depth);
+        load.run(workload, 200000);
+        results << "Pipeline depth " << depth << ": " << std::fixed << std::setprecision(0)
+                << load.getCompleted() / load.getElapsedSeconds() << " req/sec, p50 "
+                << std::setprecision(1) << load.latencyPercentile(0.50) / 1000.0 << " us, p99 "
+                << load.latencyPercentile(0.99) / 1000.0 << " us" << std::endl;
+    }
+    
+    server.stop();
+    serving.join();
+    std::cout << results.str();
+}
+
+void run_metrics_benchmarks() {
+    std::cout << "\n=== Operation Metrics Overhead ===\n" << std::endl;
+    
+    const int iterations = 10000000;
+    for (uint32_t interval : {EngineMetrics::DEFAULT_SAMPLE_INTERVAL, 1u}) {
+        EngineMetrics::setSampleInterval(interval);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            EngineMetrics::Scope timed(EngineMetrics::QUEUE_SONG);
+        }
+        double ns = std::chrono::duration<double, std::nano>(
+            std::chrono::high_resolution_clock::now() - start).count() / iterations;
+        std::cout << "Scope timing 1 in " << interval << ": " << std::fixed << std::setprecision(1)
+                  << ns << " ns per operation" << std::endl;
+    }
+    EngineMetrics::setSampleInterval(EngineMetrics::DEFAULT_SAMPLE_INTERVAL);
+    EngineMetrics::reset();
+}
+
+void run_memory_benchmarks() {
+    std::cout << "\n=== Memory Footprint per 1k Songs ===\n" << std::endl;
+    
+    const char* genres[] = {"Rock", "Jazz", "Pop", "Classical", "Ambient"};
+    for (int songs : {1000, 10000, 100000}) {
+        std::vector<std::string> ids(songs), titles(songs);
+        std::vector<SongSpec> specs(songs);
+        for (int i = 0; i < songs; i++) {
+            ids[i] = "S" + std::to_string(i);
+            titles[i] = "Title " + std::to_string(i);
+            specs[i].id = ids[i];
+            specs[i].title = titles[i];
+            specs[i].artist = "Artist";
+            specs[i].genre = genres[i % 5];
+            specs[i].duration = 60 + i % 400;
+            specs[i].rating = i % 6;
+        }
+        PlayWiseEngine engine;
+        engine.addSongs(specs);
+        MemoryReport report = engine.memoryReport();
+        std::cout << songs << " songs: " << std::fixed << std::setprecision(0)
+                  << report.perThousandSongs(report.totalBytes()) << " bytes per 1k songs" << std::endl;
+        report.writeJson(std::cout);
+    }
+}
+
 /**
  * Benchmark Tests
  */
@@ -738,6 +2964,18 @@ void run_benchmarks() {
                   << sort_time << "\t\t" << lookup_time << std::endl;
     }
     
+    run_sort_benchmarks();
+    run_sketch_benchmarks();
+    run_concurrency_benchmarks();
+    run_script_benchmarks();
+    run_snapshot_benchmarks();
+    run_state_benchmarks();
+    run_import_benchmarks();
+    run_bulk_add_benchmarks();
+    run_server_benchmarks();
+    run_metrics_benchmarks();
+    run_memory_benchmarks();
+    
     std::cout << "\nBenchmark completed! " << std::endl;
 }
 